@@ -27,7 +27,14 @@ func GetPackage() *denv.Package {
 	maintest.AddDependencies(cbasepkg.GetMainLib()...)
 	maintest.AddDependency(mainlib)
 
+	// 'cgenerics' benchmark application, compares the containers against the std
+	// containers and writes the results as JSON (source/bench/cpp)
+	mainbench := denv.SetupCppAppProject(mainpkg, "cgenerics_bench", "bench")
+	mainbench.AddDependencies(cbasepkg.GetMainLib()...)
+	mainbench.AddDependency(mainlib)
+
 	mainpkg.AddMainLib(mainlib)
 	mainpkg.AddUnittest(maintest)
+	mainpkg.AddMainApp(mainbench)
 	return mainpkg
 }
@@ -0,0 +1,145 @@
+#ifndef __C_GENERICS_BENCH_H__
+#define __C_GENERICS_BENCH_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include <chrono>
+#include <stdio.h>
+#include <vector>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        struct config_t
+        {
+            f64         m_min_seconds; // every measurement runs at least this long
+            u32         m_max_size;    // largest container size
+            const char* m_filter;      // only run benchmarks whose name contains this
+        };
+
+        // Results are written as a JSON object with a "results" array, one object per measurement:
+        // {"bench": "find_hit", "container": "hashmap_t", "dist": "zipf", "size": 1024, "threads": 1, "ns_per_op": 3.2}
+        // Measurements that are not a time use another name for the value, e.g. "allocs_per_op".
+        class bench_t
+        {
+        public:
+            bench_t(config_t const& config, FILE* out);
+            ~bench_t();
+
+            bool enabled(const char* bench) const;
+            u32  max_size() const { return m_config.m_max_size; }
+
+            void report(const char* bench, const char* container, const char* dist, u32 size, u32 threads, f64 value, const char* unit = "ns_per_op");
+
+            // Calls 'run' until the minimum time has passed, 'run' does 'ops' operations per call.
+            // Returns the best time per operation over the calls.
+            template <typename Fn> f64 measure(u64 ops, Fn run)
+            {
+                typedef std::chrono::steady_clock clock_t;
+
+                f64       best  = 1e30;
+                f64       total = 0;
+                u32       runs  = 0;
+                while (total < m_config.m_min_seconds || runs < 3)
+                {
+                    clock_t::time_point const start = clock_t::now();
+                    run();
+                    f64 const seconds = std::chrono::duration<f64>(clock_t::now() - start).count();
+                    total += seconds;
+                    if (seconds < best)
+                        best = seconds;
+                    runs += 1;
+                }
+                return (best * 1e9) / (f64)(ops > 0 ? ops : 1);
+            }
+
+            // Measures a single call, for operations that can not be repeated cheaply
+            template <typename Fn> static f64 measure_once(Fn run)
+            {
+                typedef std::chrono::steady_clock clock_t;
+
+                clock_t::time_point const start = clock_t::now();
+                run();
+                return std::chrono::duration<f64, std::nano>(clock_t::now() - start).count();
+            }
+
+        private:
+            config_t m_config;
+            FILE*    m_out;
+            u32      m_count;
+        };
+
+        // Results of benchmarked code are written here so that the compiler cannot drop the work
+        extern volatile u64 g_sink;
+
+        // The container sizes, from L1 to DRAM sized working sets
+        void sizes(bench_t const& bench, std::vector<u32>& out);
+
+        // wyrand, fast and good enough for generating workloads
+        class rng_t
+        {
+        public:
+            rng_t(u64 seed = 0x2545F4914F6CDD1DULL)
+                : m_state(seed)
+            {
+            }
+
+            inline u64 next()
+            {
+                m_state += 0xa0761d6478bd642fULL;
+                u64 const a = m_state;
+                u64 const b = m_state ^ 0xe7037ed1a0b428dbULL;
+#if defined(__SIZEOF_INT128__)
+                __uint128_t const r = (__uint128_t)a * b;
+                return (u64)r ^ (u64)(r >> 64);
+#else
+                return (a * b) ^ ((a >> 32) * (b >> 32));
+#endif
+            }
+            inline u32 next(u32 n) { return (u32)(((next() & 0xffffffff) * n) >> 32); }
+
+        private:
+            u64 m_state;
+        };
+
+        // Zipfian distribution over [0, n), rank 0 is the most popular
+        class zipf_t
+        {
+        public:
+            zipf_t(u32 n, f64 s = 0.99);
+            u32 next(rng_t& rng) const;
+
+        private:
+            std::vector<f64> m_cdf;
+        };
+
+        // Bijective, so distinct indices give distinct keys
+        inline u64 key_of(u64 i)
+        {
+            i ^= i >> 30;
+            i *= 0xbf58476d1ce4e5b9ULL;
+            i ^= i >> 27;
+            i *= 0x94d049bb133111ebULL;
+            i ^= i >> 31;
+            return i;
+        }
+
+        // Fills 'out' with 'count' indices in [0, n), uniform or zipfian
+        void indices(u32 n, u32 count, bool zipf, std::vector<u32>& out);
+
+        void bench_alloc(bench_t& bench);
+        void bench_btree(bench_t& bench);
+        void bench_hashmap(bench_t& bench);
+        void bench_queue(bench_t& bench);
+        void bench_sort(bench_t& bench);
+        void bench_sorted_index(bench_t& bench);
+        void bench_ttmap(bench_t& bench);
+        void bench_vector(bench_t& bench);
+
+    } // namespace nbench
+} // namespace ncore
+
+#endif // __C_GENERICS_BENCH_H__
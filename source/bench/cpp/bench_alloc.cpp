@@ -0,0 +1,67 @@
+#include "ccore/c_target.h"
+
+#include "cgenerics/c_arena_alloc.h"
+#include "cgenerics/c_flat_hash_map.h"
+#include "cgenerics/c_vector.h"
+
+#include "bench.h"
+
+namespace ncore
+{
+    namespace nbench
+    {
+        // A request that builds a small map and a vector and drops them again, the containers
+        // allocate from 'allocator' (nullptr = the runtime allocator).
+        static u64 request(alloc_t* allocator, u32 items)
+        {
+            flat_hashmap_n::hashmap_t<u64, u64> map(64, false, allocator);
+            vector_t<u64>                       list(allocator);
+            for (u32 i = 0; i < items; ++i)
+            {
+                map.insert(key_of(i), i);
+                list.push_back(i);
+            }
+            u64 sum = 0;
+            for (u32 i = 0; i < items; i += 2)
+                sum += *map.find(key_of(i));
+            return sum + list.size();
+        }
+
+        // The cost of a request with the containers on the heap versus on the frame arena, the time
+        // is per item that the request inserts.
+        static void request(bench_t& bench)
+        {
+            if (!bench.enabled("request"))
+                return;
+
+            static u32 const cItems[] = {16, 256, 4096};
+            for (u32 s = 0; s < sizeof(cItems) / sizeof(cItems[0]); ++s)
+            {
+                u32 const items   = cItems[s];
+                u32 const repeats = (1 << 16) / items;
+
+                f64 const heap_ns = bench.measure((u64)items * repeats, [&]() {
+                    u64 sum = 0;
+                    for (u32 r = 0; r < repeats; ++r)
+                        sum += request(nullptr, items);
+                    g_sink = sum;
+                });
+                bench.report("request", "runtime_alloc", "-", items, 1, heap_ns);
+
+                f64 const arena_ns = bench.measure((u64)items * repeats, [&]() {
+                    u64 sum = 0;
+                    for (u32 r = 0; r < repeats; ++r)
+                    {
+                        frame_scope_t scope;
+                        sum += request(scope.arena(), items);
+                    }
+                    g_sink = sum;
+                });
+                bench.report("request", "frame_arena", "-", items, 1, arena_ns);
+            }
+        }
+
+        void bench_alloc(bench_t& bench) { request(bench); }
+
+    } // namespace nbench
+} // namespace ncore
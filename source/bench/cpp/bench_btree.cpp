@@ -0,0 +1,148 @@
+#include "ccore/c_target.h"
+
+#include "cgenerics/c_btree.h"
+
+#include "bench.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        struct btree_adapter_t
+        {
+            inline void insert(u64 k, u64 v) { m_map.insert(k, v); }
+            inline u64  find(u64 k) const
+            {
+                u64 const* v = m_map.find(k);
+                return v != nullptr ? *v : 0;
+            }
+            // The sum of the values of the first 'count' items with a key >= 'from'
+            inline u64 scan(u64 from, u32 count) const
+            {
+                u64 sum = 0;
+                for (btree_map_t<u64, u64>::iterator i = m_map.lower_bound(from); i != m_map.end() && count > 0; ++i, --count)
+                    sum += i.second();
+                return sum;
+            }
+            btree_map_t<u64, u64> m_map;
+        };
+
+        struct std_map_adapter_t
+        {
+            inline void insert(u64 k, u64 v) { m_map.insert(std::make_pair(k, v)); }
+            inline u64  find(u64 k) const
+            {
+                std::map<u64, u64>::const_iterator i = m_map.find(k);
+                return i != m_map.end() ? i->second : 0;
+            }
+            inline u64 scan(u64 from, u32 count) const
+            {
+                u64 sum = 0;
+                for (std::map<u64, u64>::const_iterator i = m_map.lower_bound(from); i != m_map.end() && count > 0; ++i, --count)
+                    sum += i->second;
+                return sum;
+            }
+            std::map<u64, u64> m_map;
+        };
+
+        // Ordered map workloads over scattered u64 keys, the time is per item inserted, per lookup
+        // and per item scanned.
+        template <typename Map> static void workloads(bench_t& bench, const char* name)
+        {
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                if (bench.enabled("ordered_insert"))
+                {
+                    f64 const ns_per_op = bench.measure(n, [&]() {
+                        Map map;
+                        for (u32 i = 0; i < n; ++i)
+                            map.insert(key_of(i), i);
+                        g_sink = map.find(key_of(0));
+                    });
+                    bench.report("ordered_insert", name, "uniform", n, 1, ns_per_op);
+                }
+
+                Map map;
+                for (u32 i = 0; i < n; ++i)
+                    map.insert(key_of(i), i);
+
+                if (bench.enabled("ordered_find"))
+                {
+                    for (u32 d = 0; d < 2; ++d)
+                    {
+                        std::vector<u32> idx;
+                        indices(n, 1 << 16, d == 1, idx);
+                        f64 const ns_per_op = bench.measure(idx.size(), [&]() {
+                            u64 sum = 0;
+                            for (u32 i : idx)
+                                sum += map.find(key_of(i));
+                            g_sink = sum;
+                        });
+                        bench.report("ordered_find", name, d == 1 ? "zipf" : "uniform", n, 1, ns_per_op);
+                    }
+                }
+
+                if (bench.enabled("ordered_scan"))
+                {
+                    // ranges of 100 items that start at a random key
+                    u32 const        cRange = 100;
+                    std::vector<u32> idx;
+                    indices(n, 1 << 10, false, idx);
+                    f64 const ns_per_op = bench.measure((u64)idx.size() * cRange, [&]() {
+                        u64 sum = 0;
+                        for (u32 i : idx)
+                            sum += map.scan(key_of(i), cRange);
+                        g_sink = sum;
+                    });
+                    bench.report("ordered_scan", name, "uniform", n, 1, ns_per_op);
+                }
+            }
+        }
+
+        // Bulk loading a btree_map_t from sorted input against inserting the same keys one by one
+        static void build(bench_t& bench)
+        {
+            if (!bench.enabled("ordered_build"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                std::vector<u64> keys(n);
+                for (u32 i = 0; i < n; ++i)
+                    keys[i] = key_of(i);
+                std::sort(keys.begin(), keys.end());
+
+                f64 const bulk_ns = bench.measure(n, [&]() {
+                    btree_map_t<u64, u64> map;
+                    map.build_from(keys.data(), keys.data(), n);
+                    g_sink = map.size();
+                });
+                bench.report("ordered_build", "btree_map_t::build_from", "sorted", n, 1, bulk_ns);
+
+                f64 const insert_ns = bench.measure(n, [&]() {
+                    btree_map_t<u64, u64> map;
+                    for (u32 i = 0; i < n; ++i)
+                        map.insert(keys[i], keys[i]);
+                    g_sink = map.size();
+                });
+                bench.report("ordered_build", "btree_map_t::insert", "sorted", n, 1, insert_ns);
+            }
+        }
+
+        void bench_btree(bench_t& bench)
+        {
+            workloads<btree_adapter_t>(bench, "btree_map_t");
+            workloads<std_map_adapter_t>(bench, "std::map");
+            build(bench);
+        }
+
+    } // namespace nbench
+} // namespace ncore
@@ -0,0 +1,503 @@
+#include "ccore/c_target.h"
+
+#include "cgenerics/c_flat_hash_map.h"
+#include "cgenerics/c_flat_hash_map_build.h"
+#include "cgenerics/c_concurrent_hash_map.h"
+#include "cgenerics/c_mapped_hash_map.h"
+#include "cgenerics/c_snapshot_hash_map.h"
+
+#include "bench.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <unordered_map>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        // Adapters that give the benchmarked maps the same interface
+
+        template <typename Map> struct flat_t
+        {
+            flat_t(u32 size = 64)
+                : m_map(size)
+            {
+            }
+            inline bool       insert(u64 key, u64 value) { return m_map.insert(key, value); }
+            inline bool       erase(u64 key) { return m_map.erase(key); }
+            inline u64 const* find(u64 key) { return m_map.find(key); }
+            inline u64        sum()
+            {
+                u64 sum = 0;
+                for (auto it = m_map.begin(); it != m_map.end(); ++it)
+                    sum += it.second();
+                return sum;
+            }
+            Map m_map;
+        };
+
+        struct std_t
+        {
+            std_t(u32 size = 64) { m_map.reserve(size); }
+            inline bool       insert(u64 key, u64 value) { return m_map.emplace(key, value).second; }
+            inline bool       erase(u64 key) { return m_map.erase(key) != 0; }
+            inline u64 const* find(u64 key)
+            {
+                auto it = m_map.find(key);
+                return it == m_map.end() ? nullptr : &it->second;
+            }
+            inline u64 sum()
+            {
+                u64 sum = 0;
+                for (auto const& kv : m_map)
+                    sum += kv.second;
+                return sum;
+            }
+            std::unordered_map<u64, u64> m_map;
+        };
+
+        typedef flat_hashmap_n::hashmap_t<u64, u64>                                                                                                          hashmap_default_t;
+        typedef flat_hashmap_n::hashmap_t<u64, u64, flat_hashmap_n::DefaultHash<u64>, flat_hashmap_n::ref24_t>                                               hashmap_ref24_t;
+        typedef flat_hashmap_n::hashmap_t<u64, u64, flat_hashmap_n::DefaultHash<u64>, flat_hashmap_n::ref20_t>                                               hashmap_ref20_t;
+        typedef flat_hashmap_n::hashmap_t<u64, u64, flat_hashmap_n::DefaultHash<u64>, flat_hashmap_n::ref32_t, flat_hashmap_n::layout_split_t>               hashmap_split_t;
+        typedef flat_hashmap_n::hashmap_t<u64, u64, flat_hashmap_n::DefaultHash<u64>, flat_hashmap_n::ref24_t, flat_hashmap_n::layout_split_t>               hashmap_split24_t;
+        typedef flat_hashmap_n::hashmap_t<u64, u64, flat_hashmap_n::Fnv1aHash<u64>>                                                                          hashmap_fnv_t;
+        typedef flat_hashmap_n::hashmap_t<u64, u64, flat_hashmap_n::WyHash<u64>>                                                                             hashmap_wy_t;
+        typedef flat_hashmap_n::hashmap_t<u64, u64, flat_hashmap_n::DefaultHash<u64>, flat_hashmap_n::ref32_t, flat_hashmap_n::layout_packed_t, vmem_array_t> hashmap_vmem_t;
+
+        // The core workloads, each one runs over all sizes and (where it matters) both key distributions
+
+        template <typename Map> static void find_hit(bench_t& bench, const char* name, const char* bench_name = "find_hit")
+        {
+            if (!bench.enabled(bench_name))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                Map map(n);
+                for (u32 i = 0; i < n; ++i)
+                    map.insert(key_of(i), i);
+
+                for (u32 d = 0; d < 2; ++d)
+                {
+                    std::vector<u32> idx;
+                    indices(n, 1 << 16, d == 1, idx);
+                    std::vector<u64> keys(idx.size());
+                    for (size_t i = 0; i < idx.size(); ++i)
+                        keys[i] = key_of(idx[i]);
+
+                    f64 const ns_per_op = bench.measure(keys.size(), [&]() {
+                        u64 sum = 0;
+                        for (u64 key : keys)
+                            sum += *map.find(key);
+                        g_sink = sum;
+                    });
+                    bench.report(bench_name, name, d == 1 ? "zipf" : "uniform", n, 1, ns_per_op);
+                }
+            }
+        }
+
+        template <typename Map> static void find_miss(bench_t& bench, const char* name)
+        {
+            if (!bench.enabled("find_miss"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                Map map(n);
+                for (u32 i = 0; i < n; ++i)
+                    map.insert(key_of(i), i);
+
+                std::vector<u64> keys(1 << 16);
+                for (size_t i = 0; i < keys.size(); ++i)
+                    keys[i] = key_of(n + (u32)i);
+
+                f64 const ns_per_op = bench.measure(keys.size(), [&]() {
+                    u64 count = 0;
+                    for (u64 key : keys)
+                        count += map.find(key) == nullptr ? 1 : 0;
+                    g_sink = count;
+                });
+                bench.report("find_miss", name, "uniform", n, 1, ns_per_op);
+            }
+        }
+
+        // Erase a key and insert a new one, the size stays the same but tombstones accumulate
+        template <typename Map> static void churn(bench_t& bench, const char* name)
+        {
+            if (!bench.enabled("churn"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                Map map(n);
+                for (u32 i = 0; i < n; ++i)
+                    map.insert(key_of(i), i);
+
+                u32       next = n;
+                u32 const ops  = 1 << 16;
+                f64 const ns_per_op = bench.measure(ops * 2, [&]() {
+                    for (u32 i = 0; i < ops; ++i, ++next)
+                    {
+                        map.erase(key_of(next - n));
+                        map.insert(key_of(next), next);
+                    }
+                });
+                bench.report("churn", name, "uniform", n, 1, ns_per_op);
+            }
+        }
+
+        template <typename Map> static void iterate(bench_t& bench, const char* name)
+        {
+            if (!bench.enabled("iterate"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                Map map(n);
+                for (u32 i = 0; i < n; ++i)
+                    map.insert(key_of(i), i);
+
+                f64 const ns_per_op = bench.measure(n, [&]() { g_sink = map.sum(); });
+                bench.report("iterate", name, "-", n, 1, ns_per_op);
+            }
+        }
+
+        // Insert 'n' keys into an empty map that has to grow
+        template <typename Map> static void grow(bench_t& bench, const char* name, const char* bench_name = "grow")
+        {
+            if (!bench.enabled(bench_name))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                f64 const ns_per_op = bench.measure(n, [&]() {
+                    Map map;
+                    for (u32 i = 0; i < n; ++i)
+                        map.insert(key_of(i), i);
+                    g_sink = *map.find(key_of(0));
+                });
+                bench.report(bench_name, name, "-", n, 1, ns_per_op);
+            }
+        }
+
+        template <typename Map> static void all(bench_t& bench, const char* name)
+        {
+            find_hit<Map>(bench, name);
+            find_miss<Map>(bench, name);
+            churn<Map>(bench, name);
+            iterate<Map>(bench, name);
+            grow<Map>(bench, name);
+        }
+
+        // hashmap_t::find_batch against find
+        static void find_batch(bench_t& bench)
+        {
+            if (!bench.enabled("find_batch"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                hashmap_default_t map(n);
+                for (u32 i = 0; i < n; ++i)
+                    map.insert(key_of(i), i);
+
+                std::vector<u32> idx;
+                indices(n, 1 << 16, false, idx);
+                std::vector<u64>  keys(idx.size());
+                std::vector<u64*> values(idx.size());
+                for (size_t i = 0; i < idx.size(); ++i)
+                    keys[i] = key_of(idx[i]);
+
+                f64 const ns_per_op = bench.measure(keys.size(), [&]() {
+                    map.find_batch(keys.data(), (u32)keys.size(), values.data());
+                    g_sink = *values[0];
+                });
+                bench.report("find_batch", "hashmap_t", "uniform", n, 1, ns_per_op);
+            }
+        }
+
+        // The hashers on their own
+        template <typename Hasher> static void hash(bench_t& bench, const char* name)
+        {
+            if (!bench.enabled("hash"))
+                return;
+
+            u32 const ops       = 1 << 16;
+            f64 const ns_per_op = bench.measure(ops, [&]() {
+                Hasher hasher;
+                u64    sum = 0;
+                for (u64 i = 0; i < ops; ++i)
+                    sum += hasher(&i);
+                g_sink = sum;
+            });
+            bench.report("hash", name, "-", 0, 1, ns_per_op);
+        }
+
+        // flat_hashmap_n::build_from with 1..N threads against inserting one by one
+        static void build_from(bench_t& bench)
+        {
+            if (!bench.enabled("build_from"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            u32 const n = ns.back();
+
+            std::vector<u64> keys(n), values(n);
+            for (u32 i = 0; i < n; ++i)
+            {
+                keys[i]   = key_of(i);
+                values[i] = i;
+            }
+
+            f64 const insert_ns = bench.measure(n, [&]() {
+                hashmap_default_t map(n);
+                for (u32 i = 0; i < n; ++i)
+                    map.insert(keys[i], values[i]);
+                g_sink = map.size();
+            });
+            bench.report("build_from", "insert", "-", n, 1, insert_ns);
+
+            u32 const hw = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+            for (u32 threads = 1; threads <= hw && threads <= 64; threads *= 2)
+            {
+                f64 const ns_per_op = bench.measure(n, [&]() {
+                    hashmap_default_t map;
+                    g_sink = flat_hashmap_n::build_from(map, keys.data(), values.data(), n, threads);
+                });
+                bench.report("build_from", "hashmap_t", "-", n, threads, ns_per_op);
+            }
+        }
+
+        // The worst insert latency while growing, stop-the-world resize against incremental rehash
+        static void grow_latency(bench_t& bench)
+        {
+            if (!bench.enabled("grow_latency"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                for (u32 incremental = 0; incremental < 2; ++incremental)
+                {
+                    hashmap_default_t map;
+                    map.set_incremental_rehash(incremental ? 4 : 0);
+                    f64 worst = 0;
+                    for (u32 i = 0; i < n; ++i)
+                    {
+                        f64 const t = bench_t::measure_once([&]() { map.insert(key_of(i), i); });
+                        if (t > worst)
+                            worst = t;
+                    }
+                    bench.report("grow_latency", incremental ? "hashmap_t incremental" : "hashmap_t", "-", n, 1, worst);
+                }
+            }
+        }
+
+        // concurrent_hashmap_t with 1..64 threads, 90% lookups and 10% inserts/erases
+        static void concurrent(bench_t& bench)
+        {
+            if (!bench.enabled("concurrent"))
+                return;
+
+            typedef flat_hashmap_n::concurrent_hashmap_t<u64, u64> map_t;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            u32 const n = ns.back();
+
+            map_t map(n);
+            for (u32 i = 0; i < n; ++i)
+                map.insert(key_of(i), i);
+
+            for (u32 threads = 1; threads <= 64; threads *= 2)
+            {
+                u32 const ops       = 1 << 16;
+                f64 const ns_per_op = bench.measure((u64)ops * threads, [&]() {
+                    std::vector<std::thread> workers;
+                    for (u32 t = 0; t < threads; ++t)
+                    {
+                        workers.push_back(std::thread([&, t]() {
+                            rng_t rng(t + 1);
+                            u64   sum = 0;
+                            for (u32 i = 0; i < ops; ++i)
+                            {
+                                u32 const r   = rng.next(100);
+                                u64 const key = key_of(rng.next(n));
+                                if (r < 90)
+                                    map.find(key, [&](u64 const& value) { sum += value; });
+                                else if (r < 95)
+                                    map.erase(key);
+                                else
+                                    map.insert(key, i);
+                            }
+                            g_sink = sum;
+                        }));
+                    }
+                    for (auto& w : workers)
+                        w.join();
+                });
+                bench.report("concurrent", "concurrent_hashmap_t", "uniform", n, threads, ns_per_op);
+            }
+        }
+
+        // snapshot_hashmap_t lookups with 1..N reader threads while a writer keeps inserting and erasing
+        static void snapshot(bench_t& bench)
+        {
+            if (!bench.enabled("snapshot"))
+                return;
+
+            typedef flat_hashmap_n::snapshot_hashmap_t<u64, u64> map_t;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            u32 const n = ns.back();
+
+            map_t map(n);
+            for (u32 i = 0; i < n; ++i)
+                map.insert(key_of(i), i);
+
+            u32 const hw = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+            for (u32 threads = 1; threads < hw && threads <= 32; threads *= 2)
+            {
+                std::vector<u32> readers;
+                for (u32 t = 0; t < threads; ++t)
+                    readers.push_back(map.register_reader());
+
+                u32 const ops = 1 << 16;
+
+                std::atomic<bool> stop(false);
+                std::thread       writer([&]() {
+                    u32 i = 0;
+                    while (!stop.load(std::memory_order_relaxed))
+                    {
+                        map.erase(key_of(i % n));
+                        map.insert(key_of(i % n), i);
+                        map.reclaim();
+                        ++i;
+                    }
+                });
+
+                f64 const ns_per_op = bench.measure((u64)ops * threads, [&]() {
+                    std::vector<std::thread> workers;
+                    for (u32 t = 0; t < threads; ++t)
+                    {
+                        workers.push_back(std::thread([&, t]() {
+                            rng_t rng(t + 1);
+                            u64   sum = 0, value;
+                            for (u32 i = 0; i < ops; ++i)
+                            {
+                                if (map.find(readers[t], key_of(rng.next(n)), value))
+                                    sum += value;
+                            }
+                            g_sink = sum;
+                        }));
+                    }
+                    for (auto& w : workers)
+                        w.join();
+                });
+
+                stop.store(true);
+                writer.join();
+                bench.report("snapshot", "snapshot_hashmap_t", "uniform", n, threads, ns_per_op);
+            }
+        }
+
+        // Opening a saved map against building it, and lookups on the mapped pages
+        static void mapped(bench_t& bench)
+        {
+            if (!bench.enabled("mapped"))
+                return;
+
+            const char* path = "cgenerics_bench.map";
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                {
+                    hashmap_default_t map(n);
+                    for (u32 i = 0; i < n; ++i)
+                        map.insert(key_of(i), i);
+                    if (!flat_hashmap_n::save(map, path))
+                        return;
+                }
+
+                f64 const open_ns = bench.measure(1, [&]() {
+                    flat_hashmap_n::mapped_hashmap_t<u64, u64> map;
+                    map.open(path);
+                    g_sink = map.size();
+                });
+                bench.report("mapped_open", "mapped_hashmap_t", "-", n, 1, open_ns);
+
+                f64 const build_ns = bench.measure(1, [&]() {
+                    hashmap_default_t map(n);
+                    for (u32 i = 0; i < n; ++i)
+                        map.insert(key_of(i), i);
+                    g_sink = map.size();
+                });
+                bench.report("mapped_open", "hashmap_t build", "-", n, 1, build_ns);
+
+                flat_hashmap_n::mapped_hashmap_t<u64, u64> map;
+                map.open(path);
+                std::vector<u32> idx;
+                indices(n, 1 << 16, false, idx);
+                f64 const ns_per_op = bench.measure(idx.size(), [&]() {
+                    u64 sum = 0;
+                    for (u32 i : idx)
+                        sum += *map.find(key_of(i));
+                    g_sink = sum;
+                });
+                bench.report("mapped_find_hit", "mapped_hashmap_t", "uniform", n, 1, ns_per_op);
+            }
+            remove(path);
+        }
+
+        void bench_hashmap(bench_t& bench)
+        {
+            all<flat_t<hashmap_default_t>>(bench, "hashmap_t");
+            all<std_t>(bench, "std::unordered_map");
+
+            // The ref width and layout policies
+            find_hit<flat_t<hashmap_ref24_t>>(bench, "hashmap_t<ref24>");
+            find_hit<flat_t<hashmap_ref20_t>>(bench, "hashmap_t<ref20>");
+            find_hit<flat_t<hashmap_split_t>>(bench, "hashmap_t<split>");
+            find_hit<flat_t<hashmap_split24_t>>(bench, "hashmap_t<ref24,split>");
+            find_miss<flat_t<hashmap_split_t>>(bench, "hashmap_t<split>");
+
+            // The hashers
+            find_hit<flat_t<hashmap_fnv_t>>(bench, "hashmap_t<Fnv1aHash>");
+            find_hit<flat_t<hashmap_wy_t>>(bench, "hashmap_t<WyHash>");
+            hash<flat_hashmap_n::Fnv1aHash<u64>>(bench, "Fnv1aHash");
+            hash<flat_hashmap_n::IntHash<u64>>(bench, "IntHash");
+            hash<flat_hashmap_n::WyHash<u64>>(bench, "WyHash");
+
+            // Growth in virtual memory
+            grow<flat_t<hashmap_vmem_t>>(bench, "hashmap_t<vmem>");
+
+            find_batch(bench);
+            build_from(bench);
+            grow_latency(bench);
+            concurrent(bench);
+            snapshot(bench);
+            mapped(bench);
+        }
+
+    } // namespace nbench
+} // namespace ncore
@@ -0,0 +1,157 @@
+#include "cbase/c_base.h"
+
+#include "bench.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        volatile u64 g_sink = 0;
+
+        bench_t::bench_t(config_t const& config, FILE* out)
+            : m_config(config)
+            , m_out(out)
+            , m_count(0)
+        {
+            fprintf(m_out, "{\"results\": [\n");
+        }
+
+        bench_t::~bench_t()
+        {
+            fprintf(m_out, "\n]}\n");
+            fflush(m_out);
+        }
+
+        bool bench_t::enabled(const char* bench) const { return m_config.m_filter == nullptr || strstr(bench, m_config.m_filter) != nullptr; }
+
+        void bench_t::report(const char* bench, const char* container, const char* dist, u32 size, u32 threads, f64 value, const char* unit)
+        {
+            fprintf(m_out, "%s  {\"bench\": \"%s\", \"container\": \"%s\", \"dist\": \"%s\", \"size\": %u, \"threads\": %u, \"%s\": %.3f}", m_count > 0 ? ",\n" : "", bench, container, dist, size, threads, unit, value);
+            fflush(m_out);
+            m_count += 1;
+        }
+
+        void sizes(bench_t const& bench, std::vector<u32>& out)
+        {
+            // ~16 KB, ~256 KB, ~4 MB and ~64 MB of 16 byte items
+            static u32 const cSizes[] = {1 << 10, 1 << 14, 1 << 18, 1 << 22};
+
+            out.clear();
+            for (u32 i = 0; i < sizeof(cSizes) / sizeof(cSizes[0]); ++i)
+            {
+                if (cSizes[i] <= bench.max_size())
+                    out.push_back(cSizes[i]);
+            }
+        }
+
+        zipf_t::zipf_t(u32 n, f64 s)
+        {
+            m_cdf.resize(n);
+            f64 sum = 0;
+            for (u32 i = 0; i < n; ++i)
+            {
+                sum += 1.0 / pow((f64)(i + 1), s);
+                m_cdf[i] = sum;
+            }
+            for (u32 i = 0; i < n; ++i)
+                m_cdf[i] /= sum;
+        }
+
+        u32 zipf_t::next(rng_t& rng) const
+        {
+            f64 const u  = (f64)(rng.next() >> 11) * (1.0 / 9007199254740992.0);
+            u32       lo = 0;
+            u32       hi = (u32)m_cdf.size() - 1;
+            while (lo < hi)
+            {
+                u32 const mid = (lo + hi) >> 1;
+                if (m_cdf[mid] < u)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        void indices(u32 n, u32 count, bool zipf, std::vector<u32>& out)
+        {
+            rng_t rng(n * 31 + count);
+            out.resize(count);
+            if (zipf)
+            {
+                // The popular ranks are scattered over the keys, otherwise the hot keys would be
+                // the ones that were inserted first
+                zipf_t const dist(n);
+                for (u32 i = 0; i < count; ++i)
+                    out[i] = (u32)(key_of(dist.next(rng)) % n);
+            }
+            else
+            {
+                for (u32 i = 0; i < count; ++i)
+                    out[i] = rng.next(n);
+            }
+        }
+
+    } // namespace nbench
+} // namespace ncore
+
+// usage: cgenerics_bench [--quick] [--filter=<name>] [--max-size=<n>] [--out=<file>]
+int main(int argc, char** argv)
+{
+    cbase::init();
+
+    ncore::nbench::config_t config;
+    config.m_min_seconds = 0.1;
+    config.m_max_size    = 1 << 22;
+    config.m_filter      = nullptr;
+
+    const char* out_path = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            config.m_min_seconds = 0.01;
+            config.m_max_size    = 1 << 18;
+        }
+        else if (strncmp(argv[i], "--filter=", 9) == 0)
+            config.m_filter = argv[i] + 9;
+        else if (strncmp(argv[i], "--max-size=", 11) == 0)
+            config.m_max_size = (ncore::u32)strtoul(argv[i] + 11, nullptr, 10);
+        else if (strncmp(argv[i], "--out=", 6) == 0)
+            out_path = argv[i] + 6;
+        else
+        {
+            fprintf(stderr, "usage: %s [--quick] [--filter=<name>] [--max-size=<n>] [--out=<file>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FILE* out = (out_path != nullptr) ? fopen(out_path, "w") : stdout;
+    if (out == nullptr)
+    {
+        fprintf(stderr, "cannot open '%s'\n", out_path);
+        return 1;
+    }
+
+    {
+        ncore::nbench::bench_t bench(config, out);
+        ncore::nbench::bench_hashmap(bench);
+        ncore::nbench::bench_vector(bench);
+        ncore::nbench::bench_alloc(bench);
+        ncore::nbench::bench_sorted_index(bench);
+        ncore::nbench::bench_btree(bench);
+        ncore::nbench::bench_ttmap(bench);
+        ncore::nbench::bench_sort(bench);
+        ncore::nbench::bench_queue(bench);
+    }
+
+    if (out != stdout)
+        fclose(out);
+
+    cbase::exit();
+    return 0;
+}
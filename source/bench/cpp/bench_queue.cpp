@@ -0,0 +1,206 @@
+#include "ccore/c_target.h"
+
+#include "cgenerics/c_queue.h"
+
+#include "bench.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        enum
+        {
+            cQueueCapacity = 1024,
+            cQueueBatch    = 16,
+        };
+
+        // What the queues replace, a mutex protected deque
+        struct mutex_deque_t
+        {
+            mutex_deque_t(u32 capacity) {}
+
+            inline bool try_push(u64 item)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_items.push_back(item);
+                return true;
+            }
+            inline u32 try_push(u64 const* items, u32 n)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (u32 i = 0; i < n; ++i)
+                    m_items.push_back(items[i]);
+                return n;
+            }
+            inline bool try_pop(u64& item)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_items.empty())
+                    return false;
+                item = m_items.front();
+                m_items.pop_front();
+                return true;
+            }
+            inline u32 try_pop(u64* items, u32 n)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                u32 i = 0;
+                for (; i < n && !m_items.empty(); ++i)
+                {
+                    items[i] = m_items.front();
+                    m_items.pop_front();
+                }
+                return i;
+            }
+
+            std::mutex      m_mutex;
+            std::deque<u64> m_items;
+        };
+
+        template <typename Queue> static inline void push_all(Queue& queue, u64 const* items, u32 n)
+        {
+            backoff_t backoff;
+            while (n > 0)
+            {
+                u32 const pushed = (n == 1) ? (queue.try_push(*items) ? 1 : 0) : queue.try_push(items, n);
+                if (pushed == 0)
+                    backoff.wait();
+                items += pushed;
+                n -= pushed;
+            }
+        }
+
+        // 'pairs' producers push 'total' items, in batches of 'batch', and 'pairs' consumers pop them,
+        // the time is per item
+        template <typename Queue> static void throughput(bench_t& bench, const char* name, u32 pairs, u32 batch, u32 total)
+        {
+            f64 const ns_per_op = bench.measure(total, [&]() {
+                Queue            queue(cQueueCapacity);
+                std::atomic<u32> popped(0);
+                std::atomic<u64> sum(0);
+
+                std::vector<std::thread> threads;
+                for (u32 p = 0; p < pairs; ++p)
+                {
+                    threads.push_back(std::thread([&, p]() {
+                        u64       items[cQueueBatch];
+                        u32 const begin = (u32)(((u64)total * p) / pairs);
+                        u32 const end   = (u32)(((u64)total * (p + 1)) / pairs);
+                        for (u32 i = begin; i < end; i += batch)
+                        {
+                            u32 const n = (end - i) < batch ? (end - i) : batch;
+                            for (u32 j = 0; j < n; ++j)
+                                items[j] = i + j;
+                            push_all(queue, items, n);
+                        }
+                    }));
+                    threads.push_back(std::thread([&]() {
+                        u64                items[cQueueBatch];
+                        u64                local = 0;
+                        backoff_t backoff;
+                        while (popped.load(std::memory_order_relaxed) < total)
+                        {
+                            u32 const n = (batch == 1) ? (queue.try_pop(items[0]) ? 1 : 0) : queue.try_pop(items, batch);
+                            if (n == 0)
+                            {
+                                backoff.wait();
+                                continue;
+                            }
+                            for (u32 j = 0; j < n; ++j)
+                                local += items[j];
+                            popped.fetch_add(n, std::memory_order_relaxed);
+                        }
+                        sum.fetch_add(local);
+                    }));
+                }
+                for (std::thread& t : threads)
+                    t.join();
+                g_sink = sum.load();
+            });
+            bench.report("queue_throughput", name, batch == 1 ? "single" : "batch16", cQueueCapacity, pairs * 2, ns_per_op);
+        }
+
+        // 'pairs' clients each send a request and wait for a reply, 'pairs' servers answer them through a
+        // second queue. The time is per round trip as seen by a client, so two hand-overs.
+        template <typename Queue> static void round_trip(bench_t& bench, const char* name, u32 pairs, u32 rounds)
+        {
+            f64 const ns_per_op = bench.measure(rounds, [&]() {
+                Queue            requests(cQueueCapacity);
+                Queue            replies(cQueueCapacity);
+                std::atomic<u32> served(0);
+                u32 const        total = rounds * pairs;
+
+                std::vector<std::thread> threads;
+                for (u32 p = 0; p < pairs; ++p)
+                {
+                    threads.push_back(std::thread([&]() {
+                        for (u32 r = 0; r < rounds; ++r)
+                        {
+                            u64 const request = r;
+                            push_all(requests, &request, 1);
+                            u64                reply;
+                            backoff_t backoff;
+                            while (!replies.try_pop(reply))
+                                backoff.wait();
+                        }
+                    }));
+                    threads.push_back(std::thread([&]() {
+                        backoff_t backoff;
+                        while (served.load(std::memory_order_relaxed) < total)
+                        {
+                            u64 request;
+                            if (!requests.try_pop(request))
+                            {
+                                backoff.wait();
+                                continue;
+                            }
+                            served.fetch_add(1, std::memory_order_relaxed);
+                            u64 const reply = request + 1;
+                            push_all(replies, &reply, 1);
+                        }
+                    }));
+                }
+                for (std::thread& t : threads)
+                    t.join();
+            });
+            bench.report("queue_round_trip", name, "-", cQueueCapacity, pairs * 2, ns_per_op);
+        }
+
+        void bench_queue(bench_t& bench)
+        {
+            u32 const total  = bench.max_size() < (1u << 20) ? bench.max_size() : (1u << 20);
+            u32 const rounds = 1 << 12;
+
+            static u32 const cPairs[] = {1, 2, 4, 8};
+            for (u32 i = 0; i < sizeof(cPairs) / sizeof(cPairs[0]); ++i)
+            {
+                u32 const pairs = cPairs[i];
+                if (bench.enabled("queue_throughput"))
+                {
+                    u32 const batches[] = {1, cQueueBatch};
+                    for (u32 batch : batches)
+                    {
+                        if (pairs == 1)
+                            throughput<spsc_queue_t<u64> >(bench, "spsc_queue_t", pairs, batch, total);
+                        throughput<mpmc_queue_t<u64> >(bench, "mpmc_queue_t", pairs, batch, total);
+                        throughput<mutex_deque_t>(bench, "std::deque+mutex", pairs, batch, total);
+                    }
+                }
+                if (bench.enabled("queue_round_trip"))
+                {
+                    if (pairs == 1)
+                        round_trip<spsc_queue_t<u64> >(bench, "spsc_queue_t", pairs, rounds);
+                    round_trip<mpmc_queue_t<u64> >(bench, "mpmc_queue_t", pairs, rounds);
+                    round_trip<mutex_deque_t>(bench, "std::deque+mutex", pairs, rounds);
+                }
+            }
+        }
+
+    } // namespace nbench
+} // namespace ncore
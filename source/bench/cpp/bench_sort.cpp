@@ -0,0 +1,84 @@
+#include "ccore/c_target.h"
+
+#include "cgenerics/c_sort.h"
+#include "cgenerics/c_vector.h"
+
+#include "bench.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        // From 1K up to 100M items, the sizes above --max-size are skipped (by default everything
+        // beyond 4M), a 100M run needs ~2.4 GB for the input, the copy that is sorted and the scratch.
+        static void sort_sizes(bench_t const& bench, std::vector<u32>& out)
+        {
+            static u32 const cSizes[] = {1 << 10, 1 << 14, 1 << 18, 1 << 22, 1 << 24, 100000000};
+
+            out.clear();
+            for (u32 i = 0; i < sizeof(cSizes) / sizeof(cSizes[0]); ++i)
+            {
+                if (cSizes[i] <= bench.max_size())
+                    out.push_back(cSizes[i]);
+            }
+        }
+
+        // Ids: random 64-bit keys, and dense ids below 2^32 that leave half of the key bytes constant
+        static void fill(std::vector<u64>& input, u32 n, bool dense)
+        {
+            input.resize(n);
+            for (u32 i = 0; i < n; ++i)
+                input[i] = dense ? (key_of(i) & 0xffffffff) : key_of(i);
+        }
+
+        // The time is per item sorted, every call sorts a fresh copy of the same input
+        template <typename Sort> static void measure_sort(bench_t& bench, const char* container, const char* dist, std::vector<u64> const& input, vector_t<u64>& items, u32 threads, Sort sort)
+        {
+            u32 const n = (u32)input.size();
+            items.resize(n);
+
+            // the copy is measured as well, so measure it alone and take it off
+            f64 const copy_ns = bench.measure(n, [&]() {
+                nmem::memcpy(items.begin(), input.data(), (u64)n * sizeof(u64));
+                g_sink = items.at(n / 2);
+            });
+            f64 const ns_per_op = bench.measure(n, [&]() {
+                nmem::memcpy(items.begin(), input.data(), (u64)n * sizeof(u64));
+                sort(items);
+                g_sink = items.at(n / 2);
+            });
+            bench.report("sort", container, dist, n, threads, ns_per_op > copy_ns ? ns_per_op - copy_ns : 0);
+        }
+
+        void bench_sort(bench_t& bench)
+        {
+            if (!bench.enabled("sort"))
+                return;
+
+            u32 const threads = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() : 1;
+
+            std::vector<u32> ns;
+            sort_sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                for (u32 d = 0; d < 2; ++d)
+                {
+                    const char*      dist = d == 1 ? "dense_ids" : "uniform";
+                    std::vector<u64> input;
+                    fill(input, n, d == 1);
+                    vector_t<u64> items;
+
+                    measure_sort(bench, "std::sort", dist, input, items, 1, [](vector_t<u64>& v) { std::sort(v.begin(), v.end()); });
+                    measure_sort(bench, "sort_n::sort", dist, input, items, 1, [](vector_t<u64>& v) { sort_n::sort(v); });
+                    measure_sort(bench, "sort_n::pdqsort", dist, input, items, 1, [](vector_t<u64>& v) { sort_n::pdqsort(v.begin(), v.size(), sort_n::value_less_t<u64>()); });
+                    measure_sort(bench, "sort_n::parallel_sort", dist, input, items, threads, [=](vector_t<u64>& v) { sort_n::parallel_sort(v, threads); });
+                }
+            }
+        }
+
+    } // namespace nbench
+} // namespace ncore
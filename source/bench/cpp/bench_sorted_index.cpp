@@ -0,0 +1,82 @@
+#include "ccore/c_target.h"
+
+#include "cgenerics/c_sorted_index.h"
+#include "cgenerics/c_vector.h"
+
+#include "bench.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        // Point lookups in a read-only sorted table of u32 keys: the binary search of vector_t::find_sorted
+        // and std::lower_bound against the Eytzinger and the blocked sorted_index_t layouts. Every key
+        // is a hit, the time is per lookup.
+        static void sorted_find(bench_t& bench)
+        {
+            if (!bench.enabled("sorted_find"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                vector_t<u32> v;
+                for (u32 i = 0; i < n; ++i)
+                    v.push_back(i * 2);
+                std::vector<u32> sv(v.begin(), v.end());
+
+                sorted_index_t<u32>                 eytzinger;
+                sorted_index_t<u32, cSortedBlocked> blocked;
+                eytzinger.build(v);
+                blocked.build(v);
+
+                for (u32 d = 0; d < 2; ++d)
+                {
+                    const char* dist = d == 1 ? "zipf" : "uniform";
+
+                    std::vector<u32> idx;
+                    indices(n, 1 << 16, d == 1, idx);
+
+                    f64 const binary_ns = bench.measure(idx.size(), [&]() {
+                        s64 sum = 0;
+                        for (u32 i : idx)
+                            sum += v.find_sorted(i * 2);
+                        g_sink = (u64)sum;
+                    });
+                    bench.report("sorted_find", "vector_t::find_sorted", dist, n, 1, binary_ns);
+
+                    f64 const std_ns = bench.measure(idx.size(), [&]() {
+                        s64 sum = 0;
+                        for (u32 i : idx)
+                            sum += std::lower_bound(sv.begin(), sv.end(), i * 2) - sv.begin();
+                        g_sink = (u64)sum;
+                    });
+                    bench.report("sorted_find", "std::lower_bound", dist, n, 1, std_ns);
+
+                    f64 const eytzinger_ns = bench.measure(idx.size(), [&]() {
+                        s64 sum = 0;
+                        for (u32 i : idx)
+                            sum += eytzinger.find(i * 2);
+                        g_sink = (u64)sum;
+                    });
+                    bench.report("sorted_find", "sorted_index_t<eytzinger>", dist, n, 1, eytzinger_ns);
+
+                    f64 const blocked_ns = bench.measure(idx.size(), [&]() {
+                        s64 sum = 0;
+                        for (u32 i : idx)
+                            sum += blocked.find(i * 2);
+                        g_sink = (u64)sum;
+                    });
+                    bench.report("sorted_find", "sorted_index_t<blocked>", dist, n, 1, blocked_ns);
+                }
+            }
+        }
+
+        void bench_sorted_index(bench_t& bench) { sorted_find(bench); }
+
+    } // namespace nbench
+} // namespace ncore
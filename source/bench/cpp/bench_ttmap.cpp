@@ -0,0 +1,103 @@
+#include "ccore/c_target.h"
+
+#include "cgenerics/c_flat_hash_map.h"
+#include "cgenerics/c_ttmap.h"
+
+#include "bench.h"
+
+#include <vector>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        // ttmap_t against hashmap_t with u64 keys: building a map by insertion (per insert), lookups
+        // that hit (per lookup) and the worst single insert while the map grows
+        static void ttmap(bench_t& bench)
+        {
+            typedef flat_hashmap_n::hashmap_t<u64, u64> hashmap_u64_t;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                if (bench.enabled("trie_insert"))
+                {
+                    f64 const ns_per_op = bench.measure(n, [&]() {
+                        ttmap_t map(nullptr, sizeof(u64));
+                        for (u32 i = 0; i < n; ++i)
+                        {
+                            u64 const key = key_of(i);
+                            map.insert(&key, (void*)(ptr_t)i);
+                        }
+                        g_sink = map.size();
+                    });
+                    bench.report("trie_insert", "ttmap_t", "uniform", n, 1, ns_per_op);
+
+                    f64 const hashmap_ns_per_op = bench.measure(n, [&]() {
+                        hashmap_u64_t map;
+                        for (u32 i = 0; i < n; ++i)
+                            map.insert(key_of(i), i);
+                        g_sink = map.size();
+                    });
+                    bench.report("trie_insert", "hashmap_t", "uniform", n, 1, hashmap_ns_per_op);
+                }
+
+                if (bench.enabled("trie_find"))
+                {
+                    ttmap_t       trie(nullptr, sizeof(u64));
+                    hashmap_u64_t map;
+                    for (u32 i = 0; i < n; ++i)
+                    {
+                        u64 const key = key_of(i);
+                        trie.insert(&key, (void*)(ptr_t)i);
+                        map.insert(key, i);
+                    }
+
+                    for (u32 d = 0; d < 2; ++d)
+                    {
+                        std::vector<u32> idx;
+                        indices(n, 1 << 16, d == 1, idx);
+
+                        f64 const ns_per_op = bench.measure(idx.size(), [&]() {
+                            u64 sum = 0;
+                            for (u32 i : idx)
+                            {
+                                u64 const key = key_of(i);
+                                sum += (u64)(ptr_t)*trie.find(&key);
+                            }
+                            g_sink = sum;
+                        });
+                        bench.report("trie_find", "ttmap_t", d == 1 ? "zipf" : "uniform", n, 1, ns_per_op);
+
+                        f64 const hashmap_ns_per_op = bench.measure(idx.size(), [&]() {
+                            u64 sum = 0;
+                            for (u32 i : idx)
+                                sum += *map.find(key_of(i));
+                            g_sink = sum;
+                        });
+                        bench.report("trie_find", "hashmap_t", d == 1 ? "zipf" : "uniform", n, 1, hashmap_ns_per_op);
+                    }
+                }
+
+                // same measurement as the hashmap_t grow_latency bench
+                if (bench.enabled("grow_latency"))
+                {
+                    ttmap_t map(nullptr, sizeof(u64));
+                    f64     worst = 0;
+                    for (u32 i = 0; i < n; ++i)
+                    {
+                        u64 const key = key_of(i);
+                        f64 const t   = bench_t::measure_once([&]() { map.insert(&key, (void*)(ptr_t)i); });
+                        if (t > worst)
+                            worst = t;
+                    }
+                    bench.report("grow_latency", "ttmap_t", "-", n, 1, worst);
+                }
+            }
+        }
+
+        void bench_ttmap(bench_t& bench) { ttmap(bench); }
+
+    } // namespace nbench
+} // namespace ncore
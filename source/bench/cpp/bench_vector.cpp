@@ -0,0 +1,328 @@
+#include "ccore/c_target.h"
+#include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
+
+#include "cgenerics/c_vector.h"
+
+#include "bench.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace ncore
+{
+    namespace nbench
+    {
+        struct vector_adapter_t
+        {
+            inline void push_back(u64 v) { m_vector.push_back(v); }
+            inline u64  sum() const
+            {
+                u64 sum = 0;
+                for (u64 const* p = m_vector.begin(); p != m_vector.end(); ++p)
+                    sum += *p;
+                return sum;
+            }
+            inline s32 find(u64 v) const { return m_vector.find(v); }
+            inline s32 find_sorted(u64 v) const { return m_vector.find_sorted(v); }
+            vector_t<u64> m_vector;
+        };
+
+        struct std_vector_adapter_t
+        {
+            inline void push_back(u64 v) { m_vector.push_back(v); }
+            inline u64  sum() const
+            {
+                u64 sum = 0;
+                for (u64 v : m_vector)
+                    sum += v;
+                return sum;
+            }
+            inline s32 find(u64 v) const
+            {
+                auto it = std::find(m_vector.begin(), m_vector.end(), v);
+                return it == m_vector.end() ? -1 : (s32)(it - m_vector.begin());
+            }
+            inline s32 find_sorted(u64 v) const
+            {
+                auto it = std::lower_bound(m_vector.begin(), m_vector.end(), v);
+                return (it == m_vector.end() || *it != v) ? -1 : (s32)(it - m_vector.begin());
+            }
+            std::vector<u64> m_vector;
+        };
+
+        template <typename Vector> static void workloads(bench_t& bench, const char* name)
+        {
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                if (bench.enabled("push_back"))
+                {
+                    f64 const ns_per_op = bench.measure(n, [&]() {
+                        Vector v;
+                        for (u32 i = 0; i < n; ++i)
+                            v.push_back(i);
+                        g_sink = v.sum();
+                    });
+                    bench.report("push_back", name, "-", n, 1, ns_per_op);
+                }
+
+                // sorted and unique, so find_sorted can use it too
+                Vector v;
+                for (u32 i = 0; i < n; ++i)
+                    v.push_back((u64)i * 2);
+
+                if (bench.enabled("iterate"))
+                {
+                    f64 const ns_per_op = bench.measure(n, [&]() { g_sink = v.sum(); });
+                    bench.report("iterate", name, "-", n, 1, ns_per_op);
+                }
+
+                if (bench.enabled("find_linear"))
+                {
+                    // a miss scans all the elements, the time is per element
+                    f64 const ns_per_op = bench.measure(n, [&]() { g_sink = (u64)v.find(1); });
+                    bench.report("find_linear", name, "-", n, 1, ns_per_op);
+                }
+
+                if (bench.enabled("find_sorted"))
+                {
+                    for (u32 d = 0; d < 2; ++d)
+                    {
+                        std::vector<u32> idx;
+                        indices(n, 1 << 16, d == 1, idx);
+                        f64 const ns_per_op = bench.measure(idx.size(), [&]() {
+                            s64 sum = 0;
+                            for (u32 i : idx)
+                                sum += v.find_sorted((u64)i * 2);
+                            g_sink = (u64)sum;
+                        });
+                        bench.report("find_sorted", name, d == 1 ? "zipf" : "uniform", n, 1, ns_per_op);
+                    }
+                }
+            }
+        }
+
+        // The cost of the push_back that has to grow a full vector of 'n' elements, with a heap
+        // block this is a reallocation and a copy of 'n' elements, in virtual memory it commits pages.
+        static void grow_step(bench_t& bench)
+        {
+            if (!bench.enabled("grow_step"))
+                return;
+
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                for (u32 virt = 0; virt < 2; ++virt)
+                {
+                    f64 best = 1e30;
+                    for (u32 r = 0; r < 5; ++r)
+                    {
+                        vector_t<u64> v;
+                        if (virt)
+                            v.reserve_virtual(n * 4);
+                        while (v.size() < v.capacity() || v.size() < n)
+                            v.push_back(v.size());
+
+                        f64 const t = bench_t::measure_once([&]() { v.push_back(0); });
+                        if (t < best)
+                            best = t;
+                        g_sink = v.size();
+                    }
+                    bench.report("grow_step", virt ? "vector_t<vmem>" : "vector_t", "-", n, 1, best);
+                }
+            }
+        }
+
+        // Bulk copy, fill, insert and erase of u64 vectors, the time is per element that is written
+        static void bulk(bench_t& bench)
+        {
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                vector_t<u64>    v;
+                std::vector<u64> sv;
+                for (u32 i = 0; i < n; ++i)
+                {
+                    v.push_back(i);
+                    sv.push_back(i);
+                }
+
+                if (bench.enabled("bulk_copy"))
+                {
+                    f64 const ns_per_op = bench.measure(n, [&]() {
+                        vector_t<u64> copy(v);
+                        g_sink = copy.back();
+                    });
+                    bench.report("bulk_copy", "vector_t", "-", n, 1, ns_per_op);
+
+                    f64 const std_ns_per_op = bench.measure(n, [&]() {
+                        std::vector<u64> copy(sv);
+                        g_sink = copy.back();
+                    });
+                    bench.report("bulk_copy", "std::vector", "-", n, 1, std_ns_per_op);
+                }
+
+                if (bench.enabled("bulk_fill"))
+                {
+                    f64 const ns_per_op = bench.measure(n, [&]() {
+                        v.set_all((u64)g_sink);
+                        g_sink = v.back();
+                    });
+                    bench.report("bulk_fill", "vector_t", "-", n, 1, ns_per_op);
+
+                    f64 const std_ns_per_op = bench.measure(n, [&]() {
+                        std::fill(sv.begin(), sv.end(), (u64)g_sink);
+                        g_sink = sv.back();
+                    });
+                    bench.report("bulk_fill", "std::vector", "-", n, 1, std_ns_per_op);
+                }
+
+                if (bench.enabled("bulk_insert_erase"))
+                {
+                    // insert and erase one item at the front, all others move
+                    u64 const item      = 1;
+                    f64 const ns_per_op = bench.measure(n * 2, [&]() {
+                        v.insert(0, &item, 1);
+                        v.erase(0, 1);
+                    });
+                    bench.report("bulk_insert_erase", "vector_t", "-", n, 1, ns_per_op);
+
+                    f64 const std_ns_per_op = bench.measure(n * 2, [&]() {
+                        sv.insert(sv.begin(), item);
+                        sv.erase(sv.begin());
+                    });
+                    bench.report("bulk_insert_erase", "std::vector", "-", n, 1, std_ns_per_op);
+                }
+            }
+        }
+
+        // Linear scans over vectors of arithmetic items, vector_t (SIMD kernels) against the std
+        // algorithms. The value that is searched for is not in the vector so every scan reads all
+        // items, the time is per item.
+        template <typename T> static void search(bench_t& bench, const char* type)
+        {
+            std::vector<u32> ns;
+            sizes(bench, ns);
+            for (u32 n : ns)
+            {
+                vector_t<T>    v;
+                std::vector<T> sv;
+                for (u32 i = 0; i < n; ++i)
+                {
+                    T const item = (T)(1 + (i % 100));
+                    v.push_back(item);
+                    sv.push_back(item);
+                }
+                vector_t<T>    v2(v);
+                std::vector<T> sv2(sv);
+
+                if (bench.enabled("search_find"))
+                {
+                    f64 const ns_per_op = bench.measure(n, [&]() { g_sink = (u64)v.find((T)0); });
+                    bench.report("search_find", "vector_t", type, n, 1, ns_per_op);
+
+                    f64 const std_ns_per_op = bench.measure(n, [&]() { g_sink = (u64)(std::find(sv.begin(), sv.end(), (T)0) - sv.begin()); });
+                    bench.report("search_find", "std::vector", type, n, 1, std_ns_per_op);
+                }
+
+                if (bench.enabled("search_count"))
+                {
+                    f64 const ns_per_op = bench.measure(n, [&]() { g_sink = v.count_occurences((T)7); });
+                    bench.report("search_count", "vector_t", type, n, 1, ns_per_op);
+
+                    f64 const std_ns_per_op = bench.measure(n, [&]() { g_sink = (u64)std::count(sv.begin(), sv.end(), (T)7); });
+                    bench.report("search_count", "std::vector", type, n, 1, std_ns_per_op);
+                }
+
+                if (bench.enabled("search_compare"))
+                {
+                    // equal vectors, the compare runs to the end
+                    f64 const ns_per_op = bench.measure(n, [&]() { g_sink = (u64)v.compare(v2); });
+                    bench.report("search_compare", "vector_t", type, n, 1, ns_per_op);
+
+                    f64 const std_ns_per_op = bench.measure(n, [&]() { g_sink = (u64)std::lexicographical_compare(sv.begin(), sv.end(), sv2.begin(), sv2.end()); });
+                    bench.report("search_compare", "std::vector", type, n, 1, std_ns_per_op);
+                }
+            }
+        }
+
+        // Forwards to the runtime allocator and counts the calls to allocate
+        class counting_alloc_t : public alloc_t
+        {
+        public:
+            counting_alloc_t()
+                : m_allocs(0)
+            {
+            }
+
+            u64 m_allocs;
+
+        protected:
+            virtual void* v_allocate(u32 size, u32 alignment)
+            {
+                m_allocs += 1;
+                return context_t::runtime_alloc()->allocate(size, alignment);
+            }
+            virtual u32  v_deallocate(void* ptr) { return context_t::runtime_alloc()->deallocate(ptr); }
+            virtual void v_release() {}
+        };
+
+        template <typename Vector> static u64 small_vector(alloc_t* allocator, u32 items)
+        {
+            Vector v(allocator);
+            for (u32 i = 0; i < items; ++i)
+                v.push_back(i);
+            u64 sum = 0;
+            for (u64 const* p = v.begin(); p != v.end(); ++p)
+                sum += *p;
+            return sum;
+        }
+
+        // Many short lived vectors with a few items each, the time and the allocations are per vector
+        template <typename Vector> static void small(bench_t& bench, const char* name)
+        {
+            static u32 const cItems[] = {2, 4, 8, 16, 64};
+            u32 const        repeats  = 1 << 14;
+            for (u32 s = 0; s < sizeof(cItems) / sizeof(cItems[0]); ++s)
+            {
+                u32 const items = cItems[s];
+
+                counting_alloc_t alloc;
+                f64 const        ns_per_op = bench.measure(repeats, [&]() {
+                    u64 sum = 0;
+                    for (u32 r = 0; r < repeats; ++r)
+                        sum += small_vector<Vector>(&alloc, items);
+                    g_sink = sum;
+                });
+                bench.report("small_push_iterate", name, "-", items, 1, ns_per_op);
+
+                alloc.m_allocs = 0;
+                for (u32 r = 0; r < repeats; ++r)
+                    g_sink = small_vector<Vector>(&alloc, items);
+                bench.report("small_push_iterate", name, "-", items, 1, (f64)alloc.m_allocs / repeats, "allocs_per_op");
+            }
+        }
+
+        void bench_vector(bench_t& bench)
+        {
+            workloads<vector_adapter_t>(bench, "vector_t");
+            workloads<std_vector_adapter_t>(bench, "std::vector");
+            grow_step(bench);
+            bulk(bench);
+            search<u8>(bench, "u8");
+            search<u32>(bench, "u32");
+            search<u64>(bench, "u64");
+            search<f32>(bench, "f32");
+            if (bench.enabled("small_push_iterate"))
+            {
+                small<vector_t<u64>>(bench, "vector_t");
+                small<inline_vector_t<u64, 8>>(bench, "inline_vector_t<8>");
+            }
+        }
+
+    } // namespace nbench
+} // namespace ncore
@@ -0,0 +1,80 @@
+#include "ccore/c_target.h"
+#include "cbase/c_debug.h"
+
+#include "cgenerics/c_arena_alloc.h"
+#include "cgenerics/c_vmem.h"
+
+namespace ncore
+{
+    // pages are committed in steps of at least this size, so small allocations do not each end up
+    // doing a system call when they cross a page boundary
+    static u64 const cCommitStep = 64 * 1024;
+
+    arena_alloc_t::arena_alloc_t(u64 reserve_bytes)
+        : m_base(nullptr)
+        , m_reserved(vmem_n::page_align(reserve_bytes))
+        , m_committed(0)
+        , m_used(0)
+    {
+        m_base = (u8*)vmem_n::reserve(m_reserved);
+        if (m_base == nullptr)
+            m_reserved = 0;
+    }
+
+    arena_alloc_t::~arena_alloc_t() { vmem_n::release(m_base, m_reserved); }
+
+    void arena_alloc_t::rewind(u64 mark)
+    {
+        ASSERT(mark <= m_used);
+        if (mark < m_used)
+            m_used = mark;
+    }
+
+    void* arena_alloc_t::v_allocate(u32 size, u32 alignment)
+    {
+        if (alignment < sizeof(void*))
+            alignment = sizeof(void*);
+
+        u64 const begin = (m_used + alignment - 1) & ~((u64)alignment - 1);
+        u64 const end   = begin + size;
+        if (end > m_reserved)
+        {
+            ASSERTS(false, "arena_alloc_t: the reserved range is exhausted");
+            return nullptr;
+        }
+
+        if (end > m_committed)
+        {
+            u64 desired = vmem_n::page_align(end);
+            u64 step    = m_committed > cCommitStep ? m_committed : cCommitStep;
+            if (desired < m_committed + step)
+                desired = m_committed + step;
+            if (desired > m_reserved)
+                desired = m_reserved;
+            if (!vmem_n::commit(m_base + m_committed, desired - m_committed))
+                return nullptr;
+            m_committed = desired;
+        }
+
+        m_used = end;
+        return m_base + begin;
+    }
+
+    // The memory is returned with reset() or rewind()
+    u32 arena_alloc_t::v_deallocate(void* ptr) { return 0; }
+
+    void arena_alloc_t::v_release()
+    {
+        if (m_committed > 0)
+            vmem_n::decommit(m_base, m_committed);
+        m_committed = 0;
+        m_used      = 0;
+    }
+
+    arena_alloc_t* frame_arena()
+    {
+        static thread_local arena_alloc_t s_arena;
+        return &s_arena;
+    }
+
+} // namespace ncore
@@ -0,0 +1,88 @@
+#include "ccore/c_target.h"
+#include "cbase/c_context.h"
+#include "cbase/c_debug.h"
+
+#include "cgenerics/c_pool_alloc.h"
+
+namespace ncore
+{
+    pool_alloc_t::pool_alloc_t(u32 block_size, alloc_t* allocator, u32 chunk_bytes)
+        : m_alloc(allocator != nullptr ? allocator : context_t::runtime_alloc())
+        , m_block_size(0)
+        , m_alignment(block_size >= 64 ? 64 : 16)
+        , m_chunk_blocks(0)
+        , m_used(0)
+        , m_chunks(0)
+        , m_free(nullptr)
+        , m_chunk_list(nullptr)
+        , m_cursor(nullptr)
+        , m_cursor_end(nullptr)
+    {
+        // the block size is a multiple of the alignment, so every block of a chunk is aligned
+        m_block_size   = (block_size + m_alignment - 1) & ~(m_alignment - 1);
+        m_chunk_blocks = chunk_bytes / m_block_size;
+        if (m_chunk_blocks < 2)
+            m_chunk_blocks = 2;
+    }
+
+    pool_alloc_t::~pool_alloc_t() { v_release(); }
+
+    void* pool_alloc_t::v_allocate(u32 size, u32 alignment)
+    {
+        ASSERTS(size <= m_block_size && alignment <= m_alignment, "pool_alloc_t: the request does not fit a block");
+
+        if (m_free != nullptr)
+        {
+            link_t* block = m_free;
+            m_free        = block->m_next;
+            m_used += 1;
+            return block;
+        }
+
+        if (m_cursor == m_cursor_end)
+        {
+            // the first block of a chunk is the link in the chunk list
+            u8* chunk = (u8*)m_alloc->allocate(m_chunk_blocks * m_block_size, m_alignment);
+            if (chunk == nullptr)
+                return nullptr;
+            ((link_t*)chunk)->m_next = m_chunk_list;
+            m_chunk_list             = (link_t*)chunk;
+            m_chunks += 1;
+            m_cursor     = chunk + m_block_size;
+            m_cursor_end = chunk + m_chunk_blocks * m_block_size;
+        }
+
+        void* block = m_cursor;
+        m_cursor += m_block_size;
+        m_used += 1;
+        return block;
+    }
+
+    u32 pool_alloc_t::v_deallocate(void* ptr)
+    {
+        if (ptr == nullptr)
+            return 0;
+        ASSERT(m_used > 0);
+        link_t* block = (link_t*)ptr;
+        block->m_next = m_free;
+        m_free        = block;
+        m_used -= 1;
+        return m_block_size;
+    }
+
+    void pool_alloc_t::v_release()
+    {
+        while (m_chunk_list != nullptr)
+        {
+            link_t* chunk = m_chunk_list;
+            m_chunk_list  = chunk->m_next;
+            m_alloc->deallocate(chunk);
+        }
+        m_chunks     = 0;
+        m_used       = 0;
+        m_free       = nullptr;
+        m_cursor     = nullptr;
+        m_cursor_end = nullptr;
+    }
+
+} // namespace ncore
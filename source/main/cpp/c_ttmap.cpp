@@ -0,0 +1,215 @@
+#include "ccore/c_target.h"
+#include "cbase/c_context.h"
+#include "cbase/c_debug.h"
+#include "cbase/c_memory.h"
+
+#include "cgenerics/c_flat_hash_map.h"
+#include "cgenerics/c_ttmap.h"
+
+namespace ncore
+{
+    static void default_hash(const void* key, u32 sizeof_key, u64& high, u64& low)
+    {
+        low  = flat_hashmap_n::WYHASH64((u8 const*)key, sizeof_key, 0x9e3779b97f4a7c15ULL);
+        high = flat_hashmap_n::WYHASH64((u8 const*)key, sizeof_key, 0xc2b2ae3d27d4eb4fULL);
+    }
+
+    ttmap_t::ttmap_t(alloc_t* allocator, u32 sizeof_key, ttmap_hash_fn key_hasher, u32 root_bits)
+        : m_allocator(allocator != nullptr ? allocator : context_t::runtime_alloc())
+        , m_hasher(key_hasher != nullptr ? key_hasher : default_hash)
+        , m_sizeof_key(sizeof_key)
+        , m_root_bits(root_bits)
+        , m_rootsize(1u << root_bits)
+        , m_size(0)
+        , m_roottable(nullptr)
+        , m_nodes(sizeof(node_t), m_allocator)
+        , m_items(sizeof(item_t) + sizeof_key, m_allocator)
+    {
+        ASSERT(root_bits <= 30);
+        m_roottable = (ptr_t*)m_allocator->allocate(m_rootsize * sizeof(ptr_t), 64);
+        nmem::memset(m_roottable, 0, m_rootsize * sizeof(ptr_t));
+    }
+
+    ttmap_t::~ttmap_t() { m_allocator->deallocate(m_roottable); }
+
+    void ttmap_t::clear()
+    {
+        nmem::memset(m_roottable, 0, m_rootsize * sizeof(ptr_t));
+        m_nodes.release();
+        m_items.release();
+        m_size = 0;
+    }
+
+    void ttmap_t::hash(const void* key, u64 hash[2]) const { m_hasher(key, m_sizeof_key, hash[1], hash[0]); }
+
+    ttmap_t::item_t* ttmap_t::find_item(ptr_t e, u64 const hash[2], const void* key) const
+    {
+        for (item_t* item = as_item(e); item != nullptr; item = item->m_next)
+        {
+            if (item->m_hash[0] == hash[0] && item->m_hash[1] == hash[1] && nmem::memcmp(item->key(), key, m_sizeof_key) == 0)
+                return item;
+        }
+        return nullptr;
+    }
+
+    void** ttmap_t::find(const void* key) const
+    {
+        u64 h[2];
+        hash(key, h);
+
+        ttmap_idxer_t idx(h, m_root_bits);
+        ptr_t         e = m_roottable[idx.root()];
+        while (e != 0 && !is_item(e))
+            e = as_node(e)->m_elements[idx.next()];
+        if (e == 0)
+            return nullptr;
+
+        item_t* item = find_item(e, h, key);
+        return item != nullptr ? &item->m_value : nullptr;
+    }
+
+    bool ttmap_t::insert(const void* key, void* value)
+    {
+        u64 h[2];
+        hash(key, h);
+
+        ttmap_idxer_t idx(h, m_root_bits);
+        ptr_t*        slot = &m_roottable[idx.root()];
+        while (*slot != 0 && !is_item(*slot))
+            slot = &as_node(*slot)->m_elements[idx.next()];
+
+        item_t* other = (*slot != 0) ? as_item(*slot) : nullptr;
+        if (other != nullptr && find_item(*slot, h, key) != nullptr)
+            return false;
+
+        item_t* item    = (item_t*)m_items.allocate(sizeof(item_t) + m_sizeof_key);
+        item->m_hash[0] = h[0];
+        item->m_hash[1] = h[1];
+        item->m_value   = value;
+        item->m_next    = nullptr;
+        nmem::memcpy(item->key(), key, m_sizeof_key);
+        m_size += 1;
+
+        if (other == nullptr)
+        {
+            *slot = (ptr_t)item | cItemTag;
+            return true;
+        }
+
+        if (other->m_hash[0] == h[0] && other->m_hash[1] == h[1])
+        {
+            // the full hash is the same, chain
+            item->m_next = other;
+            *slot        = (ptr_t)item | cItemTag;
+            return true;
+        }
+
+        // Both took the same path so far, push them down until their hash bits part
+        ttmap_idxer_t other_idx(other->m_hash, m_root_bits);
+        other_idx.m_depth = idx.m_depth;
+        for (;;)
+        {
+            s32 const i = idx.next();
+            s32 const o = other_idx.next();
+            ASSERT(i >= 0 && o >= 0);
+
+            node_t* node = (node_t*)m_nodes.allocate(sizeof(node_t));
+            nmem::memset(node, 0, sizeof(node_t));
+            *slot = (ptr_t)node;
+            if (i != o)
+            {
+                node->m_elements[i] = (ptr_t)item | cItemTag;
+                node->m_elements[o] = (ptr_t)other | cItemTag;
+                return true;
+            }
+            slot = &node->m_elements[i];
+        }
+    }
+
+    bool ttmap_t::remove(const void* key)
+    {
+        u64 h[2];
+        hash(key, h);
+
+        // the slots from the root down to the item
+        ptr_t*        slots[cMaxDepth];
+        s32           depth = 0;
+        ttmap_idxer_t idx(h, m_root_bits);
+        slots[0] = &m_roottable[idx.root()];
+        while (*slots[depth] != 0 && !is_item(*slots[depth]))
+        {
+            slots[depth + 1] = &as_node(*slots[depth])->m_elements[idx.next()];
+            depth += 1;
+        }
+
+        ptr_t* slot = slots[depth];
+        if (*slot == 0)
+            return false;
+
+        item_t* item = find_item(*slot, h, key);
+        if (item == nullptr)
+            return false;
+
+        // unlink from the chain
+        item_t* head = as_item(*slot);
+        if (head == item)
+        {
+            *slot = (item->m_next != nullptr) ? ((ptr_t)item->m_next | cItemTag) : 0;
+        }
+        else
+        {
+            while (head->m_next != item)
+                head = head->m_next;
+            head->m_next = item->m_next;
+        }
+        m_items.deallocate(item);
+        m_size -= 1;
+
+        // Collapse the nodes on the path that are left empty or with a single item, the item moves up
+        while (depth > 0)
+        {
+            node_t* node  = as_node(*slots[depth - 1]);
+            s32     count = 0;
+            ptr_t   last  = 0;
+            for (s32 i = 0; i < 4; ++i)
+            {
+                if (node->m_elements[i] != 0)
+                {
+                    count += 1;
+                    last = node->m_elements[i];
+                }
+            }
+            if (count > 1 || (count == 1 && !is_item(last)))
+                break;
+
+            *slots[depth - 1] = last;
+            m_nodes.deallocate(node);
+            depth -= 1;
+        }
+        return true;
+    }
+
+    void ttmap_value_t::remove()
+    {
+        if (m_value != nullptr)
+        {
+            m_map->remove(m_key);
+            m_value = nullptr;
+        }
+    }
+
+    ttmap_value_t& ttmap_value_t::operator=(void* value)
+    {
+        if (m_value == nullptr)
+        {
+            m_map->insert(m_key, value);
+            m_value = m_map->find(m_key);
+        }
+        else
+        {
+            *m_value = value;
+        }
+        return *this;
+    }
+
+} // namespace ncore
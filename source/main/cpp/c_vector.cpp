@@ -4,17 +4,93 @@
 #include "cbase/c_memory.h"
 
 #include "cgenerics/c_vector.h"
+#include "cgenerics/c_vmem.h"
 
 namespace ncore
 {
-    bool vector_base_t::__set_capacity(u32 new_capacity)
+    vector_base_t::vector_base_t(u32 sizeofitem, alloc_t* allocator, u32 inline_capacity)
+        : m_p(nullptr)
+        , m_size(0)
+        , m_sizeof(sizeofitem)
+        , m_capacity(0)
+        , m_max_capacity(0)
+        , m_alloc(allocator != nullptr ? allocator : context_t::runtime_alloc())
+        , m_inline_capacity(inline_capacity)
     {
-        if (new_capacity == m_capacity)
+        if (m_inline_capacity != 0)
+        {
+            m_p        = __inline_data();
+            m_capacity = m_inline_capacity;
+        }
+    }
+
+    // Grows or shrinks the storage, shrinking below the current size is not possible.
+    // A capacity of 0 releases the storage, a vector with an inline buffer goes back to that buffer.
+    // The items are destructed by the caller before the storage is released.
+    bool vector_base_t::__set_capacity(u32 new_capacity, relocate_fn_t relocate)
+    {
+        // a reserved range of virtual memory still needs to be released when the capacity is 0
+        if (new_capacity == m_capacity && (new_capacity != 0 || m_max_capacity == 0))
             return true;
 
         if (new_capacity == 0)
         {
             // release data
+            if (m_max_capacity != 0)
+            {
+                vmem_n::release(m_p, vmem_n::page_align((u64)m_max_capacity * m_sizeof));
+            }
+            else if (m_p != nullptr && !__is_inline())
+            {
+                m_alloc->deallocate(m_p);
+            }
+            m_p            = (m_inline_capacity != 0) ? __inline_data() : nullptr;
+            m_size         = 0;
+            m_capacity     = m_inline_capacity;
+            m_max_capacity = 0;
+        }
+        else if (new_capacity < m_size)
+        {
+            return false;
+        }
+        else if (new_capacity <= m_inline_capacity)
+        {
+            // the items fit in the inline buffer again
+            if (!__is_inline())
+            {
+                void* inline_p = __inline_data();
+                __relocate(inline_p, m_p, m_size, relocate);
+                m_alloc->deallocate(m_p);
+                m_p        = inline_p;
+                m_capacity = m_inline_capacity;
+            }
+        }
+        else if (m_max_capacity != 0)
+        {
+            // virtual memory, commit or decommit the pages at the end of the reserved range
+            if (new_capacity > m_max_capacity)
+                return false;
+
+            u64 const reserved  = vmem_n::page_align((u64)m_max_capacity * m_sizeof);
+            u64 const committed = vmem_n::page_align((u64)m_capacity * m_sizeof);
+            u64       desired   = vmem_n::page_align((u64)new_capacity * m_sizeof);
+            if (desired > committed)
+            {
+                // commit at least twice the pages that are committed, so push_back does not end up doing
+                // a system call for every page
+                if (desired < committed * 2)
+                    desired = (committed * 2 < reserved) ? committed * 2 : reserved;
+                if (!vmem_n::commit((u8*)m_p + committed, desired - committed))
+                    return false;
+            }
+            else if (desired < committed)
+            {
+                vmem_n::decommit((u8*)m_p + desired, committed - desired);
+            }
+
+            // use all of the committed pages
+            u64 const capacity = desired / m_sizeof;
+            m_capacity         = (capacity < m_max_capacity) ? (u32)capacity : m_max_capacity;
         }
         else if (new_capacity > m_capacity)
         {
@@ -30,14 +106,24 @@ namespace ncore
             const uint_t desired_size = m_sizeof * new_capacity;
             {
                 void* new_p;
-                alloc_t* alloc = context_t::runtime_alloc();
                 if (m_p == nullptr)
                 {
-                    new_p = alloc->allocate(desired_size);
+                    new_p = m_alloc->allocate(desired_size);
+                }
+                else if (__is_inline() || relocate != nullptr)
+                {
+                    // spill the inline buffer to the heap, or move items that can not be moved by memcpy
+                    new_p = m_alloc->allocate(desired_size);
+                    if (new_p != nullptr)
+                    {
+                        __relocate(new_p, m_p, m_size, relocate);
+                        if (!__is_inline())
+                            m_alloc->deallocate(m_p);
+                    }
                 }
                 else
                 {
-                    new_p = reallocate(alloc, m_p, m_size, desired_size);
+                    new_p = reallocate(m_alloc, m_p, m_size * m_sizeof, desired_size);
                 }
 
                 if (!new_p)
@@ -52,86 +138,87 @@ namespace ncore
         }
         else
         {
-            // shrink
-            return false;
+            // shrink, move the items to a block of exactly 'new_capacity' items
+            void* new_p = m_alloc->allocate(m_sizeof * new_capacity);
+            if (!new_p)
+                return false;
+
+            __relocate(new_p, m_p, m_size, relocate);
+            m_alloc->deallocate(m_p);
+            m_p        = new_p;
+            m_capacity = new_capacity;
         }
         return true;
     }
 
-    void vector_base_t::__copy_range(void* dst, void* src, u32 n) {}
-
-    void vector_base_t::clear()
+    void vector_base_t::__relocate(void* dst, void* src, u32 n, relocate_fn_t relocate)
     {
-        if (m_p)
-        {
-            __set_capacity(0);
-            m_p        = nullptr;
-            m_size     = 0;
-            m_capacity = 0;
-        }
+        if (n == 0)
+            return;
+        if (relocate != nullptr)
+            relocate(dst, src, n);
+        else
+            nmem::memcpy(dst, src, m_sizeof * n);
     }
 
-    void vector_base_t::reserve(u32 new_capacity) { __set_capacity(new_capacity); }
-
-    // resize(0) sets the container to empty, but does not free the allocated block.
-    void vector_base_t::resize(u32 new_size)
+    // Releases our storage and takes over the storage of 'other', which is left empty. A heap block is
+    // taken over together with its allocator, items in an inline buffer are copied. A reserved range of
+    // virtual memory is copied as well when we have an inline buffer, since that buffer is then the
+    // storage for small sizes.
+    void vector_base_t::__move_from(vector_base_t& other, relocate_fn_t relocate)
     {
-        if (m_size != new_size)
+        ASSERT(this != &other && m_sizeof == other.m_sizeof);
+        __set_capacity(0);
+
+        bool const steal = !other.__is_inline() && (other.m_max_capacity == 0 || m_inline_capacity == 0);
+        if (steal)
         {
-            if (new_size < m_size) {}
-            else
+            if (m_inline_capacity == 0 || other.m_p != nullptr)
             {
-                if (new_size > m_capacity)
-                    __set_capacity(new_size);
+                m_p            = other.m_p;
+                m_capacity     = other.m_capacity;
+                m_max_capacity = other.m_max_capacity;
+                m_alloc        = other.m_alloc;
+                m_size         = other.m_size;
             }
-
-            m_size = new_size;
+            other.m_p            = (other.m_inline_capacity != 0) ? other.__inline_data() : nullptr;
+            other.m_size         = 0;
+            other.m_capacity     = other.m_inline_capacity;
+            other.m_max_capacity = 0;
+        }
+        else
+        {
+            if (other.m_size > 0)
+            {
+                __set_capacity(other.m_size, relocate);
+                __relocate(m_p, other.m_p, other.m_size, relocate);
+                m_size       = other.m_size;
+                other.m_size = 0;
+            }
+            other.__set_capacity(0);
         }
     }
 
-    void vector_base_t::__insert(u32 index, const void* p, u32 n)
-    {
-        ASSERT(index <= m_size);
-        if (!n)
-            return;
-
-        const u32 orig_size = m_size;
-        resize(m_size + n);
-
-        const u32 num_to_move = orig_size - index;
-
-        // This overwrites the destination object bits, but bitwise copyable means we don't need to worry about destruction.
-        x_memmove((u8*)m_p + (index + n) * m_sizeof, (u8*)m_p + index * m_sizeof, m_sizeof * num_to_move);
-
-        u8* pDst = (u8*)m_p + m_sizeof * index;
-
-        // This copies in the new bits, overwriting the existing objects, which is OK for copyable types that don't need destruction.
-        nmem::memcpy(pDst, p, m_sizeof * n);
-    }
-
-    void vector_base_t::__erase(u32 start, u32 n)
+    bool vector_base_t::reserve_virtual(u32 max_capacity)
     {
-        ASSERT((start + n) <= m_size);
-        if ((start + n) > m_size)
-            return;
-
-        if (!n)
-            return;
-
-        const u32 num_to_move = m_size - (start + n);
-
-        u8*       pDst = (u8*)m_p + start * m_sizeof;
-        const u8* pSrc = (u8*)m_p + (start + n) * m_sizeof;
+        ASSERT(m_p == nullptr && max_capacity > 0 && m_inline_capacity == 0);
+        if (m_p != nullptr || max_capacity == 0 || m_inline_capacity != 0)
+            return false;
 
-        // Copy "down" the objects to preserve, filling in the empty slots.
-        x_memmove(pDst, pSrc, num_to_move * m_sizeof);
+        void* p = vmem_n::reserve(vmem_n::page_align((u64)max_capacity * m_sizeof));
+        if (p == nullptr)
+            return false;
 
-        m_size -= n;
+        m_p            = p;
+        m_size         = 0;
+        m_capacity     = 0;
+        m_max_capacity = max_capacity;
+        return true;
     }
 
     bool vector_base_t::__is_equal(vector_base_t const* rhs) const
     {
-        if (m_size != rhs->m_size && m_sizeof != rhs->m_sizeof)
+        if (m_size != rhs->m_size || m_sizeof != rhs->m_sizeof)
             return false;
         if (m_size)
         {
@@ -144,19 +231,14 @@ namespace ncore
     {
         const u32 min_size = math::minimum(m_size, rhs->m_size);
 
-        const u8* pSrc     = (u8*)m_p;
-        const u8* pSrc_end = (u8*)m_p + min_size * m_sizeof;
-        const u8* pDst     = (u8*)rhs->m_p;
-
-        while ((pSrc < pSrc_end) && (x_memcmp(pSrc, pDst, m_sizeof) == 0))
+        if (min_size > 0)
         {
-            pSrc += m_sizeof;
-            pDst += m_sizeof;
+            // one compare over the common prefix, memcmp finds the first differing byte for us
+            s32 const c = x_memcmp(m_p, rhs->m_p, min_size * m_sizeof);
+            if (c != 0)
+                return c < 0 ? -1 : 1;
         }
 
-        if (pSrc < pSrc_end)
-            return x_memcmp(pSrc, pDst, m_sizeof);
-
         if (m_size < rhs->m_size)
             return -1;
         else if (m_size > rhs->m_size)
@@ -179,15 +261,22 @@ namespace ncore
 
     void* vector_base_t::__assume_ownership()
     {
+        // virtual memory and the inline buffer are not heap blocks that can be handed out,
+        // the caller deallocates the block it gets with allocator()
+        ASSERT(m_max_capacity == 0 && !__is_inline());
+        if (m_max_capacity != 0 || __is_inline())
+            return nullptr;
+
         void* p    = m_p;
-        m_p        = nullptr;
+        m_p        = (m_inline_capacity != 0) ? __inline_data() : nullptr;
         m_size     = 0;
-        m_capacity = 0;
+        m_capacity = m_inline_capacity;
         return p;
     }
 
     // Caller is granting ownership of the indicated heap block.
     // Block must have size constructed elements, and have enough room for capacity elements.
+    // Block must have been allocated from allocator(), it is deallocated there.
     bool vector_base_t::__grant_ownership(void* p, u32 sizeofitem, u32 size, u32 capacity)
     {
         // To to prevent the caller from obviously shooting themselves in the foot.
@@ -218,7 +307,7 @@ namespace ncore
             return false;
         }
 
-        clear();
+        __set_capacity(0);
         m_p        = p;
         m_size     = size;
         m_sizeof   = sizeofitem;
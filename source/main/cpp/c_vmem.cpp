@@ -0,0 +1,160 @@
+#include "ccore/c_target.h"
+
+#include "cbase/c_debug.h"
+#include "cgenerics/c_vmem.h"
+
+#if defined(_WIN32)
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include <stdio.h>
+
+namespace ncore
+{
+    namespace vmem_n
+    {
+#if defined(_WIN32)
+        u32 page_size()
+        {
+            static u32 s_page_size = 0;
+            if (s_page_size == 0)
+            {
+                SYSTEM_INFO info;
+                GetSystemInfo(&info);
+                s_page_size = (u32)info.dwPageSize;
+            }
+            return s_page_size;
+        }
+
+        void* reserve(u64 size) { return VirtualAlloc(nullptr, (SIZE_T)size, MEM_RESERVE, PAGE_NOACCESS); }
+        bool  commit(void* addr, u64 size) { return VirtualAlloc(addr, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) != nullptr; }
+        bool  decommit(void* addr, u64 size) { return VirtualFree(addr, (SIZE_T)size, MEM_DECOMMIT) != 0; }
+        void  release(void* addr, u64 size)
+        {
+            if (addr != nullptr)
+                VirtualFree(addr, 0, MEM_RELEASE);
+        }
+
+        void const* map_file(const char* path, u64& size)
+        {
+            size        = 0;
+            HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return nullptr;
+
+            void const*   addr = nullptr;
+            LARGE_INTEGER file_size;
+            if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+            {
+                HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (mapping != nullptr)
+                {
+                    addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                    CloseHandle(mapping);
+                    if (addr != nullptr)
+                        size = (u64)file_size.QuadPart;
+                }
+            }
+            CloseHandle(file);
+            return addr;
+        }
+
+        void unmap_file(void const* addr, u64 size)
+        {
+            if (addr != nullptr)
+                UnmapViewOfFile(addr);
+        }
+#else
+        u32 page_size()
+        {
+            static u32 s_page_size = 0;
+            if (s_page_size == 0)
+                s_page_size = (u32)sysconf(_SC_PAGESIZE);
+            return s_page_size;
+        }
+
+        // The range is mapped without access and without reserving swap, so it costs address space only
+        void* reserve(u64 size)
+        {
+            void* addr = mmap(nullptr, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            return addr == MAP_FAILED ? nullptr : addr;
+        }
+
+        bool commit(void* addr, u64 size) { return mprotect(addr, (size_t)size, PROT_READ | PROT_WRITE) == 0; }
+
+        // Give the pages back to the OS, they read as zero when committed again
+        bool decommit(void* addr, u64 size)
+        {
+            madvise(addr, (size_t)size, MADV_DONTNEED);
+            return mprotect(addr, (size_t)size, PROT_NONE) == 0;
+        }
+
+        void release(void* addr, u64 size)
+        {
+            if (addr != nullptr)
+                munmap(addr, (size_t)size);
+        }
+
+        void const* map_file(const char* path, u64& size)
+        {
+            size   = 0;
+            int fd = open(path, O_RDONLY);
+            if (fd < 0)
+                return nullptr;
+
+            void const* addr = nullptr;
+            struct stat st;
+            if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                void* p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    addr = p;
+                    size = (u64)st.st_size;
+                }
+            }
+            close(fd); // the mapping keeps the file open
+            return addr;
+        }
+
+        void unmap_file(void const* addr, u64 size)
+        {
+            if (addr != nullptr)
+                munmap((void*)addr, (size_t)size);
+        }
+#endif
+
+        bool write_file(const char* path, file_section_t const* sections, u32 num_sections)
+        {
+            FILE* file = fopen(path, "wb");
+            if (file == nullptr)
+                return false;
+
+            static u8 const zeros[64] = {0};
+
+            u64  pos = 0;
+            bool ok  = true;
+            for (u32 i = 0; ok && i < num_sections; ++i)
+            {
+                file_section_t const& section = sections[i];
+                ASSERT(pos <= section.m_offset);
+                while (ok && pos < section.m_offset)
+                {
+                    size_t const gap = (size_t)((section.m_offset - pos) < sizeof(zeros) ? (section.m_offset - pos) : sizeof(zeros));
+                    ok               = fwrite(zeros, 1, gap, file) == gap;
+                    pos += gap;
+                }
+                ok  = ok && fwrite(section.m_data, 1, (size_t)section.m_size, file) == (size_t)section.m_size;
+                pos = section.m_offset + section.m_size;
+            }
+            ok = (fclose(file) == 0) && ok;
+            return ok;
+        }
+    } // namespace vmem_n
+
+} // namespace ncore
@@ -0,0 +1,80 @@
+#ifndef __C_GENERICS_ARENA_ALLOC_H__
+#define __C_GENERICS_ARENA_ALLOC_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+
+namespace ncore
+{
+    // A bump allocator on a reserved range of virtual memory, allocate moves a pointer forward and commits
+    // pages when needed, deallocate does nothing. Everything that was allocated is dropped in one shot with
+    // reset() or rewind(mark), the committed pages are kept for the next round so a steady state workload
+    // makes no system calls at all. Containers that use an arena do not need to be destructed, growing a
+    // container leaves its old block behind until the arena is reset.
+    // An arena is not thread-safe, see frame_arena() for one arena per thread.
+    class arena_alloc_t : public alloc_t
+    {
+    public:
+        enum
+        {
+            cReserveBytes = 1 << 28, // default address space reserved per arena
+        };
+
+        arena_alloc_t(u64 reserve_bytes = cReserveBytes);
+        ~arena_alloc_t();
+
+        inline u64 mark() const { return m_used; }
+        inline u64 used() const { return m_used; }
+        inline u64 committed() const { return m_committed; }
+        inline u64 reserved() const { return m_reserved; }
+
+        // Drops everything that was allocated after 'mark'
+        void rewind(u64 mark);
+        void reset() { rewind(0); }
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_release(); // reset and decommit all pages
+
+    private:
+        arena_alloc_t(arena_alloc_t const&);            // not copyable
+        arena_alloc_t& operator=(arena_alloc_t const&); // not copyable
+
+        u8* m_base;
+        u64 m_reserved;
+        u64 m_committed;
+        u64 m_used;
+    };
+
+    // The arena of the calling thread, created on first use and destroyed when the thread exits.
+    // Per request containers allocate from it and a frame_scope_t drops them all at the end of the request.
+    arena_alloc_t* frame_arena();
+
+    // Rewinds the frame arena of this thread to where it was when the scope was entered
+    class frame_scope_t
+    {
+    public:
+        frame_scope_t()
+            : m_arena(frame_arena())
+            , m_mark(m_arena->mark())
+        {
+        }
+        ~frame_scope_t() { m_arena->rewind(m_mark); }
+
+        inline arena_alloc_t* arena() const { return m_arena; }
+
+    private:
+        frame_scope_t(frame_scope_t const&);            // not copyable
+        frame_scope_t& operator=(frame_scope_t const&); // not copyable
+
+        arena_alloc_t* m_arena;
+        u64            m_mark;
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_ARENA_ALLOC_H__
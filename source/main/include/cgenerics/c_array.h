@@ -0,0 +1,121 @@
+#ifndef __C_GENERICS_ARRAY_H__
+#define __C_GENERICS_ARRAY_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
+#include "cbase/c_memory.h"
+
+#include <new>
+
+namespace ncore
+{
+    // A drop-in for array_t<T> (create/destroy, size/cap_cur, set_size/set_capacity, get_item/set_item/add_item)
+    // that allocates its header and items from the allocator that is passed to create, nullptr means
+    // context_t::runtime_alloc(). With an arena allocator the memory is released together with the arena.
+    // When the allocator runs out of memory create returns nullptr and set_capacity returns false.
+    // T must be bitwise movable since the items are not constructed or destructed.
+    template <typename T> class heap_array_t
+    {
+    public:
+        static heap_array_t<T>* create(u32 size, u32 cap, alloc_t* allocator = nullptr)
+        {
+            if (allocator == nullptr)
+                allocator = context_t::runtime_alloc();
+
+            void* mem = allocator->allocate(sizeof(heap_array_t<T>));
+            if (mem == nullptr)
+                return nullptr;
+
+            heap_array_t<T>* a = new (mem) heap_array_t<T>();
+            a->m_alloc         = allocator;
+            if (!a->set_capacity(cap))
+            {
+                destroy(a);
+                return nullptr;
+            }
+            a->set_size(size);
+            return a;
+        }
+
+        static void destroy(heap_array_t<T>*& a)
+        {
+            if (a != nullptr)
+            {
+                alloc_t* allocator = a->m_alloc;
+                if (a->m_data != nullptr)
+                    allocator->deallocate(a->m_data);
+                allocator->deallocate(a);
+                a = nullptr;
+            }
+        }
+
+        inline u32      size() const { return m_size; }
+        inline u32      cap_cur() const { return m_cap; }
+        inline alloc_t* allocator() const { return m_alloc; }
+        inline void     set_size(u32 size)
+        {
+            ASSERT(size <= m_cap);
+            m_size = size;
+        }
+
+        inline T*   get_item(u32 i) const { return m_data + i; }
+        inline void set_item(u32 i, T const& item) { m_data[i] = item; }
+        inline void add_item(T const& item)
+        {
+            ASSERT(m_size < m_cap);
+            m_data[m_size++] = item;
+        }
+
+        // Moves the items to a block of exactly 'cap' items, the capacity can not drop below the size.
+        // Returns false when the block could not be allocated, the array is unchanged then.
+        bool set_capacity(u32 cap)
+        {
+            if (cap < m_size)
+                cap = m_size;
+            if (cap == m_cap)
+                return true;
+
+            T* data = nullptr;
+            if (cap > 0)
+            {
+                data = (T*)m_alloc->allocate((u32)(cap * sizeof(T)), cAlignment);
+                if (data == nullptr)
+                    return false;
+                if (m_size > 0)
+                    nmem::memcpy(data, m_data, m_size * sizeof(T));
+            }
+            if (m_data != nullptr)
+                m_alloc->deallocate(m_data);
+            m_data = data;
+            m_cap  = cap;
+            return true;
+        }
+
+    private:
+        enum
+        {
+            // cache line sized items (the ctrl groups) are cache line aligned
+            cAlignment = (sizeof(T) >= 64) ? 64 : 16,
+        };
+
+        heap_array_t()
+            : m_data(nullptr)
+            , m_alloc(nullptr)
+            , m_size(0)
+            , m_cap(0)
+        {
+        }
+
+        T*       m_data;
+        alloc_t* m_alloc;
+        u32      m_size;
+        u32      m_cap;
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_ARRAY_H__
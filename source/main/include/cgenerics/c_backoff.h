@@ -0,0 +1,49 @@
+#ifndef __C_GENERICS_BACKOFF_H__
+#define __C_GENERICS_BACKOFF_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "cbase/c_integer.h"
+#include "cgenerics/c_simd_search.h"
+
+#include <thread>
+
+namespace ncore
+{
+    // Spins a while with a pause hint, then gives the time slice away. Used by the spin locks and the
+    // lock-free queues while they wait for another thread, one instance per wait loop.
+    class backoff_t
+    {
+    public:
+        backoff_t()
+            : m_spin(0)
+        {
+        }
+
+        inline void wait()
+        {
+            if (++m_spin < cSpins)
+            {
+                simd_n::pause();
+            }
+            else
+            {
+                m_spin = 0;
+                std::this_thread::yield();
+            }
+        }
+
+    private:
+        enum
+        {
+            cSpins = 64
+        };
+
+        u32 m_spin;
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_BACKOFF_H__
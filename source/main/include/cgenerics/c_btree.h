@@ -0,0 +1,697 @@
+#ifndef __C_GENERICS_BTREE_H__
+#define __C_GENERICS_BTREE_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_debug.h"
+#include "cgenerics/c_pool_alloc.h"
+#include "cgenerics/c_simd_search.h"
+#include "cgenerics/c_vector.h"
+
+#include <new>
+#include <type_traits>
+
+namespace ncore
+{
+    namespace btree_n
+    {
+        // The value type of a btree_set_t
+        struct none_t
+        {
+        };
+
+        // The position of the first of 'n' sorted keys that is >= key, integer and floating point keys
+        // are scanned with SIMD compares (the nodes are a few cache lines, a linear scan of them beats a
+        // binary search), other keys are binary searched with operator<.
+        template <typename K, bool Arithmetic = std::is_arithmetic<K>::value> struct key_search_t
+        {
+            static inline u32 lower_bound(K const* keys, u32 n, K const& key)
+            {
+                u32 lo = 0;
+                while (n > 0)
+                {
+                    u32 const half = n >> 1;
+                    if (keys[lo + half] < key)
+                    {
+                        lo += half + 1;
+                        n -= half + 1;
+                    }
+                    else
+                    {
+                        n = half;
+                    }
+                }
+                return lo;
+            }
+        };
+
+        template <typename K> struct key_search_t<K, true>
+        {
+            static inline u32 lower_bound(K const* keys, u32 n, K const& key) { return simd_n::rank<K>(keys, n, key); }
+        };
+
+        // A B+ tree, the items are in the leaves and the leaves are linked in key order so a range is
+        // iterated without going back up the tree. A node is NodeBytes in size (a multiple of the cache
+        // line) and holds as many keys as fit. Key i of an inner node is the upper bound of the keys in
+        // child i, child i + 1 holds the keys that are larger.
+        // The nodes come from a pool_alloc_t, clear() gives them back at once.
+        template <typename K, typename V, u32 NodeBytes> class tree_t
+        {
+            static_assert(NodeBytes >= 64 && (NodeBytes % 64) == 0, "the node size must be a multiple of the cache line");
+
+            struct node_t
+            {
+                u16 m_count; // number of keys
+                u16 m_leaf;
+            };
+
+            enum
+            {
+                cLeafHeader  = sizeof(node_t) + 2 * sizeof(void*) + 8,
+                cInnerHeader = sizeof(node_t) + sizeof(void*) + 8,
+                cLeafFit     = (NodeBytes - cLeafHeader) / (sizeof(K) + sizeof(V)),
+                cInnerFit    = (NodeBytes - cInnerHeader) / (sizeof(K) + sizeof(void*)),
+                cLeafCap     = cLeafFit < 4 ? 4 : (cLeafFit > 0xffff ? 0xffff : cLeafFit),
+                cInnerCap    = cInnerFit < 4 ? 4 : (cInnerFit > 0xffff ? 0xffff : cInnerFit),
+                cLeafMin     = cLeafCap / 2,
+                cInnerMin    = cInnerCap / 2,
+                cMaxDepth    = 32,
+            };
+
+            struct leaf_t : public node_t
+            {
+                inline K* keys() { return (K*)m_keys; }
+                inline V* values() { return (V*)m_values; }
+
+                leaf_t*      m_prev;
+                leaf_t*      m_next;
+                alignas(K) u8 m_keys[cLeafCap * sizeof(K)];
+                alignas(V) u8 m_values[cLeafCap * sizeof(V)];
+            };
+
+            struct inner_t : public node_t
+            {
+                inline K* keys() { return (K*)m_keys; }
+
+                alignas(K) u8 m_keys[cInnerCap * sizeof(K)];
+                node_t*      m_children[cInnerCap + 1];
+            };
+
+            enum
+            {
+                cBlockSize = sizeof(leaf_t) > sizeof(inner_t) ? sizeof(leaf_t) : sizeof(inner_t),
+            };
+
+        public:
+            tree_t(alloc_t* allocator = nullptr)
+                : m_pool(cBlockSize, allocator)
+                , m_root(nullptr)
+                , m_first(nullptr)
+                , m_size(0)
+                , m_height(0)
+            {
+            }
+            ~tree_t() { clear(); }
+
+            inline u32  size() const { return m_size; }
+            inline bool empty() const { return m_size == 0; }
+            inline u32  height() const { return m_height; }
+            inline u32  nodes() const { return m_pool.used(); }
+
+            // Keys and values per node, with the node size that was chosen
+            static inline u32 leaf_capacity() { return cLeafCap; }
+            static inline u32 inner_capacity() { return cInnerCap; }
+
+            void clear()
+            {
+                if (!std::is_trivially_destructible<K>::value || !std::is_trivially_destructible<V>::value)
+                    destroy(m_root);
+                m_pool.release();
+                m_root   = nullptr;
+                m_first  = nullptr;
+                m_size   = 0;
+                m_height = 0;
+            }
+
+            class iterator
+            {
+            public:
+                iterator()
+                    : m_leaf(nullptr)
+                    , m_index(0)
+                {
+                }
+
+                const K& operator*() const { return m_leaf->keys()[m_index]; }
+
+                const K& first() const { return m_leaf->keys()[m_index]; }
+                V&       second() const { return m_leaf->values()[m_index]; }
+
+                iterator& operator++()
+                {
+                    if (++m_index == m_leaf->m_count)
+                    {
+                        m_leaf  = m_leaf->m_next;
+                        m_index = 0;
+                    }
+                    return *this;
+                }
+                iterator operator++(int)
+                {
+                    iterator i = *this;
+                    ++(*this);
+                    return i;
+                }
+
+                bool operator==(const iterator& other) const { return m_leaf == other.m_leaf && m_index == other.m_index; }
+                bool operator!=(const iterator& other) const { return m_leaf != other.m_leaf || m_index != other.m_index; }
+
+            protected:
+                friend class tree_t;
+                iterator(leaf_t* leaf, u32 index)
+                    : m_leaf(leaf)
+                    , m_index(index)
+                {
+                    // a position past the last key of a leaf is the first key of the next leaf
+                    if (m_leaf != nullptr && m_index == m_leaf->m_count)
+                    {
+                        m_leaf  = m_leaf->m_next;
+                        m_index = 0;
+                    }
+                }
+
+                leaf_t* m_leaf;
+                u32     m_index;
+            };
+
+            iterator begin() const { return iterator(m_first, 0); }
+            iterator end() const { return iterator(); }
+
+            // The first item with a key >= key, iterate from here for a range
+            iterator lower_bound(K const& key) const
+            {
+                if (m_root == nullptr)
+                    return end();
+                leaf_t* leaf = find_leaf(key);
+                return iterator(leaf, key_search_t<K>::lower_bound(leaf->keys(), leaf->m_count, key));
+            }
+
+            // The first item with a key > key
+            iterator upper_bound(K const& key) const
+            {
+                iterator i = lower_bound(key);
+                if (i != end() && !(key < i.first()))
+                    ++i;
+                return i;
+            }
+
+        protected:
+            V* find_value(K const& key) const
+            {
+                if (m_root == nullptr)
+                    return nullptr;
+                leaf_t*   leaf = find_leaf(key);
+                u32 const i    = key_search_t<K>::lower_bound(leaf->keys(), leaf->m_count, key);
+                if (i == leaf->m_count || key < leaf->keys()[i])
+                    return nullptr;
+                return &leaf->values()[i];
+            }
+
+            // Returns false when the key is already there, the value is then not changed
+            bool insert_value(K const& key, V const& value)
+            {
+                if (m_root == nullptr)
+                {
+                    leaf_t* leaf = new_leaf();
+                    m_root       = leaf;
+                    m_first      = leaf;
+                    m_height     = 1;
+                }
+
+                path_t  path;
+                leaf_t* leaf = find_leaf(key, path);
+                u32     i    = key_search_t<K>::lower_bound(leaf->keys(), leaf->m_count, key);
+                if (i < leaf->m_count && !(key < leaf->keys()[i]))
+                    return false;
+
+                m_size += 1;
+                if (leaf->m_count < cLeafCap)
+                {
+                    leaf_insert(leaf, i, key, value);
+                    return true;
+                }
+
+                // Split, appending to the last leaf leaves the full leaf as it is so ascending inserts
+                // fill the leaves completely, other inserts split in the middle
+                u32 const split = (i == leaf->m_count && leaf->m_next == nullptr) ? leaf->m_count : leaf->m_count / 2;
+                leaf_t*   right = new_leaf();
+                leaf_move(right, 0, leaf, split, leaf->m_count - split);
+                right->m_prev = leaf;
+                right->m_next = leaf->m_next;
+                if (leaf->m_next != nullptr)
+                    leaf->m_next->m_prev = right;
+                leaf->m_next = right;
+
+                if (i < split)
+                    leaf_insert(leaf, i, key, value);
+                else
+                    leaf_insert(right, i - split, key, value);
+
+                insert_child(path, path.m_depth, leaf->keys()[leaf->m_count - 1], right);
+                return true;
+            }
+
+            bool erase_value(K const& key)
+            {
+                if (m_root == nullptr)
+                    return false;
+
+                path_t    path;
+                leaf_t*   leaf = find_leaf(key, path);
+                u32 const i    = key_search_t<K>::lower_bound(leaf->keys(), leaf->m_count, key);
+                if (i == leaf->m_count || key < leaf->keys()[i])
+                    return false;
+
+                value_ops_t<K>::destroy(leaf->keys() + i, 1);
+                value_ops_t<V>::destroy(leaf->values() + i, 1);
+                value_ops_t<K>::relocate(leaf->keys() + i, leaf->keys() + i + 1, leaf->m_count - i - 1);
+                value_ops_t<V>::relocate(leaf->values() + i, leaf->values() + i + 1, leaf->m_count - i - 1);
+                leaf->m_count -= 1;
+                m_size -= 1;
+
+                if (path.m_depth == 0)
+                {
+                    if (leaf->m_count == 0)
+                    {
+                        m_pool.deallocate(leaf);
+                        m_root   = nullptr;
+                        m_first  = nullptr;
+                        m_height = 0;
+                    }
+                    return true;
+                }
+                if (leaf->m_count < cLeafMin)
+                    rebalance_leaf(path, leaf);
+                return true;
+            }
+
+            // 'keys' must be sorted ascending without duplicates. The leaves are filled completely (and
+            // evenly), a read-mostly tree is as small and as shallow as it can be.
+            void build_values(K const* keys, V const* values, u32 n)
+            {
+                clear();
+                if (n == 0)
+                    return;
+
+                vector_t<node_t*> levels[2];
+                vector_t<node_t*>* level   = &levels[0];
+                vector_t<node_t*>* parents = &levels[1];
+
+                u32 const         leaves = (n + cLeafCap - 1) / cLeafCap;
+                leaf_t*           prev   = nullptr;
+                for (u32 l = 0, i = 0; l < leaves; ++l)
+                {
+                    u32 const count = (u32)(((u64)(l + 1) * n) / leaves) - i;
+                    leaf_t*   leaf  = new_leaf();
+                    for (u32 j = 0; j < count; ++j, ++i)
+                    {
+                        ASSERT(i == 0 || keys[i - 1] < keys[i]);
+                        new (leaf->keys() + j) K(keys[i]);
+                        new (leaf->values() + j) V(values != nullptr ? values[i] : V());
+                    }
+                    leaf->m_count = (u16)count;
+                    leaf->m_prev  = prev;
+                    if (prev != nullptr)
+                        prev->m_next = leaf;
+                    else
+                        m_first = leaf;
+                    prev = leaf;
+                    level->push_back(leaf);
+                }
+                m_size   = n;
+                m_height = 1;
+
+                while (level->size() > 1)
+                {
+                    u32 const children = level->size();
+                    u32 const groups   = (children + cInnerCap) / (cInnerCap + 1);
+                    parents->clear();
+                    for (u32 g = 0, c = 0; g < groups; ++g)
+                    {
+                        u32 const count = (u32)(((u64)(g + 1) * children) / groups) - c;
+                        inner_t*  inner = new_inner();
+                        for (u32 j = 0; j < count; ++j, ++c)
+                        {
+                            inner->m_children[j] = level->at(c);
+                            if ((j + 1) < count)
+                                new (inner->keys() + j) K(max_key(level->at(c)));
+                        }
+                        inner->m_count = (u16)(count - 1);
+                        parents->push_back(inner);
+                    }
+                    vector_t<node_t*>* done = level;
+                    level                   = parents;
+                    parents                 = done;
+                    m_height += 1;
+                }
+                m_root = level->at(0);
+            }
+
+        private:
+            tree_t(tree_t const&);            // not copyable
+            tree_t& operator=(tree_t const&); // not copyable
+
+            // The inner nodes from the root down to a leaf and the child that was taken in each
+            struct path_t
+            {
+                path_t()
+                    : m_depth(0)
+                {
+                }
+
+                inner_t* m_nodes[cMaxDepth];
+                u32      m_index[cMaxDepth];
+                u32      m_depth;
+            };
+
+            inline leaf_t* new_leaf()
+            {
+                leaf_t* leaf  = (leaf_t*)m_pool.allocate(sizeof(leaf_t), 64);
+                leaf->m_count = 0;
+                leaf->m_leaf  = 1;
+                leaf->m_prev  = nullptr;
+                leaf->m_next  = nullptr;
+                return leaf;
+            }
+
+            inline inner_t* new_inner()
+            {
+                inner_t* inner = (inner_t*)m_pool.allocate(sizeof(inner_t), 64);
+                inner->m_count = 0;
+                inner->m_leaf  = 0;
+                return inner;
+            }
+
+            void destroy(node_t* node)
+            {
+                if (node == nullptr)
+                    return;
+                if (node->m_leaf)
+                {
+                    leaf_t* leaf = (leaf_t*)node;
+                    value_ops_t<K>::destroy(leaf->keys(), leaf->m_count);
+                    value_ops_t<V>::destroy(leaf->values(), leaf->m_count);
+                }
+                else
+                {
+                    inner_t* inner = (inner_t*)node;
+                    for (u32 i = 0; i <= inner->m_count; ++i)
+                        destroy(inner->m_children[i]);
+                    value_ops_t<K>::destroy(inner->keys(), inner->m_count);
+                }
+            }
+
+            inline leaf_t* find_leaf(K const& key) const
+            {
+                node_t* node = m_root;
+                while (!node->m_leaf)
+                {
+                    inner_t* inner = (inner_t*)node;
+                    node           = inner->m_children[key_search_t<K>::lower_bound(inner->keys(), inner->m_count, key)];
+                }
+                return (leaf_t*)node;
+            }
+
+            inline leaf_t* find_leaf(K const& key, path_t& path) const
+            {
+                node_t* node = m_root;
+                while (!node->m_leaf)
+                {
+                    inner_t*  inner           = (inner_t*)node;
+                    u32 const i               = key_search_t<K>::lower_bound(inner->keys(), inner->m_count, key);
+                    path.m_nodes[path.m_depth] = inner;
+                    path.m_index[path.m_depth] = i;
+                    path.m_depth += 1;
+                    node = inner->m_children[i];
+                }
+                return (leaf_t*)node;
+            }
+
+            static K const& max_key(node_t* node)
+            {
+                while (!node->m_leaf)
+                    node = ((inner_t*)node)->m_children[node->m_count];
+                return ((leaf_t*)node)->keys()[node->m_count - 1];
+            }
+
+            static void leaf_insert(leaf_t* leaf, u32 i, K const& key, V const& value)
+            {
+                value_ops_t<K>::relocate(leaf->keys() + i + 1, leaf->keys() + i, leaf->m_count - i);
+                value_ops_t<V>::relocate(leaf->values() + i + 1, leaf->values() + i, leaf->m_count - i);
+                new (leaf->keys() + i) K(key);
+                new (leaf->values() + i) V(value);
+                leaf->m_count += 1;
+            }
+
+            // Moves 'n' items of 'src' starting at 'from' to 'dst' at 'to', 'dst' must have room
+            static void leaf_move(leaf_t* dst, u32 to, leaf_t* src, u32 from, u32 n)
+            {
+                value_ops_t<K>::relocate(dst->keys() + to + n, dst->keys() + to, dst->m_count - to);
+                value_ops_t<V>::relocate(dst->values() + to + n, dst->values() + to, dst->m_count - to);
+                value_ops_t<K>::relocate(dst->keys() + to, src->keys() + from, n);
+                value_ops_t<V>::relocate(dst->values() + to, src->values() + from, n);
+                value_ops_t<K>::relocate(src->keys() + from, src->keys() + from + n, src->m_count - from - n);
+                value_ops_t<V>::relocate(src->values() + from, src->values() + from + n, src->m_count - from - n);
+                dst->m_count += (u16)n;
+                src->m_count -= (u16)n;
+            }
+
+            // Inserts key i and child i + 1
+            static void inner_insert(inner_t* inner, u32 i, K const& key, node_t* child)
+            {
+                value_ops_t<K>::relocate(inner->keys() + i + 1, inner->keys() + i, inner->m_count - i);
+                nmem::memmove(inner->m_children + i + 2, inner->m_children + i + 1, (inner->m_count - i) * sizeof(node_t*));
+                new (inner->keys() + i) K(key);
+                inner->m_children[i + 1] = child;
+                inner->m_count += 1;
+            }
+
+            // Removes key i and child i + 1
+            static void inner_remove(inner_t* inner, u32 i)
+            {
+                value_ops_t<K>::destroy(inner->keys() + i, 1);
+                value_ops_t<K>::relocate(inner->keys() + i, inner->keys() + i + 1, inner->m_count - i - 1);
+                nmem::memmove(inner->m_children + i + 1, inner->m_children + i + 2, (inner->m_count - i - 1) * sizeof(node_t*));
+                inner->m_count -= 1;
+            }
+
+            // A child at 'depth' was split, 'right' goes next to it with 'key' as the separator
+            void insert_child(path_t& path, u32 depth, K const& key, node_t* right)
+            {
+                // 'key' can live in the node that is about to be split
+                K const sep(key);
+
+                if (depth == 0)
+                {
+                    inner_t* root        = new_inner();
+                    root->m_children[0]  = m_root;
+                    root->m_count        = 0;
+                    inner_insert(root, 0, sep, right);
+                    m_root = root;
+                    m_height += 1;
+                    return;
+                }
+
+                inner_t*  inner = path.m_nodes[depth - 1];
+                u32 const i     = path.m_index[depth - 1];
+                if (inner->m_count < cInnerCap)
+                {
+                    inner_insert(inner, i, sep, right);
+                    return;
+                }
+
+                // Split around key 'mid', which moves up, appending keeps the left node full
+                u32 const mid   = (i == inner->m_count) ? inner->m_count - 1 : inner->m_count / 2;
+                inner_t*  upper = new_inner();
+                u32 const moved = inner->m_count - mid - 1;
+                value_ops_t<K>::relocate(upper->keys(), inner->keys() + mid + 1, moved);
+                nmem::memcpy(upper->m_children, inner->m_children + mid + 1, (moved + 1) * sizeof(node_t*));
+                upper->m_count = (u16)moved;
+
+                K const up(inner->keys()[mid]);
+                value_ops_t<K>::destroy(inner->keys() + mid, 1);
+                inner->m_count = (u16)mid;
+
+                if (i <= mid)
+                    inner_insert(inner, i, sep, right);
+                else
+                    inner_insert(upper, i - mid - 1, sep, right);
+
+                insert_child(path, depth - 1, up, upper);
+            }
+
+            // The leaf at the end of 'path' has too few items, take one from a sibling or merge with it
+            void rebalance_leaf(path_t& path, leaf_t* leaf)
+            {
+                inner_t*  parent = path.m_nodes[path.m_depth - 1];
+                u32 const i      = path.m_index[path.m_depth - 1];
+                leaf_t*   left   = i > 0 ? (leaf_t*)parent->m_children[i - 1] : nullptr;
+                leaf_t*   right  = i < parent->m_count ? (leaf_t*)parent->m_children[i + 1] : nullptr;
+
+                if (right != nullptr && right->m_count > cLeafMin)
+                {
+                    leaf_move(leaf, leaf->m_count, right, 0, 1);
+                    parent->keys()[i] = leaf->keys()[leaf->m_count - 1];
+                    return;
+                }
+                if (left != nullptr && left->m_count > cLeafMin)
+                {
+                    leaf_move(leaf, 0, left, left->m_count - 1, 1);
+                    parent->keys()[i - 1] = left->keys()[left->m_count - 1];
+                    return;
+                }
+
+                // merge into the left one of the pair, the right one goes
+                u32 sep = i;
+                if (right == nullptr)
+                {
+                    right = leaf;
+                    leaf  = left;
+                    sep   = i - 1;
+                }
+                leaf_move(leaf, leaf->m_count, right, 0, right->m_count);
+                leaf->m_next = right->m_next;
+                if (right->m_next != nullptr)
+                    right->m_next->m_prev = leaf;
+                m_pool.deallocate(right);
+
+                inner_remove(parent, sep);
+                path.m_depth -= 1;
+                rebalance_inner(path, parent);
+            }
+
+            void rebalance_inner(path_t& path, inner_t* inner)
+            {
+                if (path.m_depth == 0)
+                {
+                    // the root goes when it has a single child
+                    if (inner->m_count == 0)
+                    {
+                        m_root = inner->m_children[0];
+                        m_pool.deallocate(inner);
+                        m_height -= 1;
+                    }
+                    return;
+                }
+                if (inner->m_count >= cInnerMin)
+                    return;
+
+                inner_t*  parent = path.m_nodes[path.m_depth - 1];
+                u32 const i      = path.m_index[path.m_depth - 1];
+                inner_t*  left   = i > 0 ? (inner_t*)parent->m_children[i - 1] : nullptr;
+                inner_t*  right  = i < parent->m_count ? (inner_t*)parent->m_children[i + 1] : nullptr;
+
+                if (right != nullptr && right->m_count > cInnerMin)
+                {
+                    // rotate left, the separator comes down and the first key of 'right' goes up
+                    new (inner->keys() + inner->m_count) K(parent->keys()[i]);
+                    inner->m_children[inner->m_count + 1] = right->m_children[0];
+                    inner->m_count += 1;
+                    parent->keys()[i] = right->keys()[0];
+                    value_ops_t<K>::destroy(right->keys(), 1);
+                    value_ops_t<K>::relocate(right->keys(), right->keys() + 1, right->m_count - 1);
+                    nmem::memmove(right->m_children, right->m_children + 1, right->m_count * sizeof(node_t*));
+                    right->m_count -= 1;
+                    return;
+                }
+                if (left != nullptr && left->m_count > cInnerMin)
+                {
+                    // rotate right, the separator comes down and the last key of 'left' goes up
+                    value_ops_t<K>::relocate(inner->keys() + 1, inner->keys(), inner->m_count);
+                    nmem::memmove(inner->m_children + 1, inner->m_children, (inner->m_count + 1) * sizeof(node_t*));
+                    new (inner->keys()) K(parent->keys()[i - 1]);
+                    inner->m_children[0] = left->m_children[left->m_count];
+                    inner->m_count += 1;
+                    parent->keys()[i - 1] = left->keys()[left->m_count - 1];
+                    value_ops_t<K>::destroy(left->keys() + left->m_count - 1, 1);
+                    left->m_count -= 1;
+                    return;
+                }
+
+                // merge into the left one of the pair with the separator in between
+                u32 sep = i;
+                if (right == nullptr)
+                {
+                    right = inner;
+                    inner = left;
+                    sep   = i - 1;
+                }
+                new (inner->keys() + inner->m_count) K(parent->keys()[sep]);
+                value_ops_t<K>::relocate(inner->keys() + inner->m_count + 1, right->keys(), right->m_count);
+                nmem::memcpy(inner->m_children + inner->m_count + 1, right->m_children, (right->m_count + 1) * sizeof(node_t*));
+                inner->m_count += (u16)(right->m_count + 1);
+                m_pool.deallocate(right);
+
+                inner_remove(parent, sep);
+                path.m_depth -= 1;
+                rebalance_inner(path, parent);
+            }
+
+            pool_alloc_t m_pool;
+            node_t*      m_root;
+            leaf_t*      m_first;
+            u32          m_size;
+            u32          m_height;
+        };
+
+    } // namespace btree_n
+
+    // An ordered map on a cache line tuned B+ tree, see btree_n::tree_t. Besides lookups it answers
+    // ordered and range queries:
+    //     for (iter_t i = map.lower_bound(lo); i != map.end() && i.first() < hi; ++i) ...
+    // K needs operator<, K and V are moved around in the nodes so they have to be movable. Inserting and
+    // erasing invalidates the iterators and the value pointers.
+    template <typename K, typename V, u32 NodeBytes = 256> class btree_map_t : public btree_n::tree_t<K, V, NodeBytes>
+    {
+        typedef btree_n::tree_t<K, V, NodeBytes> tree;
+
+    public:
+        btree_map_t(alloc_t* allocator = nullptr)
+            : tree(allocator)
+        {
+        }
+
+        inline V*   find(K const& key) const { return tree::find_value(key); }
+        inline bool contains(K const& key) const { return tree::find_value(key) != nullptr; }
+        inline bool insert(K const& key, V const& value) { return tree::insert_value(key, value); }
+        inline bool erase(K const& key) { return tree::erase_value(key); }
+
+        // Replaces the content with 'n' items, 'keys' must be sorted ascending without duplicates
+        inline void build_from(K const* keys, V const* values, u32 n) { tree::build_values(keys, values, n); }
+    };
+
+    // An ordered set on a cache line tuned B+ tree, see btree_map_t
+    template <typename K, u32 NodeBytes = 256> class btree_set_t : public btree_n::tree_t<K, btree_n::none_t, NodeBytes>
+    {
+        typedef btree_n::tree_t<K, btree_n::none_t, NodeBytes> tree;
+
+    public:
+        btree_set_t(alloc_t* allocator = nullptr)
+            : tree(allocator)
+        {
+        }
+
+        inline bool contains(K const& key) const { return tree::find_value(key) != nullptr; }
+        inline bool insert(K const& key) { return tree::insert_value(key, btree_n::none_t()); }
+        inline bool erase(K const& key) { return tree::erase_value(key); }
+
+        // Replaces the content with 'n' keys, 'keys' must be sorted ascending without duplicates
+        inline void build_from(K const* keys, u32 n) { tree::build_values(keys, nullptr, n); }
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_BTREE_H__
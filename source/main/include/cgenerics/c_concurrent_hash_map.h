@@ -0,0 +1,263 @@
+#ifndef __C_GENERICS_CONTAINERS_CONCURRENT_HASH_MAP_H__
+#define __C_GENERICS_CONTAINERS_CONCURRENT_HASH_MAP_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "cgenerics/c_backoff.h"
+#include "cgenerics/c_flat_hash_map.h"
+
+#include <atomic>
+#include <new>
+
+namespace ncore
+{
+    namespace flat_hashmap_n
+    {
+        // Reader-writer spin lock, readers share the lock, a writer waits until all readers have left.
+        // A waiting writer sets the pending bit so that new readers back off and the writer cannot starve.
+        class rwlock_t
+        {
+        public:
+            rwlock_t()
+                : m_state(0)
+            {
+            }
+
+            void lock_shared()
+            {
+                backoff_t backoff;
+                while (true)
+                {
+                    u32 state = m_state.load(std::memory_order_relaxed);
+                    if ((state & (cWriter | cPending)) == 0)
+                    {
+                        if (m_state.compare_exchange_weak(state, state + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                            return;
+                    }
+                    backoff.wait();
+                }
+            }
+            void unlock_shared() { m_state.fetch_sub(1, std::memory_order_release); }
+
+            void lock()
+            {
+                backoff_t backoff;
+                while (true)
+                {
+                    u32 state = m_state.load(std::memory_order_relaxed);
+                    if ((state & ~cPending) == 0)
+                    {
+                        if (m_state.compare_exchange_weak(state, cWriter, std::memory_order_acquire, std::memory_order_relaxed))
+                            return;
+                    }
+                    else if ((state & cPending) == 0)
+                    {
+                        m_state.fetch_or(cPending, std::memory_order_relaxed);
+                    }
+                    backoff.wait();
+                }
+            }
+            void unlock() { m_state.store(0, std::memory_order_release); }
+
+        private:
+            enum
+            {
+                cWriter  = 0x80000000,
+                cPending = 0x40000000,
+            };
+
+            std::atomic<u32> m_state;
+        };
+
+        // A hash map that can be used from multiple threads. Keys are routed by the top bits of their hash
+        // to one of (1 << ShardBits) independent hashmap_t shards, each shard has its own reader-writer lock.
+        // The inner hashmap_t uses the low bits of the hash (H1/H2), so the shard bits do not correlate
+        // with the group or fingerprint of a key.
+        template <typename Key, typename Value, typename Hasher = DefaultHash<Key>, u32 ShardBits = 4> class concurrent_hashmap_t
+        {
+        public:
+            typedef hashmap_t<Key, Value, Hasher> map_t;
+
+            enum
+            {
+                cNumShards = 1 << ShardBits,
+                cChunkSize = 256 // keys that the batch functions sort by shard at a time
+            };
+
+            // 'size' is the initial capacity for the whole map, it is divided over the shards.
+            // The shards allocate from 'allocator' in parallel, so it has to be thread-safe.
+            concurrent_hashmap_t(u32 size = 64 * cNumShards, alloc_t* allocator = nullptr)
+            {
+                for (u32 s = 0; s < cNumShards; ++s)
+                    new (&m_shards[s].m_map) map_t(size / cNumShards, false, allocator);
+            }
+
+            // Calls 'fn(const Value&)' under the shard lock when 'key' is present
+            template <typename Fn> bool find(Key const& key, Fn fn)
+            {
+                shard_t&      shard = shard_of(key);
+                shared_lock_t lock(shard.m_lock);
+                Value const*  value = shard.map().find(key);
+                if (value == nullptr)
+                    return false;
+                fn(*value);
+                return true;
+            }
+
+            bool insert(Key const& key, Value const& value)
+            {
+                shard_t&         shard = shard_of(key);
+                exclusive_lock_t lock(shard.m_lock);
+                return shard.map().insert(key, value);
+            }
+
+            bool erase(Key const& key)
+            {
+                shard_t&         shard = shard_of(key);
+                exclusive_lock_t lock(shard.m_lock);
+                return shard.map().erase(key);
+            }
+
+            u32 size()
+            {
+                u32 size = 0;
+                for (u32 s = 0; s < cNumShards; ++s)
+                {
+                    shared_lock_t lock(m_shards[s].m_lock);
+                    size += m_shards[s].map().size();
+                }
+                return size;
+            }
+
+            // Batched functions, the keys are sorted by shard and every shard lock is taken once per
+            // chunk of keys instead of once per key.
+
+            // Calls 'fn(u32 index, const Value* value)' for every key, value is nullptr when not present
+            template <typename Fn> void find_batch(Key const* keys, u32 n, Fn fn)
+            {
+                for_each_shard(keys, n, false, [&](map_t& map, u32 i) { fn(i, (Value const*)map.find(keys[i])); });
+            }
+
+            // Returns the number of keys that were inserted
+            u32 insert_batch(Key const* keys, Value const* values, u32 n)
+            {
+                u32 count = 0;
+                for_each_shard(keys, n, true, [&](map_t& map, u32 i) { count += map.insert(keys[i], values[i]) ? 1 : 0; });
+                return count;
+            }
+
+            // Returns the number of keys that were erased
+            u32 erase_batch(Key const* keys, u32 n)
+            {
+                u32 count = 0;
+                for_each_shard(keys, n, true, [&](map_t& map, u32 i) { count += map.erase(keys[i]) ? 1 : 0; });
+                return count;
+            }
+
+        private:
+            struct shared_lock_t
+            {
+                shared_lock_t(rwlock_t& lock)
+                    : m_lock(lock)
+                {
+                    m_lock.lock_shared();
+                }
+                ~shared_lock_t() { m_lock.unlock_shared(); }
+                rwlock_t& m_lock;
+            };
+
+            struct exclusive_lock_t
+            {
+                exclusive_lock_t(rwlock_t& lock)
+                    : m_lock(lock)
+                {
+                    m_lock.lock();
+                }
+                ~exclusive_lock_t() { m_lock.unlock(); }
+                rwlock_t& m_lock;
+            };
+
+            // The lock and the map of a shard, aligned to a cache-line so that shards do not share
+            // cache-lines with each other.
+            struct alignas(64) shard_t
+            {
+                shard_t() {}
+                ~shard_t() { map().~map_t(); }
+
+                map_t& map() { return m_map; }
+
+                rwlock_t m_lock;
+                union
+                {
+                    map_t m_map;
+                };
+            };
+            static_assert(sizeof(shard_t) % 64 == 0, "a shard has to fill whole cache-lines");
+
+            static inline u32 shard_index(u64 hash) { return (u32)(hash >> (64 - ShardBits)); }
+
+            inline shard_t& shard_of(Key const& key)
+            {
+                Hasher hasher;
+                return m_shards[shard_index(hasher(&key))];
+            }
+
+            // Counting sort each chunk of keys by shard, then visit every shard that has keys once
+            template <typename Fn> void for_each_shard(Key const* keys, u32 n, bool exclusive, Fn fn)
+            {
+                Hasher hasher;
+                u16    shards[cChunkSize];
+                u16    order[cChunkSize];
+                u32    offsets[cNumShards + 1];
+                for (u32 c = 0; c < n; c += cChunkSize)
+                {
+                    u32 const cn = (n - c) < (u32)cChunkSize ? (n - c) : (u32)cChunkSize;
+
+                    for (u32 s = 0; s <= cNumShards; ++s)
+                        offsets[s] = 0;
+                    for (u32 i = 0; i < cn; ++i)
+                    {
+                        shards[i] = (u16)shard_index(hasher(&keys[c + i]));
+                        offsets[shards[i] + 1] += 1;
+                    }
+                    for (u32 s = 0; s < cNumShards; ++s)
+                        offsets[s + 1] += offsets[s];
+                    for (u32 i = 0; i < cn; ++i)
+                        order[offsets[shards[i]]++] = (u16)i;
+
+                    // 'offsets[s]' is now the end of shard 's' in 'order'
+                    u32 begin = 0;
+                    for (u32 s = 0; s < cNumShards; ++s)
+                    {
+                        u32 const end = offsets[s];
+                        if (begin == end)
+                            continue;
+
+                        shard_t& shard = m_shards[s];
+                        if (exclusive)
+                            shard.m_lock.lock();
+                        else
+                            shard.m_lock.lock_shared();
+
+                        for (u32 o = begin; o < end; ++o)
+                            fn(shard.map(), c + order[o]);
+
+                        if (exclusive)
+                            shard.m_lock.unlock();
+                        else
+                            shard.m_lock.unlock_shared();
+                        begin = end;
+                    }
+                }
+            }
+
+            shard_t m_shards[cNumShards];
+        };
+
+    } // namespace flat_hashmap_n
+
+} // namespace ncore
+
+#endif // __C_GENERICS_CONTAINERS_CONCURRENT_HASH_MAP_H__
@@ -7,10 +7,32 @@
 
 #include "ccore/c_allocator.h"
 #include "cbase/c_debug.h"
-#include "cbase/c_darray.h"
 #include "cbase/c_hash.h"
 #include "cbase/c_integer.h"
 #include "cbase/c_memory.h"
+#include "cgenerics/c_array.h"
+#include "cgenerics/c_simd_search.h"
+#include "cgenerics/c_vmem.h"
+
+#include <type_traits>
+
+// The group match can be vectorized, the implementation is chosen at compile time depending on
+// the instruction set that the compiler is targetting, see CGENERICS_SIMD_SSE2/AVX2 in c_simd_search.h.
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#    include <intrin.h>
+#    pragma intrinsic(_umul128)
+#endif
+
+// Define CGENERICS_FLAT_HASHMAP_STATS to have hashmap_t count probe lengths, fingerprint matches
+// and resizes, see hashmap_stats_t. Without it the counters do not exist and the code that
+// updates them compiles away.
+#if defined(CGENERICS_FLAT_HASHMAP_STATS)
+#    include <chrono>
+#    define CGENERICS_FLAT_HASHMAP_STAT(expr) expr
+#else
+#    define CGENERICS_FLAT_HASHMAP_STAT(expr)
+#endif
 
 namespace ncore
 {
@@ -64,7 +86,84 @@ namespace ncore
         inline u64  H1(u64 hash, const void* unique_stable_ptr) { return (hash >> 8) /*^ hash_seed(unique_stable_ptr)*/; }
         inline h2_t H2(u64 hash) { return hash & 0xFF; }
 
-        class ctrl_t
+        // Item reference policies, they determine how many bytes a ctrl group spends on
+        // referencing the items in the dense key/value arrays and thus the maximum number
+        // of items a hashmap can hold.
+
+        // This is 4 bytes (max 4 billion elements) per ref, 128 bytes
+        struct ref32_t
+        {
+            static const u32 cMaxItems = 0xffffffff;
+
+            u32         m_refs[32];
+            inline u32  get(s8 i) const { return m_refs[i]; }
+            inline void set(u32 item_index, s8 i) { m_refs[i] = item_index; }
+            inline void prefetch(s8 i) const { simd_n::prefetch(&m_refs[i]); }
+            inline void clear()
+            {
+                for (s8 i = 0; i < 32; ++i)
+                    m_refs[i] = 0xDEADDEAD;
+            }
+        };
+
+        // This is 3 bytes (max 16 million elements) per ref, 96 bytes
+        struct ref24_t
+        {
+            static const u32 cMaxItems = 0x1000000;
+
+            u8          m_refs_h[32];
+            u16         m_refs_l[32];
+            inline u32  get(s8 i) const { return (u32)m_refs_l[i] | ((u32)m_refs_h[i] << 16); }
+            inline void prefetch(s8 i) const
+            {
+                simd_n::prefetch(&m_refs_l[i]);
+                simd_n::prefetch(&m_refs_h[i]);
+            }
+            inline void set(u32 item_index, s8 i)
+            {
+                ASSERT(item_index < cMaxItems);
+                m_refs_l[i] = (u16)(item_index & 0xFFFF);
+                m_refs_h[i] = (u8)(item_index >> 16);
+            }
+            inline void clear()
+            {
+                for (s8 i = 0; i < 32; ++i)
+                    set(0xDEADDE, i);
+            }
+        };
+
+        // This is 2.5 bytes (max 1 million elements) per ref, 80 bytes
+        struct ref20_t
+        {
+            static const u32 cMaxItems = 0x100000;
+
+            u8          m_refs_h[16];
+            u16         m_refs_l[32];
+            inline u32  get(s8 i) const { return (u32)m_refs_l[i] | ((u32)((m_refs_h[i >> 1] >> ((i & 1) * 4)) & 0xF) << 16); }
+            inline void prefetch(s8 i) const
+            {
+                simd_n::prefetch(&m_refs_l[i]);
+                simd_n::prefetch(&m_refs_h[i >> 1]);
+            }
+            inline void set(u32 item_index, s8 i)
+            {
+                ASSERT(item_index < cMaxItems);
+                m_refs_l[i]      = (u16)(item_index & 0xFFFF);
+                u8 const nibble  = (u8)((item_index >> 16) & 0xF);
+                s8 const shift   = ((i & 1) * 4);
+                u8 const mask    = (u8)(0xF0 >> shift);
+                m_refs_h[i >> 1] = (u8)((m_refs_h[i >> 1] & mask) | (nibble << shift));
+            }
+            inline void clear()
+            {
+                for (s8 i = 0; i < 32; ++i)
+                    set(0xDEADD, i);
+            }
+        };
+
+        // The metadata of a group, the empty/deleted bitmaps and the H2 fingerprints, this is all
+        // that a probe needs to reject a group or to find candidate slots.
+        class ctrl_meta_t
         {
         public:
             enum
@@ -83,60 +182,22 @@ namespace ncore
                 u8  m_hash_B8[cWidth];
             };
 
-            // You could easily make 3 bytes (max 16 million elements) per ref as follows:
-            //     // 96 bytes
-            //     u8          m_refs_h[32];
-            //     u16         m_refs_l[32];
-            //     inline u32  get_ref(s8 i) const { return (u32)m_refs_l[i] | ((u32)m_refs_l[i] << 16); }
-            //     inline void set_ref(u32 item_index, s8 i)
-            //     {
-            //         m_refs_l[i] = (item_index & 0xFFFF);
-            //         m_refs_h[i] = (u8)(item_index >> 16);
-            //     }
-            //     inline u32 replace_ref(u32 item_index, s8 i)
-            //     {
-            //         u32 const old_item = get_ref(i);
-            //         set_ref(item_index, i);
-            //         return old_item;
-            //     }
-
-            // Or even 2.5 bytes (max 1 million elements) per ref as follows:
-            //     // 80 bytes
-            //     u8          m_refs_h[16];
-            //     u16         m_refs_l[32];
-            //     inline u32  get_ref(s8 i) const { return (u32)m_refs_l[i] | ((u32)((m_refs_l[i >> 1] >> ((i & 1) * 4)) & 0xF) << 16); }
-            //     inline void set_ref(u32 item_index, s8 i)
-            //     {
-            //         m_refs_l[i]     = (item_index & 0xFFFF);
-            //         u8 const nibble = (u8)((item_index >> 16) & 0xF;
-            //         s8 const shift = ((i&1)*4);
-            //         u8 const mask = 0xF << shift;
-            //         m_refs_h[i>>1] = (m_refs_h[i>>1] & mask) | (nibble << shift);
-            //     }
-            //     inline u32 replace_ref(u32 item_index, s8 i)
-            //     {
-            //         u32 const old_item = get_ref(i);
-            //         set_ref(item_index, i);
-            //         return old_item;
-            //     }
-
-            // This is 4 bytes (max 4 billion elements) per ref
-
-            // 128 bytes
-            u32         m_refs[cWidth];
-            inline u32  get_ref(s8 i) const { return m_refs[i]; }
-            inline void set_ref(u32 item_index, s8 i) { m_refs[i] = item_index; }
-            inline u32  replace_ref(u32 item_index, s8 i)
-            {
-                u32 const old_item = m_refs[i];
-                m_refs[i]          = item_index;
-                return old_item;
-            }
-
             void set_hash(h2_t hash, s8 const i) { m_hash_B8[i] = hash; }
             h2_t get_hash(s8 const i) const { return m_hash_B8[i]; }
             u32  match(h2_t hash, u32 mask) const
             {
+#if defined(CGENERICS_SIMD_AVX2)
+                return match_avx2(hash, mask);
+#elif defined(CGENERICS_SIMD_SSE2)
+                return match_sse2(hash, mask);
+#else
+                return match_scalar(hash, mask);
+#endif
+            }
+
+            // Portable fallback, only visits the slots that are part of 'mask'
+            u32 match_scalar(h2_t hash, u32 mask) const
+            {
                 bitmask_t bitmask(mask);
                 for (s8 i : bitmask)
                 {
@@ -146,6 +207,29 @@ namespace ncore
                 return mask;
             }
 
+#if defined(CGENERICS_SIMD_SSE2)
+            // Compares all 32 H2 bytes using two 16-byte compares
+            u32 match_sse2(h2_t hash, u32 mask) const
+            {
+                __m128i const h  = _mm_set1_epi8((char)hash);
+                __m128i const lo = _mm_loadu_si128((__m128i const*)&m_hash_B8[0]);
+                __m128i const hi = _mm_loadu_si128((__m128i const*)&m_hash_B8[16]);
+                u32 const     ml = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(lo, h));
+                u32 const     mh = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(hi, h));
+                return (ml | (mh << 16)) & mask;
+            }
+#endif
+
+#if defined(CGENERICS_SIMD_AVX2)
+            // Compares all 32 H2 bytes using a single 32-byte compare
+            u32 match_avx2(h2_t hash, u32 mask) const
+            {
+                __m256i const h = _mm256_set1_epi8((char)hash);
+                __m256i const v = _mm256_loadu_si256((__m256i const*)&m_hash_B8[0]);
+                return (u32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, h)) & mask;
+            }
+#endif
+
             // Note; Maybe we should changed m_deleted into m_used?
 
             inline bool is_full() const { return (m_empty | m_deleted) == 0; }
@@ -186,11 +270,64 @@ namespace ncore
                 m_deleted = 0;
                 for (s8 i = 0; i < cWidth / 4; ++i)
                     m_hash_DW[i] = 0;
-                for (s8 i = 0; i < cWidth; ++i)
-                    m_refs[i] = 0xDEADDEAD;
             }
         };
 
+        // Packed layout, the metadata and the item references of a group in one block
+        template <typename Refs> class ctrl_group_t : public ctrl_meta_t
+        {
+        public:
+            // Item references, see the ref policies above for the size of each
+            Refs        m_refs;
+            inline u32  get_ref(s8 i) const { return m_refs.get(i); }
+            inline void set_ref(u32 item_index, s8 i) { m_refs.set(item_index, i); }
+            inline u32  replace_ref(u32 item_index, s8 i)
+            {
+                u32 const old_item = m_refs.get(i);
+                m_refs.set(item_index, i);
+                return old_item;
+            }
+
+            void clear()
+            {
+                ctrl_meta_t::clear();
+                m_refs.clear();
+            }
+        };
+
+        // Split layout, only the metadata of a group padded to a full cache-line, the item
+        // references are stored in a separate array and are only touched on a H2 match.
+        class ctrl_line_t : public ctrl_meta_t
+        {
+        public:
+            u8 m_padding[64 - sizeof(ctrl_meta_t)];
+        };
+
+        typedef ctrl_group_t<ref32_t> ctrl_t;
+        typedef ctrl_group_t<ref24_t> ctrl24_t;
+        typedef ctrl_group_t<ref20_t> ctrl20_t;
+
+        // Layout policies, they determine where the item references of a group are stored.
+
+        // Packed, the item references are part of the ctrl group in 'm_ctrls'
+        template <typename Refs> struct layout_packed_t
+        {
+            typedef ctrl_group_t<Refs> group_t;
+            static const bool          cSplit = false;
+            template <typename Ctrls, typename RefArray> static inline Refs* refs(Ctrls* ctrls, RefArray* refs, u32 offset) { return &ctrls->get_item(offset)->m_refs; }
+            static inline Refs const*  refs(group_t const* ctrls, Refs const* refs, u32 offset) { return &ctrls[offset].m_refs; }
+        };
+
+        // Split, 'm_ctrls' only holds the cache-line sized metadata, the item references are in 'm_refs'.
+        // A probe that rejects a group now only touches a single cache-line.
+        template <typename Refs> struct layout_split_t
+        {
+            typedef ctrl_line_t group_t;
+            static const bool   cSplit = true;
+            template <typename Ctrls, typename RefArray> static inline Refs* refs(Ctrls* ctrls, RefArray* refs, u32 offset) { return refs->get_item(offset); }
+            static inline Refs const* refs(group_t const* ctrls, Refs const* refs, u32 offset) { return &refs[offset]; }
+        };
+
         class probe_t
         {
         public:
@@ -227,6 +364,72 @@ namespace ncore
             u64 probe_length;
         };
 
+        // The statistics of a hashmap_t, the probe length is the number of groups visited - 1.
+        // - m_hits, m_misses and m_inserts are histograms of the probe length of successful lookups,
+        //   failed lookups and inserts, the last entry also counts all longer probes.
+        // - m_h2_matches counts the slots whose fingerprint (H2) matched and where the key had to be
+        //   compared, m_h2_false_matches counts the ones where the key turned out to be different.
+        // - m_tombstones, m_full_groups and m_groups are a snapshot of the table taken by hashmap_t::stats.
+        // The counters are plain integers, lookups that run concurrently (concurrent_hashmap_t readers)
+        // make them approximate.
+        struct hashmap_stats_t
+        {
+            enum
+            {
+                cHistogramSize = 16
+            };
+
+            u64 m_hits[cHistogramSize];
+            u64 m_misses[cHistogramSize];
+            u64 m_inserts[cHistogramSize];
+            u64 m_h2_matches;
+            u64 m_h2_false_matches;
+            u64 m_resizes;
+            u64 m_resize_ns; // total time spent in resize
+            u32 m_tombstones;
+            u32 m_full_groups; // groups without an empty slot, a probe has to continue past them
+            u32 m_groups;
+
+            void reset()
+            {
+                for (u32 i = 0; i < cHistogramSize; ++i)
+                {
+                    m_hits[i]    = 0;
+                    m_misses[i]  = 0;
+                    m_inserts[i] = 0;
+                }
+                m_h2_matches       = 0;
+                m_h2_false_matches = 0;
+                m_resizes          = 0;
+                m_resize_ns        = 0;
+                m_tombstones       = 0;
+                m_full_groups      = 0;
+                m_groups           = 0;
+            }
+
+            static inline void record(u64* histogram, u64 probe_length) { histogram[probe_length < (cHistogramSize - 1) ? probe_length : (cHistogramSize - 1)] += 1; }
+
+            f64 h2_false_match_rate() const { return m_h2_matches == 0 ? 0.0 : (f64)m_h2_false_matches / (f64)m_h2_matches; }
+            f64 full_group_ratio() const { return m_groups == 0 ? 0.0 : (f64)m_full_groups / (f64)m_groups; }
+        };
+
+#if defined(CGENERICS_FLAT_HASHMAP_STATS)
+        // Counts a resize and adds the time until it goes out of scope to the resize time
+        struct hashmap_resize_timer_t
+        {
+            hashmap_resize_timer_t(hashmap_stats_t& stats)
+                : m_stats(stats)
+                , m_start(std::chrono::steady_clock::now())
+            {
+                m_stats.m_resizes += 1;
+            }
+            ~hashmap_resize_timer_t() { m_stats.m_resize_ns += (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count(); }
+
+            hashmap_stats_t&                      m_stats;
+            std::chrono::steady_clock::time_point m_start;
+        };
+#endif
+
         // 64 bit Fowler/Noll/Vo FNV-1a hash
         inline u64 FNV1A64(const u8* bp, s32 numbytes, u32 seed)
         {
@@ -240,14 +443,146 @@ namespace ncore
             return hash64;
         }
 
+        // Every hasher has a unique cId, it is stored in a persisted hashmap so that a file is only
+        // opened with the hasher that built it. Persisted hash values have to be the same in every
+        // process, so hashers must not use a per-process seed.
         template <typename Key> class Fnv1aHash
         {
         public:
+            enum
+            {
+                cId = 1
+            };
             inline u64 operator()(const Key* key) const { return FNV1A64((u8 const*)key, sizeof(Key), 981039); }
         };
 
-        template <typename Key, typename Value, typename Hasher = Fnv1aHash<Key>> class hashmap_t
+        // 64x64 -> 128 bit multiply, folded back to 64 bit by xor-ing the high and low halves.
+        // Every bit of the input affects the low bits of the result, which is where H2 lives.
+        inline u64 fold_mul(u64 a, u64 b)
+        {
+#if defined(__SIZEOF_INT128__)
+            __uint128_t const r = (__uint128_t)a * b;
+            return (u64)r ^ (u64)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            u64       hi;
+            u64 const lo = _umul128(a, b, &hi);
+            return lo ^ hi;
+#else
+            u64 const a_lo = (u32)a, a_hi = a >> 32;
+            u64 const b_lo = (u32)b, b_hi = b >> 32;
+            u64 const ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+            u64 const mid = (ll >> 32) + (u32)lh + (u32)hl;
+            u64 const lo  = (mid << 32) | (u32)ll;
+            u64 const hi  = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+            return lo ^ hi;
+#endif
+        }
+
+        inline u64 read_u64(const u8* p)
+        {
+            u64 v;
+            nmem::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline u32 read_u32(const u8* p)
+        {
+            u32 v;
+            nmem::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        const u64 cHashSeed0 = 0xa0761d6478bd642fULL;
+        const u64 cHashSeed1 = 0xe7037ed1a0b428dbULL;
+        const u64 cHashSeed2 = 0x8ebc6af09c88c6e3ULL;
+
+        // Hasher for 4 and 8 byte keys (integers, pointers, small PODs), a single folded multiply.
+        // The key is on both sides of the multiply, multiplying by a constant leaves too much
+        // structure in the hash for strided keys.
+        template <typename Key> class IntHash
+        {
+        public:
+            enum
+            {
+                cId = 2
+            };
+            inline u64 operator()(const Key* key) const
+            {
+                u64 const k = (sizeof(Key) == 8) ? read_u64((u8 const*)key) : (u64)read_u32((u8 const*)key);
+                return fold_mul(k ^ cHashSeed0, k ^ cHashSeed1);
+            }
+        };
+
+        // wyhash style hasher for POD keys of any size, consumes 16 bytes per folded multiply
+        inline u64 WYHASH64(const u8* bp, u32 numbytes, u64 seed)
+        {
+            u64 h = seed ^ cHashSeed0;
+            u32 n = numbytes;
+            while (n > 16)
+            {
+                h = fold_mul(read_u64(bp) ^ cHashSeed1, read_u64(bp + 8) ^ h);
+                bp += 16;
+                n -= 16;
+            }
+
+            u64 a, b;
+            if (n >= 8)
+            {
+                a = read_u64(bp);
+                b = read_u64(bp + n - 8);
+            }
+            else if (n >= 4)
+            {
+                a = read_u32(bp);
+                b = read_u32(bp + n - 4);
+            }
+            else if (n > 0)
+            {
+                a = ((u64)bp[0] << 16) | ((u64)bp[n >> 1] << 8) | bp[n - 1];
+                b = 0;
+            }
+            else
+            {
+                a = b = 0;
+            }
+            return fold_mul(cHashSeed2 ^ numbytes, fold_mul(a ^ cHashSeed1, b ^ h));
+        }
+
+        template <typename Key> class WyHash
+        {
+        public:
+            enum
+            {
+                cId = 3
+            };
+            inline u64 operator()(const Key* key) const { return WYHASH64((u8 const*)key, sizeof(Key), 981039); }
+        };
+
+        // The default hasher is chosen by the size of the key, use Fnv1aHash<Key> explicitly if
+        // you need the FNV-1a hash values.
+        template <typename Key, u32 Size = sizeof(Key)> class DefaultHash : public WyHash<Key>
+        {
+        };
+        template <typename Key> class DefaultHash<Key, 4> : public IntHash<Key>
+        {
+        };
+        template <typename Key> class DefaultHash<Key, 8> : public IntHash<Key>
+        {
+        };
+
+        // The Refs policy (ref32_t, ref24_t or ref20_t) selects the size of the item references
+        // in each ctrl group, a smaller ref reduces the memory footprint of the ctrl array but
+        // also caps the number of items that the hashmap can hold.
+        // The Layout policy (layout_packed_t or layout_split_t) selects if the item references are
+        // stored together with the group metadata or in their own array.
+        // The Array policy selects the storage of the ctrls, keys and values, heap_array_t (heap) or
+        // vmem_array_t (virtual memory, growing never copies the existing keys and values). The arrays
+        // are created with create(size, cap, alloc_t*) so that they use the allocator of the hashmap.
+        template <typename Key, typename Value, typename Hasher = DefaultHash<Key>, typename Refs = ref32_t, template <typename> class Layout = layout_packed_t, template <typename> class Array = heap_array_t> class hashmap_t
         {
+            typedef Layout<Refs>               layout_t;
+            typedef typename layout_t::group_t group_t;
+
             inline probe_t probe(u64 hash, u64 capacity) const { return probe_t(H1(hash, m_ctrls), capacity); }
 
             // We have separated the ctrls, keys and values into their own array. This has multiple reasons, one
@@ -255,63 +590,303 @@ namespace ncore
             // them. Secondly since the index of the key and value will also match the index of the ctrl, this
             // means that we do not need to store any indices or pointers to the key/value.
 
-            array_t<ctrl_t>* m_ctrls;
-            array_t<Key>*    m_keys;
-            array_t<Value>*  m_values;
-            u32              m_size;
-            u32              m_capacity; // number of elements == (m_capacity + 1) * ctrl_t::cWidth
-            u32              m_growth_left;
+            Array<group_t>* m_ctrls;
+            Array<Refs>*    m_refs; // only used by the split layout
+            Array<Key>*     m_keys;
+            Array<Value>*   m_values;
+            Array<u32>*     m_locs; // optional, item index -> (group << 5) | slot
+            u32             m_size;
+            u32             m_capacity; // number of elements == (m_capacity + 1) * group_t::cWidth
+            u32             m_growth_left;
+
+            // Incremental rehash, the table we are migrating from
+            Array<group_t>* m_old_ctrls;
+            Array<Refs>*    m_old_refs;
+            u32             m_old_capacity;
+            u32             m_migrate_group;  // next group of the old table to migrate
+            u32             m_migrate_step;   // groups to migrate per insert/erase, 0 = stop-the-world resize
+
+            // Incremental rehash, the table we are going to migrate to is cleared ahead of time and the
+            // dense arrays are grown by copying their items over a number of inserts/erases, see prepare.
+            // Items [m_prev_copied, m_prev_end) are not copied yet and still live in the previous arrays.
+            Array<group_t>* m_next_ctrls;
+            Array<Refs>*    m_next_refs;
+            u32             m_next_cleared; // groups of the next table that are cleared
+            Array<Key>*     m_prev_keys;
+            Array<Value>*   m_prev_values;
+            Array<u32>*     m_prev_locs;
+            u32             m_prev_copied;
+            u32             m_prev_end;
+            u32             m_shrink_percent; // auto shrink when an erase drops the occupancy below this, 0 = off
+            alloc_t*        m_alloc;          // all arrays are allocated from here
+
+#if defined(CGENERICS_FLAT_HASHMAP_STATS)
+            mutable hashmap_stats_t m_stats;
+#endif
 
         public:
-            // User expects capacity to be in the number of elements
-            hashmap_t(u32 size = 64)
+            // User expects capacity to be in the number of elements.
+            // With 'backrefs' enabled the map keeps 4 extra bytes per item that hold the group
+            // and slot of each item, this makes erase O(1) since the moved tail item does not
+            // have to be rehashed and probed for, it also allows resize to rehash in item order.
+            // All memory comes from 'allocator' (nullptr = context_t::runtime_alloc()), a map that uses
+            // an arena allocator can be dropped together with the arena without calling the destructor.
+            hashmap_t(u32 size = 64, bool backrefs = false, alloc_t* allocator = nullptr)
             {
-                u32 const n = normalize_capacity(size / ctrl_t::cWidth) + 1;
-                m_ctrls     = array_t<ctrl_t>::create(n, n);
-                m_keys      = array_t<Key>::create(0, n * ctrl_t::cWidth);
-                m_values    = array_t<Value>::create(0, n * ctrl_t::cWidth);
+                m_alloc     = allocator != nullptr ? allocator : context_t::runtime_alloc();
+                u32 const n = normalize_capacity(size / group_t::cWidth) + 1;
+                m_ctrls     = Array<group_t>::create(n, n, m_alloc);
+                m_refs      = layout_t::cSplit ? Array<Refs>::create(n, n, m_alloc) : nullptr;
+                m_keys      = Array<Key>::create(0, n * group_t::cWidth, m_alloc);
+                m_values    = Array<Value>::create(0, n * group_t::cWidth, m_alloc);
+                m_locs      = backrefs ? Array<u32>::create(0, n * group_t::cWidth, m_alloc) : nullptr;
                 m_size      = 0;
                 m_capacity  = n - 1;
                 reset_growth_left();
                 clear_ctrls(0, n);
+
+                m_old_ctrls      = nullptr;
+                m_old_refs       = nullptr;
+                m_old_capacity   = 0;
+                m_migrate_group  = 0;
+                m_migrate_step   = 0;
+                m_next_ctrls     = nullptr;
+                m_next_refs      = nullptr;
+                m_next_cleared   = 0;
+                m_prev_keys      = nullptr;
+                m_prev_values    = nullptr;
+                m_prev_locs      = nullptr;
+                m_prev_copied    = 0;
+                m_prev_end       = 0;
+                m_shrink_percent = 0;
+                CGENERICS_FLAT_HASHMAP_STAT(m_stats.reset());
+            }
+            // Without this overload 'hashmap_t m(1024, &arena)' would convert the pointer to 'backrefs'
+            hashmap_t(u32 size, alloc_t* allocator)
+                : hashmap_t(size, false, allocator)
+            {
+            }
+
+            ~hashmap_t()
+            {
+                migrate(0xffffffff);
+                finish_prepare();
+                Array<group_t>::destroy(m_ctrls);
+                if (m_refs != nullptr)
+                    Array<Refs>::destroy(m_refs);
+                Array<Key>::destroy(m_keys);
+                Array<Value>::destroy(m_values);
+                if (m_locs != nullptr)
+                    Array<u32>::destroy(m_locs);
             }
 
             bool empty() const { return !size(); }
             u32  size() const { return m_size; }
             u32  capacity() const { return m_capacity; }
-            u32  max_size() const { return (0x7fffffff); }
-            void reset_growth_left() { growth_left() = (size_to_grow((capacity() + 1) * ctrl_t::cWidth) - m_size); }
+
+            alloc_t* allocator() const { return m_alloc; }
+            u32  max_size() const { return (Refs::cMaxItems < 0x7fffffff) ? Refs::cMaxItems : 0x7fffffff; }
+            void reset_growth_left() { growth_left() = (size_to_grow((capacity() + 1) * group_t::cWidth) - m_size); }
             u32& growth_left() { return m_growth_left; }
 
+            // Incremental rehash; when 'groups_per_op' is not 0 growing the table does not rehash all
+            // items at once, instead every insert and erase migrates up to 'groups_per_op' groups from
+            // the old table to the new table. Lookups consult both tables while migrating.
+            // The new table and the larger key/value arrays are prepared in the same small steps while
+            // the current table fills up, so no single insert touches all items.
+            // Setting it back to 0 finishes any migration that is in progress.
+            void set_incremental_rehash(u32 groups_per_op)
+            {
+                m_migrate_step = groups_per_op;
+                if (groups_per_op == 0)
+                    complete_growth();
+            }
+            bool is_rehashing() const { return m_old_ctrls != nullptr; }
+
+            // Makes room for 'n' items, inserting up to 'n' items will not grow the table.
+            // Returns false when the memory could not be allocated.
+            bool reserve(u32 n)
+            {
+                complete_growth();
+                u32 const capacity = capacity_for(n);
+                if (capacity > m_capacity)
+                    return resize(capacity);
+                return true;
+            }
+
+            // Shrinks the table and the key/value arrays to the smallest size that holds the current
+            // items, the memory that is not needed anymore is returned to the allocator.
+            void shrink_to_fit()
+            {
+                complete_growth();
+                u32 const capacity = capacity_for(m_size);
+                if (capacity < m_capacity)
+                    shrink(capacity);
+            }
+
+            // Auto shrink; when an erase leaves less than 'percent'% of the slots in use the table shrinks
+            // to a size where it is at most half full. The gap between this threshold and the 7/8 at which
+            // the table grows is the hysteresis that stops a map from shrinking and growing back and forth.
+            // 0 (the default) disables it, 10 is a sensible value.
+            void set_auto_shrink(u32 percent)
+            {
+                ASSERT(percent <= 20);
+                m_shrink_percent = percent;
+            }
+
             Value* find(const Key& key)
             {
                 Hasher     hasher;
                 u64 const  chash = hasher(&key);
                 findinfo_t cfi   = find_internal(key, chash);
                 if (cfi.offset < 0)
-                    return nullptr;
-                ctrl_t const* cctrl       = m_ctrls->get_item(cfi.offset);
-                u32 const     entry_index = cctrl->get_ref(cfi.index);
-                return m_values->get_item(entry_index);
+                {
+                    if (!is_rehashing())
+                    {
+                        CGENERICS_FLAT_HASHMAP_STAT(hashmap_stats_t::record(m_stats.m_misses, cfi.probe_length));
+                        return nullptr;
+                    }
+                    cfi = find_internal_old(key, chash);
+                    if (cfi.offset < 0)
+                    {
+                        CGENERICS_FLAT_HASHMAP_STAT(hashmap_stats_t::record(m_stats.m_misses, cfi.probe_length));
+                        return nullptr;
+                    }
+                    CGENERICS_FLAT_HASHMAP_STAT(hashmap_stats_t::record(m_stats.m_hits, cfi.probe_length));
+                    return value_at(old_refs(cfi.offset)->get(cfi.index));
+                }
+                CGENERICS_FLAT_HASHMAP_STAT(hashmap_stats_t::record(m_stats.m_hits, cfi.probe_length));
+                u32 const entry_index = get_ref(cfi.offset, cfi.index);
+                return value_at(entry_index);
+            }
+
+            // Looks up 'n' keys, 'out[i]' receives the value of 'keys[i]' or nullptr when not found.
+            // The keys are processed in small batches and each lookup is split into stages, every
+            // stage issues the prefetch for the next stage of all the keys in the batch. This way
+            // the cache misses on the ctrl groups, refs and keys of different lookups overlap.
+            void find_batch(const Key* keys, u32 n, Value** out)
+            {
+                if (is_rehashing())
+                {
+                    // Keys can be in either table, do them one by one until the migration is done
+                    for (u32 i = 0; i < n; ++i)
+                        out[i] = find(keys[i]);
+                    return;
+                }
+
+                Hasher hasher;
+                u64    hashes[cBatchSize];
+                u32    matches[cBatchSize];
+                u32    items[cBatchSize];
+                for (u32 b = 0; b < n; b += cBatchSize)
+                {
+                    Key const* bkeys = keys + b;
+                    Value**    bout  = out + b;
+                    u32 const  bn    = (n - b) < (u32)cBatchSize ? (n - b) : (u32)cBatchSize;
+
+                    // Stage 1: hash the keys and prefetch their first ctrl group
+                    for (u32 i = 0; i < bn; ++i)
+                    {
+                        hashes[i] = hasher(&bkeys[i]);
+                        simd_n::prefetch(m_ctrls->get_item(probe(hashes[i], m_capacity).offset()));
+                    }
+
+                    // Stage 2: match the fingerprints and prefetch the ref of the first candidate
+                    for (u32 i = 0; i < bn; ++i)
+                    {
+                        u32 const      offset = probe(hashes[i], m_capacity).offset();
+                        group_t const* ctrl   = m_ctrls->get_item(offset);
+                        matches[i]            = ctrl->match(H2(hashes[i]), ctrl->get_used());
+                        if (matches[i] != 0)
+                            refs(offset)->prefetch(math::findFirstBit(matches[i]));
+                    }
+
+                    // Stage 3: read the ref of the first candidate and prefetch its key and value
+                    for (u32 i = 0; i < bn; ++i)
+                    {
+                        if (matches[i] == 0)
+                            continue;
+                        u32 const offset = probe(hashes[i], m_capacity).offset();
+                        items[i]         = get_ref(offset, math::findFirstBit(matches[i]));
+                        simd_n::prefetch(key_at(items[i]));
+                        simd_n::prefetch(value_at(items[i]));
+                    }
+
+                    // Stage 4: compare the keys, lookups that are not resolved by the first
+                    // group (rare at our load factor) continue with a regular probe.
+                    for (u32 i = 0; i < bn; ++i)
+                    {
+                        bout[i] = nullptr;
+                        if (matches[i] != 0)
+                        {
+                            CGENERICS_FLAT_HASHMAP_STAT(m_stats.m_h2_matches += 1);
+                            if (bkeys[i] == *key_at(items[i]))
+                            {
+                                CGENERICS_FLAT_HASHMAP_STAT(hashmap_stats_t::record(m_stats.m_hits, 0));
+                                bout[i] = value_at(items[i]);
+                                continue;
+                            }
+                            CGENERICS_FLAT_HASHMAP_STAT(m_stats.m_h2_false_matches += 1);
+                        }
+
+                        u32 const      offset  = probe(hashes[i], m_capacity).offset();
+                        group_t const* ctrl    = m_ctrls->get_item(offset);
+                        bitmask_t      bitmask = matches[i] & (matches[i] - 1);
+                        for (s8 s : bitmask)
+                        {
+                            u32 const item = get_ref(offset, s);
+                            CGENERICS_FLAT_HASHMAP_STAT(m_stats.m_h2_matches += 1);
+                            if (bkeys[i] == *key_at(item))
+                            {
+                                bout[i] = value_at(item);
+                                break;
+                            }
+                            CGENERICS_FLAT_HASHMAP_STAT(m_stats.m_h2_false_matches += 1);
+                        }
+                        if (bout[i] == nullptr && !ctrl->has_empty())
+                        {
+                            findinfo_t const fi = find_internal(bkeys[i], hashes[i]);
+                            if (fi.offset >= 0)
+                                bout[i] = value_at(get_ref(fi.offset, fi.index));
+                            CGENERICS_FLAT_HASHMAP_STAT(hashmap_stats_t::record(fi.offset >= 0 ? m_stats.m_hits : m_stats.m_misses, fi.probe_length));
+                        }
+                        else
+                        {
+                            CGENERICS_FLAT_HASHMAP_STAT(hashmap_stats_t::record(bout[i] != nullptr ? m_stats.m_hits : m_stats.m_misses, 0));
+                        }
+                    }
+                }
             }
 
             bool insert(Key const& key, Value const& value)
             {
+                migrate(m_migrate_step);
+                prepare(m_migrate_step);
+
                 Hasher     hasher;
                 u64 const  hash    = hasher(&key);
                 findinfo_t current = find_internal(key, hash);
                 if (current.offset >= 0)
                     return false;
+                if (is_rehashing() && find_internal_old(key, hash).offset >= 0)
+                    return false;
+
+                // The item index has to fit in the ref of the ctrl group
+                if (m_size >= max_size())
+                    return false;
 
                 findinfo_t target = find_first_non_used(hash, m_capacity);
                 if (growth_left() == 0 && !is_deleted(target.offset, target.index))
                 {
-                    rehash_and_grow_if_necessary();
+                    // Out of memory, the map is left as it was
+                    if (!rehash_and_grow_if_necessary())
+                        return false;
                     target = find_first_non_used(hash, m_capacity);
                 }
                 m_size++;
                 ASSERT(target.offset >= 0 && target.index >= 0);
                 growth_left() -= is_empty(target.offset, target.index);
+                CGENERICS_FLAT_HASHMAP_STAT(hashmap_stats_t::record(m_stats.m_inserts, target.probe_length));
 
                 // What to do when the keys and values arrays have no
                 // room left to add an item? Increase the capacity?
@@ -320,6 +895,8 @@ namespace ncore
                 u32 const item_index = m_keys->size();
                 m_keys->add_item(key);
                 m_values->add_item(value);
+                if (m_locs != nullptr)
+                    m_locs->add_item(loc(target.offset, target.index));
                 set_ctrl(target, H2(hash), item_index);
                 return true;
             }
@@ -329,35 +906,80 @@ namespace ncore
                 if (empty())
                     return false;
 
-                // current or 'c' element
-                Hasher           hasher;
-                u64 const        chash = hasher(&key);
-                findinfo_t const cfi   = find_internal(key, chash);
-                if (cfi.offset < 0)
-                    return false;
-                ctrl_t* cctrl = m_ctrls->get_item(cfi.offset);
-                cctrl->set_deleted(cfi.index);
+                migrate(m_migrate_step);
+                prepare(m_migrate_step);
 
-                u32 const cei = cctrl->get_ref(cfi.index);
+                // current or 'c' element, while rehashing it can still be in the old table
+                Hasher     hasher;
+                u64 const  chash = hasher(&key);
+                findinfo_t cfi   = find_internal(key, chash);
+                Refs*      crefs = nullptr;
+                if (cfi.offset >= 0)
+                {
+                    m_ctrls->get_item(cfi.offset)->set_deleted(cfi.index);
+                    crefs = refs(cfi.offset);
+                }
+                else
+                {
+                    if (!is_rehashing())
+                        return false;
+                    cfi = find_internal_old(key, chash);
+                    if (cfi.offset < 0)
+                        return false;
+                    m_old_ctrls->get_item(cfi.offset)->set_deleted(cfi.index);
+                    crefs = old_refs(cfi.offset);
+                }
+
+                u32 const cei = crefs->get(cfi.index);
                 u32 const ei  = m_keys->size() - 1;
                 if (cei != ei)
                 {
-                    // end of 'e' element
-                    u64 const        ehash = hasher(m_keys->get_item(ei));
-                    findinfo_t const efi   = find_internal(*m_keys->get_item(ei), ehash);
-                    ASSERT(efi.offset >= 0 && efi.index >= 0);
-                    ctrl_t* ectrl = m_ctrls->get_item(efi.offset);
-
-                    // Update the reference on the 'e' element
-                    ectrl->set_ref(cei, efi.index);
+                    if (m_locs != nullptr)
+                    {
+                        // The location of the 'e' element is known, directly update its reference
+                        u32 const eloc = *loc_at(ei);
+                        if (is_old_loc(ei, eloc))
+                            old_refs(loc_offset(eloc))->set(cei, loc_index(eloc));
+                        else
+                            set_ref(cei, loc_offset(eloc), loc_index(eloc));
+                        *loc_at(cei) = eloc;
+                    }
+                    else
+                    {
+                        // end of 'e' element
+                        u64 const  ehash = hasher(key_at(ei));
+                        findinfo_t efi   = find_internal(*key_at(ei), ehash);
+                        if (efi.offset >= 0)
+                        {
+                            // Update the reference on the 'e' element
+                            set_ref(cei, efi.offset, efi.index);
+                        }
+                        else
+                        {
+                            efi = find_internal_old(*key_at(ei), ehash);
+                            ASSERT(efi.offset >= 0 && efi.index >= 0);
+                            old_refs(efi.offset)->set(cei, efi.index);
+                        }
+                    }
 
                     // Set current key/value with last key/value
-                    m_keys->set_item(cei, *m_keys->get_item(ei));
-                    m_values->set_item(cei, *m_values->get_item(ei));
+                    *key_at(cei)   = *key_at(ei);
+                    *value_at(cei) = *value_at(ei);
                 }
                 m_keys->set_size(ei);
                 m_values->set_size(ei);
+                if (m_locs != nullptr)
+                    m_locs->set_size(ei);
+                if (m_prev_end > ei)
+                    m_prev_end = ei; // items from 'ei' on are erased, nothing left to copy there
                 m_size--;
+
+                if (m_shrink_percent != 0 && !is_rehashing() && m_capacity > 1 && ((u64)m_size * 100) < ((u64)(m_capacity + 1) * group_t::cWidth * m_shrink_percent))
+                {
+                    u32 const capacity = capacity_for(m_size * 2);
+                    if (capacity < m_capacity)
+                        shrink(capacity);
+                }
                 return true;
             }
 
@@ -365,23 +987,21 @@ namespace ncore
             {
             public:
                 iterator()
-                    : m_keys(nullptr)
-                    , m_values(nullptr)
+                    : m_map(nullptr)
                     , m_index(0)
                 {
                 }
                 iterator(iterator const& i)
-                    : m_keys(i.m_keys)
-                    , m_values(i.m_values)
+                    : m_map(i.m_map)
                     , m_index(i.m_index)
                 {
                 }
 
-                const Key& operator*() const { return *m_keys->get_item(m_index); }
-                const Key& operator->() const { return *m_keys->get_item(m_index); }
+                const Key& operator*() const { return *m_map->key_at(m_index); }
+                const Key& operator->() const { return *m_map->key_at(m_index); }
 
-                const Key&   first() const { return *m_keys->get_item(m_index); }
-                const Value& second() const { return *m_values->get_item(m_index); }
+                const Key&   first() const { return *m_map->key_at(m_index); }
+                const Value& second() const { return *m_map->value_at(m_index); }
 
                 iterator& operator++()
                 {
@@ -396,50 +1016,45 @@ namespace ncore
                 }
 
                 bool operator<(const iterator& other) const { return m_index < other.m_index; }
-                bool operator==(const iterator& other) const { return m_keys == other.m_keys && m_values == other.m_values && m_index == other.m_index; }
-                bool operator!=(const iterator& other) const { return m_keys != other.m_keys || m_values != other.m_values || m_index != other.m_index; }
+                bool operator==(const iterator& other) const { return m_map == other.m_map && m_index == other.m_index; }
+                bool operator!=(const iterator& other) const { return m_map != other.m_map || m_index != other.m_index; }
 
             protected:
                 friend class hashmap_t;
-                iterator(array_t<Key>* keys, array_t<Value>* values, u32 index = 0)
-                    : m_keys(keys)
-                    , m_values(values)
+                iterator(hashmap_t* map, u32 index = 0)
+                    : m_map(map)
                     , m_index(index)
                 {
                 }
 
-                array_t<Key>*   m_keys;
-                array_t<Value>* m_values;
-                u32             m_index;
+                hashmap_t* m_map;
+                u32        m_index;
             };
 
             class const_iterator
             {
             public:
                 const_iterator()
-                    : m_keys(nullptr)
-                    , m_values(nullptr)
+                    : m_map(nullptr)
                     , m_index(0)
                 {
                 }
                 const_iterator(const const_iterator& i)
-                    : m_keys(i.m_keys)
-                    , m_values(i.m_values)
+                    : m_map(i.m_map)
                     , m_index(i.m_index)
                 {
                 }
                 const_iterator(iterator i)
-                    : m_keys(i.m_keys)
-                    , m_values(i.m_values)
+                    : m_map(i.m_map)
                     , m_index(i.m_index)
                 {
                 }
 
-                Key const& operator*() const { return *m_keys->get_item(m_index); }
-                Key const& operator->() const { return *m_keys->get_item(m_index); }
+                Key const& operator*() const { return *m_map->key_at(m_index); }
+                Key const& operator->() const { return *m_map->key_at(m_index); }
 
-                Key const&   first() const { return *m_keys->get_item(m_index); }
-                Value const& second() const { return *m_values->get_item(m_index); }
+                Key const&   first() const { return *m_map->key_at(m_index); }
+                Value const& second() const { return *m_map->value_at(m_index); }
 
                 const_iterator& operator++()
                 {
@@ -454,30 +1069,136 @@ namespace ncore
                 }
 
                 bool operator<(const const_iterator& other) const { return m_index < other.m_index; }
-                bool operator==(const const_iterator& other) const { return m_keys == other.m_keys && m_values == other.m_values && m_index == other.m_index; }
-                bool operator!=(const const_iterator& other) const { return m_keys != other.m_keys || m_values != other.m_values || m_index != other.m_index; }
+                bool operator==(const const_iterator& other) const { return m_map == other.m_map && m_index == other.m_index; }
+                bool operator!=(const const_iterator& other) const { return m_map != other.m_map || m_index != other.m_index; }
 
             protected:
                 friend class hashmap_t;
-                const_iterator(const array_t<Key>* keys, const array_t<Value>* values, u32 index = 0)
-                    : m_keys(keys)
-                    , m_values(values)
+                const_iterator(hashmap_t const* map, u32 index = 0)
+                    : m_map(map)
                     , m_index(index)
                 {
                 }
 
-                array_t<Key> const*   m_keys;
-                array_t<Value> const* m_values;
-                u32                   m_index;
+                hashmap_t const* m_map;
+                u32              m_index;
             };
 
-            iterator begin() { return iterator(m_keys, m_values); }
-            iterator end() { return iterator(m_keys, m_values, m_keys->size()); }
+            // The iterators read the items through the map, while the dense arrays are being grown
+            // (see prepare) an item can be in either the previous or the current array.
+            iterator begin() { return iterator(this); }
+            iterator end() { return iterator(this, m_size); }
+
+            const_iterator begin() const { return const_iterator(this); }
+            const_iterator end() const { return const_iterator(this, m_size); }
+
+            // Fills 'histogram[0..n)' with the number of items per probe length (the number of groups
+            // visited before the item was found - 1), the last entry also counts all longer probes.
+            void probe_length_histogram(u32* histogram, u32 n) const
+            {
+                for (u32 i = 0; i < n; ++i)
+                    histogram[i] = 0;
+
+                Hasher hasher;
+                for (u32 item = 0; item < m_size; ++item)
+                {
+                    Key const& key  = *key_at(item);
+                    u64 const  hash = hasher(&key);
+                    findinfo_t fi   = find_internal(key, hash);
+                    if (fi.offset < 0)
+                        fi = find_internal_old(key, hash);
+                    ASSERT(fi.offset >= 0);
+                    u64 const pl = fi.probe_length < (n - 1) ? fi.probe_length : (n - 1);
+                    histogram[pl] += 1;
+                }
+            }
 
-            const_iterator begin() const { return const_iterator(m_keys, m_values); }
-            const_iterator end() const { return const_iterator(m_keys, m_values, m_keys->size()); }
+#if defined(CGENERICS_FLAT_HASHMAP_STATS)
+            // The counters since construction (or reset_stats) plus a snapshot of the tombstones and
+            // full groups of the current table.
+            void stats(hashmap_stats_t& out) const
+            {
+                out               = m_stats;
+                out.m_tombstones  = 0;
+                out.m_full_groups = 0;
+                out.m_groups      = m_capacity + 1;
+                for (u32 g = 0; g <= m_capacity; ++g)
+                {
+                    group_t const* ctrl = m_ctrls->get_item(g);
+                    out.m_tombstones += (u32)math::countBits(ctrl->m_deleted);
+                    out.m_full_groups += ctrl->has_empty() ? 0 : 1;
+                }
+            }
+            void reset_stats() { m_stats.reset(); }
+#endif
 
         private:
+            hashmap_t(hashmap_t const&);            // not copyable
+            hashmap_t& operator=(hashmap_t const&); // not copyable
+
+            // Writes the single table of the map to a file, see c_mapped_hash_map.h
+            template <typename K, typename V, typename H, typename R, template <typename> class L, template <typename> class A> friend bool save(hashmap_t<K, V, H, R, L, A>& map, const char* path);
+
+            // Bulk builds the map with several threads, see c_flat_hash_map_build.h
+            template <typename K, typename V, typename H, typename R, template <typename> class L, template <typename> class A> friend u32 build_from(hashmap_t<K, V, H, R, L, A>& map, K const* keys, V const* values, u32 n, u32 threads);
+
+            enum
+            {
+                cBatchSize = 16, // number of lookups that find_batch keeps in flight
+            };
+
+            // Worker of build_from, fills the groups [group_begin, group_end) with the keys in
+            // order[begin, end). The item index of an accepted key is 'begin + accepted', the indices
+            // of deferred keys are written back to the front of order[begin, end).
+            void build_partition(Key const* keys, Value const* values, heap_array_t<u64> const* hashes, heap_array_t<u32>* order, u32 begin, u32 end, u32 group_begin, u32 group_end, u32& accepted, u32& deferred)
+            {
+                accepted = 0;
+                deferred = 0;
+                for (u32 o = begin; o < end; ++o)
+                {
+                    u32 const  i    = *order->get_item(o);
+                    u64 const  hash = *hashes->get_item(i);
+                    h2_t const h    = H2(hash);
+                    auto       seq  = probe(hash, m_capacity);
+                    while (true)
+                    {
+                        u32 const g = seq.offset();
+                        if (g < group_begin || g >= group_end)
+                        {
+                            order->set_item(begin + deferred++, i);
+                            break;
+                        }
+
+                        group_t*  ctrl      = m_ctrls->get_item(g);
+                        bitmask_t bitmask   = ctrl->match(h, ctrl->get_used());
+                        bool      duplicate = false;
+                        for (s8 s : bitmask)
+                        {
+                            if (keys[i] == *m_keys->get_item(get_ref(g, s)))
+                            {
+                                duplicate = true;
+                                break;
+                            }
+                        }
+                        if (duplicate)
+                            break;
+
+                        if (ctrl->has_empty())
+                        {
+                            findinfo_t const target = {(s32)g, ctrl->index_of_empty(), seq.index()};
+                            u32 const        item   = begin + accepted++;
+                            m_keys->set_item(item, keys[i]);
+                            m_values->set_item(item, values[i]);
+                            if (m_locs != nullptr)
+                                m_locs->set_item(item, loc(target.offset, target.index));
+                            set_ctrl(target, h, item);
+                            break;
+                        }
+                        seq.next();
+                    }
+                }
+            }
+
             // General notes on capacity/growth methods below:
             // - We use 7/8th as maximum load factor. For 16-wide groups, that gives an
             //   average of two empty slots per group.
@@ -495,47 +1216,92 @@ namespace ncore
             {
                 return (u32)(((u64)max_size * 8 - max_size) / 8); // `n*7/8`
             }
+            // The smallest valid capacity that can hold 'n' items without growing
+            inline u32 capacity_for(u32 n) const
+            {
+                u32 const groups = (u32)((((u64)n * 8) / 7 + group_t::cWidth - 1) / group_t::cWidth);
+                return normalize_capacity(groups);
+            }
+
+            inline Refs* refs(u32 offset) const { return layout_t::refs(m_ctrls, m_refs, offset); }
+            inline u32   get_ref(u32 offset, s8 index) const { return refs(offset)->get(index); }
+            inline void  set_ref(u32 item_index, u32 offset, s8 index) { refs(offset)->set(item_index, index); }
+            inline u32   replace_ref(u32 item_index, u32 offset, s8 index)
+            {
+                Refs*     r        = refs(offset);
+                u32 const old_item = r->get(index);
+                r->set(item_index, index);
+                return old_item;
+            }
+
+            static inline u32 loc(u32 offset, s8 index) { return (offset << 5) | (u32)index; }
+            static inline u32 loc_offset(u32 loc) { return loc >> 5; }
+            static inline s8  loc_index(u32 loc) { return (s8)(loc & 0x1F); }
+
+            inline Refs* old_refs(u32 offset) const { return layout_t::refs(m_old_ctrls, m_old_refs, offset); }
+
+            // The key, value and loc of an item, while the dense arrays are grown (see prepare) the items
+            // that are not copied yet are read from and written to the previous arrays.
+            inline bool   in_prev(u32 item) const { return item >= m_prev_copied && item < m_prev_end; }
+            inline Key*   key_at(u32 item) const { return in_prev(item) ? m_prev_keys->get_item(item) : m_keys->get_item(item); }
+            inline Value* value_at(u32 item) const { return in_prev(item) ? m_prev_values->get_item(item) : m_values->get_item(item); }
+            inline u32*   loc_at(u32 item) const { return in_prev(item) ? m_prev_locs->get_item(item) : m_locs->get_item(item); }
+
+            // While rehashing the loc of an item refers to the old table as long as that slot is still
+            // used by the item, migrating an item marks its old slot as deleted and updates its loc.
+            inline bool is_old_loc(u32 item_index, u32 loc) const
+            {
+                if (!is_rehashing() || loc_offset(loc) > m_old_capacity)
+                    return false;
+                group_t const* ctrl = m_old_ctrls->get_item(loc_offset(loc));
+                return ctrl->is_used(loc_index(loc)) && old_refs(loc_offset(loc))->get(loc_index(loc)) == item_index;
+            }
 
             inline bool is_used(u32 offset, s8 index) const
             {
-                ctrl_t* ctrl = m_ctrls->get_item(offset);
+                group_t* ctrl = m_ctrls->get_item(offset);
                 return ctrl->is_used(index);
             }
 
             inline bool is_empty(u32 offset, s8 index) const
             {
-                ctrl_t* ctrl = m_ctrls->get_item(offset);
+                group_t* ctrl = m_ctrls->get_item(offset);
                 return ctrl->is_empty(index);
             }
 
             inline bool is_deleted(u32 offset, s8 index) const
             {
-                ctrl_t* ctrl = m_ctrls->get_item(offset);
+                group_t* ctrl = m_ctrls->get_item(offset);
                 return ctrl->is_deleted(index);
             }
 
-            inline findinfo_t find_internal(const Key& key, u64 hash) const
+            inline findinfo_t find_internal(const Key& key, u64 hash) const { return find_internal_in(m_ctrls, m_refs, m_capacity, key, hash); }
+            inline findinfo_t find_internal_old(const Key& key, u64 hash) const { return find_internal_in(m_old_ctrls, m_old_refs, m_old_capacity, key, hash); }
+
+            inline findinfo_t find_internal_in(Array<group_t>* ctrls, Array<Refs>* refs, u32 capacity, const Key& key, u64 hash) const
             {
                 h2_t const h   = H2(hash);
-                auto       seq = probe(hash, m_capacity);
+                auto       seq = probe(hash, capacity);
                 while (true)
                 {
-                    ctrl_t*   ctrl    = m_ctrls->get_item(seq.offset());
+                    group_t*  ctrl    = ctrls->get_item(seq.offset());
                     bitmask_t bitmask = ctrl->match(h, ctrl->get_used());
                     for (s8 i : bitmask)
                     {
-                        const u32  other_ref = ctrl->get_ref(i);
-                        const Key* other_key = m_keys->get_item(other_ref);
+                        const u32  other_ref = layout_t::refs(ctrls, refs, seq.offset())->get(i);
+                        const Key* other_key = key_at(other_ref);
+                        CGENERICS_FLAT_HASHMAP_STAT(m_stats.m_h2_matches += 1);
                         if (key == *other_key)
                             return {(s32)seq.offset(), i, seq.index()};
+                        CGENERICS_FLAT_HASHMAP_STAT(m_stats.m_h2_false_matches += 1);
                     }
                     if (ctrl->has_empty())
                         break;
 
                     seq.next();
-                    ASSERTS(seq.index() <= m_capacity, "full table!");
+                    ASSERTS(seq.index() <= capacity, "full table!");
                 }
-                return {-1, -1, 0};
+                return {-1, -1, seq.index()};
             }
 
             inline findinfo_t find_first_non_used(u64 hash, u64 capacity) const
@@ -543,7 +1309,7 @@ namespace ncore
                 auto seq = probe(hash, capacity);
                 while (true)
                 {
-                    ctrl_t* ctrl = m_ctrls->get_item(seq.offset());
+                    group_t* ctrl = m_ctrls->get_item(seq.offset());
 
                     // Prioritize deleted before empty
                     if (ctrl->has_deleted())
@@ -564,7 +1330,7 @@ namespace ncore
                 auto seq = probe(hash, capacity);
                 while (true)
                 {
-                    ctrl_t* ctrl = m_ctrls->get_item(seq.offset());
+                    group_t* ctrl = m_ctrls->get_item(seq.offset());
 
                     // Prioritize empty before deleted
                     if (ctrl->has_empty())
@@ -580,111 +1346,432 @@ namespace ncore
                 }
             }
 
-            void rehash_and_grow_if_necessary()
+            // Returns false when the memory for a larger table could not be allocated
+            bool rehash_and_grow_if_necessary()
             {
                 if (m_capacity == 0)
+                    return resize(1);
+
+                // A previous migration has to be finished before we can compact or start a new one
+                migrate(0xffffffff);
+
+                if (should_drop_deletes())
                 {
-                    resize(1);
+                    // Squash DELETED without growing if there is enough capacity.
+                    finish_prepare();
+                    return drop_deletes_without_resize();
                 }
-                // else if (m_capacity > 1 && ((size() * u64{32}) <= ((m_capacity * 32) * u64{25})))
-                //{
-                //     // Squash DELETED without growing if there is enough capacity.
-                //     //
-                //     // drop_deletes_without_resize();
-                // }
-                else
+                else if (m_migrate_step > 0)
                 {
-                    // Otherwise grow the container.
-                    resize(m_capacity * 2 + 1);
+                    return grow_incremental(m_capacity * 2 + 1);
                 }
+
+                // Otherwise grow the container.
+                return resize(m_capacity * 2 + 1);
             }
 
+            // At most 25/32 of the slots are used by live items, so at least 3/32 of the slots are
+            // tombstones. Rehashing in-place into a table of the same capacity turns all of them
+            // back into empty slots, a steady insert/erase churn no longer doubles the table.
+            inline bool should_drop_deletes() const { return m_capacity > 1 && ((size() * (u64)32) <= (((u64)(m_capacity + 1) * group_t::cWidth) * (u64)25)); }
+            bool        drop_deletes_without_resize() { return resize(m_capacity); }
+
             // Reset all ctrl bytes back to Empty, except the sentinel.
             inline void reset_ctrls(u32 from, u32 to)
             {
                 // NOTE: This can be optimized a lot, by not iterating over groups, but just pure memory
                 for (u32 i = from; i < to; i++)
                 {
-                    ctrl_t* ctrl = m_ctrls->get_item(i);
+                    group_t* ctrl = m_ctrls->get_item(i);
                     ctrl->deleted_to_empty_and_used_to_deleted();
                 }
             }
 
-            inline void clear_ctrls(u32 from, u32 to)
+            inline void clear_ctrls(u32 from, u32 to) { clear_groups(m_ctrls, m_refs, from, to); }
+
+            static void clear_groups(Array<group_t>* ctrls, Array<Refs>* refs, u32 from, u32 to)
             {
                 // NOTE: This can be optimized a lot, by not iterating over groups, but just pure memory
                 for (u32 i = from; i < to; i++)
                 {
-                    ctrl_t* ctrl = m_ctrls->get_item(i);
+                    group_t* ctrl = ctrls->get_item(i);
                     ctrl->clear();
+                    if (layout_t::cSplit)
+                        layout_t::refs(ctrls, refs, i)->clear();
                 }
             }
 
+            // The arrays have been grown by reserve_slots
             void initialize_slots()
             {
                 ASSERT(m_capacity > 0);
 
                 u32 const oldsize = m_ctrls->size();
                 u32 const newsize = (u32)(m_capacity + 1);
-                m_ctrls->set_capacity(newsize);
                 m_ctrls->set_size(newsize);
+                if (layout_t::cSplit)
+                    m_refs->set_size(newsize);
 
+                clear_ctrls(oldsize, newsize);
+                reset_ctrls(0, oldsize);
+                reset_growth_left();
+            }
+
+            // Grows the ctrl arrays to 'num_groups' groups and the key/value arrays to the items that fit in
+            // them. Returns false when the memory could not be allocated, arrays that did grow keep their
+            // larger capacity, which is harmless.
+            inline bool reserve_slots(u32 num_groups)
+            {
+                if (!m_ctrls->set_capacity(num_groups))
+                    return false;
+                if (layout_t::cSplit && !m_refs->set_capacity(num_groups))
+                    return false;
+                return reserve_items(num_groups);
+            }
+
+            inline bool reserve_items(u32 num_groups)
+            {
                 // We are taking 7/8 of the capacity:
                 // 65_536 * 7/8 = 57344
                 // 1_28_000 * 7/8 = 112000
                 // 1_000_000 * 7/8 = 875000
-                u32 const kvsize = size_to_grow(newsize * ctrl_t::cWidth);
-                m_keys->set_capacity(kvsize);
-                m_values->set_capacity(kvsize);
+                u32 const kvsize = size_to_grow(num_groups * group_t::cWidth);
+                if (!m_keys->set_capacity(kvsize) || !m_values->set_capacity(kvsize))
+                    return false;
+                return m_locs == nullptr || m_locs->set_capacity(kvsize);
+            }
 
-                clear_ctrls(oldsize, newsize);
-                reset_ctrls(0, oldsize);
+            inline bool is_preparing() const { return m_next_ctrls != nullptr; }
+
+            // Prepare the next incremental grow in steps, once the current table is close to full a new
+            // table of twice the size is allocated, every insert/erase then clears up to 2 * 'num_steps'
+            // of its groups and copies up to 'num_steps' groups worth of items to key/value arrays that
+            // are sized for the new table. Starting when the growth left is below the number of groups
+            // leaves enough inserts to finish before the table has to grow.
+            void prepare(u32 num_steps)
+            {
+                if (num_steps == 0 || is_rehashing())
+                    return;
+
+                if (!is_preparing())
+                {
+                    if (growth_left() > m_capacity + 1 || m_capacity == 0 || should_drop_deletes())
+                        return;
+                    if ((m_capacity * 2 + 1) >= (1 << 27)) // group index has to fit in a loc
+                        return;
+
+                    u32 const n = (m_capacity + 1) * 2;
+                    if (!create_next(n))
+                        return;
+
+                    // the new arrays already have the size of the previous ones, the items are copied below.
+                    // Without the memory for them grow_incremental tries to grow the arrays in one go.
+                    u32 const     kvsize = size_to_grow(n * group_t::cWidth);
+                    Array<Key>*   keys   = Array<Key>::create(m_size, kvsize, m_alloc);
+                    Array<Value>* values = Array<Value>::create(m_size, kvsize, m_alloc);
+                    Array<u32>*   locs   = m_locs != nullptr ? Array<u32>::create(m_size, kvsize, m_alloc) : nullptr;
+                    if (keys != nullptr && values != nullptr && (m_locs == nullptr || locs != nullptr))
+                    {
+                        m_prev_keys   = m_keys;
+                        m_prev_values = m_values;
+                        m_prev_locs   = m_locs;
+                        m_keys        = keys;
+                        m_values      = values;
+                        m_locs        = locs;
+                        m_prev_copied = 0;
+                        m_prev_end    = m_size;
+                    }
+                    else
+                    {
+                        Array<Key>::destroy(keys);
+                        Array<Value>::destroy(values);
+                        Array<u32>::destroy(locs);
+                    }
+                }
+
+                u32 const n = m_next_ctrls->size();
+                if (m_next_cleared < n)
+                {
+                    u32 const end = (u64)(n - m_next_cleared) > (u64)num_steps * 2 ? (m_next_cleared + num_steps * 2) : n;
+                    clear_groups(m_next_ctrls, m_next_refs, m_next_cleared, end);
+                    m_next_cleared = end;
+                }
+                if (m_prev_keys != nullptr)
+                {
+                    // an erase can have moved the end below the items that are already copied
+                    u64 const count = (u64)num_steps * group_t::cWidth;
+                    u32 const end   = m_prev_end > (m_prev_copied + count) ? (u32)(m_prev_copied + count) : m_prev_end;
+                    copy_prev(end);
+                }
+            }
+
+            // Copies the items [m_prev_copied, end) from the previous dense arrays, once all items are
+            // copied the previous arrays are released.
+            void copy_prev(u32 end)
+            {
+                for (u32 i = m_prev_copied; i < end; ++i)
+                {
+                    m_keys->set_item(i, *m_prev_keys->get_item(i));
+                    m_values->set_item(i, *m_prev_values->get_item(i));
+                    if (m_locs != nullptr)
+                        m_locs->set_item(i, *m_prev_locs->get_item(i));
+                }
+                m_prev_copied = end;
+
+                if (m_prev_copied >= m_prev_end)
+                {
+                    Array<Key>::destroy(m_prev_keys);
+                    Array<Value>::destroy(m_prev_values);
+                    if (m_prev_locs != nullptr)
+                        Array<u32>::destroy(m_prev_locs);
+                    m_prev_keys   = nullptr;
+                    m_prev_values = nullptr;
+                    m_prev_locs   = nullptr;
+                    m_prev_copied = 0;
+                    m_prev_end    = 0;
+                }
+            }
+
+            // Allocates the next table, its groups are cleared by prepare or grow_incremental
+            bool create_next(u32 num_groups)
+            {
+                m_next_ctrls   = Array<group_t>::create(num_groups, num_groups, m_alloc);
+                m_next_refs    = layout_t::cSplit ? Array<Refs>::create(num_groups, num_groups, m_alloc) : nullptr;
+                m_next_cleared = 0;
+                if (m_next_ctrls != nullptr && (!layout_t::cSplit || m_next_refs != nullptr))
+                    return true;
+                Array<group_t>::destroy(m_next_ctrls);
+                Array<Refs>::destroy(m_next_refs);
+                return false;
+            }
+
+            // Copies the remaining items to the grown dense arrays and releases the prepared table
+            void finish_prepare()
+            {
+                if (m_prev_keys != nullptr)
+                    copy_prev(m_prev_end);
+                if (m_next_ctrls != nullptr)
+                {
+                    Array<group_t>::destroy(m_next_ctrls);
+                    if (m_next_refs != nullptr)
+                        Array<Refs>::destroy(m_next_refs);
+                    m_next_ctrls = nullptr;
+                    m_next_refs  = nullptr;
+                }
+            }
+
+            // Finishes a migration that is in progress and the preparation of the next one
+            void complete_growth()
+            {
+                migrate(0xffffffff);
+                finish_prepare();
+            }
+
+            // Start an incremental rehash, the current table becomes the old table and the prepared table
+            // becomes the new table, the items are migrated by 'migrate' as part of insert and erase.
+            // When the preparation did not get far enough (the step was changed, or many erases reused
+            // deleted slots) the remaining work is done here.
+            // Returns false when the memory could not be allocated, the current table stays in use.
+            bool grow_incremental(u32 new_capacity)
+            {
+                ASSERT(is_valid_capacity(new_capacity));
+                ASSERT(!is_rehashing());
+                ASSERT(new_capacity < (1 << 27)); // group index has to fit in a loc
+
+                u32 const n = new_capacity + 1;
+                if (is_preparing() && m_next_ctrls->size() != n)
+                    finish_prepare();
+                if (!is_preparing() && !create_next(n))
+                    return false;
+                if (m_prev_keys != nullptr)
+                    copy_prev(m_prev_end);
+                if (!reserve_items(n))
+                    return false;
+                clear_groups(m_next_ctrls, m_next_refs, m_next_cleared, n);
+                m_next_cleared = n;
+                CGENERICS_FLAT_HASHMAP_STAT(m_stats.m_resizes += 1);
+
+                m_old_ctrls     = m_ctrls;
+                m_old_refs      = m_refs;
+                m_old_capacity  = m_capacity;
+                m_migrate_group = 0;
+
+                m_capacity   = new_capacity;
+                m_ctrls      = m_next_ctrls;
+                m_refs       = m_next_refs;
+                m_next_ctrls = nullptr;
+                m_next_refs  = nullptr;
                 reset_growth_left();
+                return true;
+            }
+
+            // Move up to 'num_groups' groups of the old table to the new table. A migrated item
+            // leaves a deleted slot behind so that probing the old table stays correct.
+            void migrate(u32 num_groups)
+            {
+                if (!is_rehashing())
+                    return;
+
+                u32 const remaining = m_old_capacity + 1 - m_migrate_group;
+                u32 const end       = (num_groups >= remaining) ? (m_old_capacity + 1) : (m_migrate_group + num_groups);
+
+                Hasher hasher;
+                for (; m_migrate_group < end; ++m_migrate_group)
+                {
+                    group_t*  octrl = m_old_ctrls->get_item(m_migrate_group);
+                    bitmask_t used  = octrl->get_used();
+                    for (s8 i : used)
+                    {
+                        u32 const        item   = old_refs(m_migrate_group)->get(i);
+                        u64 const        hash   = hasher(m_keys->get_item(item));
+                        findinfo_t const target = find_first_non_used_rehash(hash, m_capacity);
+                        set_ctrl(target, H2(hash), item);
+                        if (m_locs != nullptr)
+                            m_locs->set_item(item, loc(target.offset, target.index));
+                        octrl->set_deleted(i);
+                    }
+                }
+
+                if (m_migrate_group > m_old_capacity)
+                {
+                    Array<group_t>::destroy(m_old_ctrls);
+                    if (m_old_refs != nullptr)
+                        Array<Refs>::destroy(m_old_refs);
+                    m_old_ctrls    = nullptr;
+                    m_old_refs     = nullptr;
+                    m_old_capacity = 0;
+                }
             }
 
             inline void set_ctrl(findinfo_t const& fi, h2_t hash, u32 item_index)
             {
-                ctrl_t* ctrl = m_ctrls->get_item(fi.offset);
+                group_t* ctrl = m_ctrls->get_item(fi.offset);
                 ctrl->set_used(fi.index);
                 ctrl->set_hash(hash, fi.index);
-                ctrl->set_ref(item_index, fi.index);
+                set_ref(item_index, fi.offset, fi.index);
+            }
+
+            // Clears all groups and inserts every item again, in item order
+            void rehash_items()
+            {
+                clear_ctrls(0, m_capacity + 1);
+                Hasher hasher;
+                for (u32 item = 0; item < m_size; ++item)
+                {
+                    u64 const        hash   = hasher(m_keys->get_item(item));
+                    findinfo_t const target = find_first_non_used_rehash(hash, m_capacity);
+                    set_ctrl(target, H2(hash), item);
+                    if (m_locs != nullptr)
+                        m_locs->set_item(item, loc(target.offset, target.index));
+                }
+            }
+
+            // Moves everything to a smaller table, unlike resize (which grows in place) this allocates
+            // new arrays for the ctrls, keys and values so that the memory of the old ones is returned.
+            void shrink(u32 new_capacity)
+            {
+                ASSERT(is_valid_capacity(new_capacity));
+                ASSERT(!is_rehashing());
+                ASSERT(capacity_for(m_size) <= new_capacity);
+                CGENERICS_FLAT_HASHMAP_STAT(hashmap_resize_timer_t timer(m_stats));
+                finish_prepare();
+
+                // Shrinking is optional, without the memory for the new arrays the map stays as it is
+                u32 const       n      = new_capacity + 1;
+                u32 const       kvsize = size_to_grow(n * group_t::cWidth);
+                Array<Key>*     keys   = Array<Key>::create(m_size, kvsize, m_alloc);
+                Array<Value>*   values = Array<Value>::create(m_size, kvsize, m_alloc);
+                Array<u32>*     locs   = m_locs != nullptr ? Array<u32>::create(m_size, kvsize, m_alloc) : nullptr;
+                Array<group_t>* ctrls  = Array<group_t>::create(n, n, m_alloc);
+                Array<Refs>*    refs   = m_refs != nullptr ? Array<Refs>::create(n, n, m_alloc) : nullptr;
+                if (keys == nullptr || values == nullptr || (m_locs != nullptr && locs == nullptr) || ctrls == nullptr || (m_refs != nullptr && refs == nullptr))
+                {
+                    Array<Key>::destroy(keys);
+                    Array<Value>::destroy(values);
+                    Array<u32>::destroy(locs);
+                    Array<group_t>::destroy(ctrls);
+                    Array<Refs>::destroy(refs);
+                    return;
+                }
+
+                for (u32 i = 0; i < m_size; ++i)
+                {
+                    keys->set_item(i, *m_keys->get_item(i));
+                    values->set_item(i, *m_values->get_item(i));
+                }
+                Array<Key>::destroy(m_keys);
+                Array<Value>::destroy(m_values);
+                m_keys   = keys;
+                m_values = values;
+                if (m_locs != nullptr)
+                {
+                    Array<u32>::destroy(m_locs);
+                    m_locs = locs;
+                }
+
+                Array<group_t>::destroy(m_ctrls);
+                m_ctrls = ctrls;
+                if (m_refs != nullptr)
+                {
+                    Array<Refs>::destroy(m_refs);
+                    m_refs = refs;
+                }
+                m_capacity = new_capacity;
+                rehash_items();
+                reset_growth_left();
             }
 
-            void resize(u32 new_capacity)
+            // Returns false when the memory for the larger table could not be allocated
+            bool resize(u32 new_capacity)
             {
                 ASSERT(is_valid_capacity(new_capacity));
+                CGENERICS_FLAT_HASHMAP_STAT(hashmap_resize_timer_t timer(m_stats));
+
+                ASSERT(new_capacity < (1 << 27)); // group index has to fit in a loc
+
+                // Grow the arrays first, when the memory runs out the table is left as it was
+                if (!reserve_slots(new_capacity + 1))
+                    return false;
 
                 const u32 old_capacity = m_capacity;
                 m_capacity             = new_capacity;
                 initialize_slots();
 
+                if (m_locs != nullptr)
+                {
+                    // With the back references we can simply clear all groups and insert every item
+                    // again, walking the keys in order instead of chasing displaced items.
+                    rehash_items();
+                    return true;
+                }
+
                 //
-                // The logic below supports hashing in-place, so array_t<> is able to use
-                // virtual memory and expand/shrink their storage without a realloc.
+                // The logic below supports hashing in-place, so the Array policy (vmem_array_t) is able
+                // to use virtual memory and expand/shrink their storage without a realloc.
                 //
 
                 Hasher hasher;
                 for (u32 g = 0; g <= old_capacity; ++g)
                 {
-                    ctrl_t* ctrl = m_ctrls->get_item(g);
-                    for (s8 i = 0; i < ctrl_t::cWidth; ++i)
+                    group_t* ctrl = m_ctrls->get_item(g);
+                    for (s8 i = 0; i < group_t::cWidth; ++i)
                     {
                         if (ctrl->is_deleted(i))
                         {
                             ctrl->set_empty(i);
 
-                            u32 current_item = ctrl->get_ref(i);
+                            u32 current_item = get_ref(g, i);
                             while (true)
                             {
                                 u64 const        hash        = hasher(m_keys->get_item(current_item));
                                 findinfo_t const target      = find_first_non_used_rehash(hash, m_capacity);
-                                ctrl_t*          target_ctrl = m_ctrls->get_item(target.offset);
+                                group_t*         target_ctrl = m_ctrls->get_item(target.offset);
 
                                 target_ctrl->set_hash(H2(hash), target.index);
                                 if (target_ctrl->is_empty(target.index))
                                 {
                                     target_ctrl->set_used(target.index);
-                                    target_ctrl->set_ref(current_item, target.index);
+                                    set_ref(current_item, target.offset, target.index);
                                     break;
                                 }
 
@@ -692,11 +1779,12 @@ namespace ncore
 
                                 // this entry was 'deleted', so it contains an existing item
                                 // replace the item with a new one and get the previous item
-                                current_item = target_ctrl->replace_ref(current_item, target.index);
+                                current_item = replace_ref(current_item, target.offset, target.index);
                             }
                         }
                     }
                 }
+                return true;
             }
         };
 
@@ -0,0 +1,208 @@
+#ifndef __C_GENERICS_CONTAINERS_FLAT_HASH_MAP_BUILD_H__
+#define __C_GENERICS_CONTAINERS_FLAT_HASH_MAP_BUILD_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "cgenerics/c_flat_hash_map.h"
+
+#include <atomic>
+#include <thread>
+
+namespace ncore
+{
+    namespace flat_hashmap_n
+    {
+        enum
+        {
+            cMaxBuildThreads = 64,   // maximum number of threads used by build_from
+            cMinBuildItems   = 4096, // below this build_from just inserts on the calling thread
+        };
+
+        // Bulk build from 'n' keys and values using up to 'threads' threads, the map has to be empty.
+        // - The table is sized once for 'n' items.
+        // - The input is radix partitioned by the high bits of the group index of each key, so every
+        //   partition maps to a contiguous range of groups.
+        // - Every partition is filled by a single thread, the keys and values of a partition are written
+        //   to their own range of the dense key/value arrays.
+        // - A key whose probe sequence leaves the group range of its partition is inserted afterwards
+        //   by the calling thread, at our load factor this is rare.
+        // Duplicate keys are handled like insert, the first occurrence in the input wins and the later
+        // ones are dropped. Like insert, keys that do not fit in max_size() are refused.
+        // Returns the number of items in the map.
+        template <typename Key, typename Value, typename Hasher, typename Refs, template <typename> class Layout, template <typename> class Array> u32 build_from(hashmap_t<Key, Value, Hasher, Refs, Layout, Array>& map, Key const* keys, Value const* values, u32 n, u32 threads)
+        {
+            ASSERT(map.empty());
+            map.complete_growth();
+
+            // The item index has to fit in the ref of a ctrl group, only the first max_size() keys are
+            // built in bulk, the rest is offered to insert which fails cleanly once the map is full
+            u32 const rest = n > map.max_size() ? n - map.max_size() : 0;
+            n -= rest;
+
+            // Without the memory for all items the inserts below fail once the memory runs out
+            if (map.capacity_for(n) > map.m_capacity && !map.resize(map.capacity_for(n)))
+                threads = 1;
+
+            if (threads > cMaxBuildThreads)
+                threads = cMaxBuildThreads;
+            u32 const num_groups = map.m_capacity + 1;
+            u32       num_parts  = 1;
+            while (num_parts < threads * 4)
+                num_parts <<= 1;
+            while (num_parts > 1 && (num_groups / num_parts) < 8)
+                num_parts >>= 1;
+
+            if (threads <= 1 || num_parts < 2 || n < (u32)cMinBuildItems)
+            {
+                for (u32 i = 0; i < n + rest; ++i)
+                    map.insert(keys[i], values[i]);
+                return map.m_size;
+            }
+
+            u32 const part_shift = math::countTrailingZeros(num_groups) - math::countTrailingZeros(num_parts);
+            u32 const part_size  = num_groups / num_parts;
+
+            heap_array_t<u64>* hashes   = heap_array_t<u64>::create(n, n, map.m_alloc);
+            heap_array_t<u32>* order    = heap_array_t<u32>::create(n, n, map.m_alloc);
+            heap_array_t<u32>* offsets  = heap_array_t<u32>::create(threads * num_parts, threads * num_parts, map.m_alloc);
+            heap_array_t<u32>* parts    = heap_array_t<u32>::create(num_parts + 1, num_parts + 1, map.m_alloc);
+            heap_array_t<u32>* accepted = heap_array_t<u32>::create(num_parts, num_parts, map.m_alloc);
+            heap_array_t<u32>* deferred = heap_array_t<u32>::create(num_parts, num_parts, map.m_alloc);
+
+            std::thread workers[cMaxBuildThreads];
+
+            // Phase 1: hash the keys and count the keys per partition for every chunk of the input
+            for (u32 t = 0; t < threads; ++t)
+            {
+                workers[t] = std::thread([=, &map]() {
+                    Hasher    hasher;
+                    u32*      hist  = offsets->get_item(t * num_parts);
+                    u32 const begin = (u32)(((u64)n * t) / threads);
+                    u32 const end   = (u32)(((u64)n * (t + 1)) / threads);
+                    for (u32 p = 0; p < num_parts; ++p)
+                        hist[p] = 0;
+                    for (u32 i = begin; i < end; ++i)
+                    {
+                        u64 const hash = hasher(&keys[i]);
+                        hashes->set_item(i, hash);
+                        hist[(map.probe(hash, map.m_capacity).offset()) >> part_shift] += 1;
+                    }
+                });
+            }
+            for (u32 t = 0; t < threads; ++t)
+                workers[t].join();
+
+            // Exclusive prefix sum, partition major so that each partition is a contiguous range
+            u32 running = 0;
+            for (u32 p = 0; p < num_parts; ++p)
+            {
+                parts->set_item(p, running);
+                for (u32 t = 0; t < threads; ++t)
+                {
+                    u32 const count = *offsets->get_item(t * num_parts + p);
+                    offsets->set_item(t * num_parts + p, running);
+                    running += count;
+                }
+            }
+            parts->set_item(num_parts, running);
+
+            // Phase 2: scatter the input indices, stable, so within a partition the input order is kept
+            for (u32 t = 0; t < threads; ++t)
+            {
+                workers[t] = std::thread([=, &map]() {
+                    u32*      offset = offsets->get_item(t * num_parts);
+                    u32 const begin  = (u32)(((u64)n * t) / threads);
+                    u32 const end    = (u32)(((u64)n * (t + 1)) / threads);
+                    for (u32 i = begin; i < end; ++i)
+                    {
+                        u32 const p = (map.probe(*hashes->get_item(i), map.m_capacity).offset()) >> part_shift;
+                        order->set_item(offset[p]++, i);
+                    }
+                });
+            }
+            for (u32 t = 0; t < threads; ++t)
+                workers[t].join();
+
+            // Phase 3: fill the partitions, the item index of a key is its position in 'order'
+            map.m_keys->set_size(n);
+            map.m_values->set_size(n);
+            if (map.m_locs != nullptr)
+                map.m_locs->set_size(n);
+
+            std::atomic<u32> next_part(0);
+            for (u32 t = 0; t < threads; ++t)
+            {
+                workers[t] = std::thread([&, part_size]() {
+                    while (true)
+                    {
+                        u32 const p = next_part.fetch_add(1);
+                        if (p >= num_parts)
+                            break;
+                        map.build_partition(keys, values, hashes, order, *parts->get_item(p), *parts->get_item(p + 1), p * part_size, (p + 1) * part_size, *accepted->get_item(p), *deferred->get_item(p));
+                    }
+                });
+            }
+            for (u32 t = 0; t < threads; ++t)
+                workers[t].join();
+
+            // Duplicates leave holes at the end of the item range of a partition, close them
+            u32 size = 0;
+            for (u32 p = 0; p < num_parts; ++p)
+            {
+                u32 const begin = *parts->get_item(p);
+                u32 const count = *accepted->get_item(p);
+                if (size != begin)
+                {
+                    for (u32 i = 0; i < count; ++i)
+                    {
+                        map.m_keys->set_item(size + i, *map.m_keys->get_item(begin + i));
+                        map.m_values->set_item(size + i, *map.m_values->get_item(begin + i));
+                        if (map.m_locs != nullptr)
+                            map.m_locs->set_item(size + i, *map.m_locs->get_item(begin + i));
+                    }
+                    for (u32 g = p * part_size; g < (p + 1) * part_size; ++g)
+                    {
+                        bitmask_t used = map.m_ctrls->get_item(g)->get_used();
+                        for (s8 i : used)
+                            map.set_ref(map.get_ref(g, i) - (begin - size), g, i);
+                    }
+                }
+                size += count;
+            }
+            map.m_keys->set_size(size);
+            map.m_values->set_size(size);
+            if (map.m_locs != nullptr)
+                map.m_locs->set_size(size);
+            map.m_size = size;
+            map.reset_growth_left();
+
+            // Finally the keys that did not fit in the groups of their partition
+            for (u32 p = 0; p < num_parts; ++p)
+            {
+                u32 const begin = *parts->get_item(p);
+                u32 const count = *deferred->get_item(p);
+                for (u32 d = 0; d < count; ++d)
+                {
+                    u32 const i = *order->get_item(begin + d);
+                    map.insert(keys[i], values[i]);
+                }
+            }
+            for (u32 i = n; i < n + rest; ++i)
+                map.insert(keys[i], values[i]);
+
+            heap_array_t<u64>::destroy(hashes);
+            heap_array_t<u32>::destroy(order);
+            heap_array_t<u32>::destroy(offsets);
+            heap_array_t<u32>::destroy(parts);
+            heap_array_t<u32>::destroy(accepted);
+            heap_array_t<u32>::destroy(deferred);
+            return map.m_size;
+        }
+
+    } // namespace flat_hashmap_n
+
+} // namespace ncore
+
+#endif // __C_GENERICS_CONTAINERS_FLAT_HASH_MAP_BUILD_H__
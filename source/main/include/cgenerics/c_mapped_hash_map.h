@@ -0,0 +1,236 @@
+#ifndef __C_GENERICS_CONTAINERS_MAPPED_HASH_MAP_H__
+#define __C_GENERICS_CONTAINERS_MAPPED_HASH_MAP_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "cgenerics/c_flat_hash_map.h"
+#include "cgenerics/c_vmem.h"
+
+#include <type_traits>
+
+namespace ncore
+{
+    namespace flat_hashmap_n
+    {
+        // Header of a persisted hashmap_t, followed by the ctrls, the refs (split layout only), the keys
+        // and the values, each section starts at a multiple of 64 bytes from the start of the file.
+        struct persist_header_t
+        {
+            enum
+            {
+                cMagic   = 0x4D484743, // 'CGHM'
+                cVersion = 1,          // bump when the layout of groups or refs changes
+                cAlign   = 64,
+            };
+
+            u32 m_magic;
+            u32 m_version;
+            u32 m_hasher;       // Hasher::cId
+            u32 m_sizeof_group; // sizeof(group_t)
+            u32 m_sizeof_refs;  // sizeof(Refs), 0 for the packed layout
+            u32 m_sizeof_key;
+            u32 m_sizeof_value;
+            u32 m_capacity;
+            u32 m_size;
+            u32 m_padding;
+            u64 m_ctrls;  // file offset of the ctrls
+            u64 m_refs;   // file offset of the refs
+            u64 m_keys;   // file offset of the keys
+            u64 m_values; // file offset of the values
+
+            static inline u64 align(u64 offset) { return (offset + cAlign - 1) & ~(u64)(cAlign - 1); }
+        };
+
+        // Write 'map' to 'path' in a format that mapped_hashmap_t can map read-only without rehashing or
+        // copying, see persist_header_t. Key and Value have to be trivially copyable. The file holds a
+        // single table, a map that is still growing incrementally finishes its growth first.
+        template <typename Key, typename Value, typename Hasher, typename Refs, template <typename> class Layout, template <typename> class Array> bool save(hashmap_t<Key, Value, Hasher, Refs, Layout, Array>& map, const char* path)
+        {
+            static_assert(std::is_trivially_copyable<Key>::value, "persisted keys must be trivially copyable");
+            static_assert(std::is_trivially_copyable<Value>::value, "persisted values must be trivially copyable");
+
+            typedef Layout<Refs>               layout_t;
+            typedef typename layout_t::group_t group_t;
+
+            map.complete_growth();
+
+            u32 const        num_groups = map.m_capacity + 1;
+            persist_header_t header;
+            nmem::memset(&header, 0, sizeof(header));
+            header.m_magic        = persist_header_t::cMagic;
+            header.m_version      = persist_header_t::cVersion;
+            header.m_hasher       = Hasher::cId;
+            header.m_sizeof_group = sizeof(group_t);
+            header.m_sizeof_refs  = layout_t::cSplit ? sizeof(Refs) : 0;
+            header.m_sizeof_key   = sizeof(Key);
+            header.m_sizeof_value = sizeof(Value);
+            header.m_capacity     = map.m_capacity;
+            header.m_size         = map.m_size;
+            header.m_ctrls        = persist_header_t::align(sizeof(persist_header_t));
+            header.m_refs         = persist_header_t::align(header.m_ctrls + (u64)num_groups * sizeof(group_t));
+            header.m_keys         = persist_header_t::align(header.m_refs + (u64)num_groups * header.m_sizeof_refs);
+            header.m_values       = persist_header_t::align(header.m_keys + (u64)map.m_size * sizeof(Key));
+
+            vmem_n::file_section_t sections[5];
+            u32                    num_sections = 0;
+
+            sections[num_sections++] = {0, &header, sizeof(header)};
+            sections[num_sections++] = {header.m_ctrls, map.m_ctrls->get_item(0), (u64)num_groups * sizeof(group_t)};
+            if (layout_t::cSplit)
+                sections[num_sections++] = {header.m_refs, map.m_refs->get_item(0), (u64)num_groups * sizeof(Refs)};
+            if (map.m_size > 0)
+            {
+                sections[num_sections++] = {header.m_keys, map.m_keys->get_item(0), (u64)map.m_size * sizeof(Key)};
+                sections[num_sections++] = {header.m_values, map.m_values->get_item(0), (u64)map.m_size * sizeof(Value)};
+            }
+            return vmem_n::write_file(path, sections, num_sections);
+        }
+
+        // A read-only view of a hashmap_t that was written with save. The file is mapped
+        // into memory as is, there is no rehashing or copying, so opening is independent of the number
+        // of items and processes that open the same file share the pages in the page cache.
+        // The template arguments have to match the ones of the hashmap_t that saved the file, open
+        // verifies this through the header (hasher id, layout version and the sizes of the sections).
+        template <typename Key, typename Value, typename Hasher = DefaultHash<Key>, typename Refs = ref32_t, template <typename> class Layout = layout_packed_t> class mapped_hashmap_t
+        {
+            typedef Layout<Refs>               layout_t;
+            typedef typename layout_t::group_t group_t;
+
+        public:
+            mapped_hashmap_t()
+                : m_file(nullptr)
+                , m_file_size(0)
+                , m_ctrls(nullptr)
+                , m_refs(nullptr)
+                , m_keys(nullptr)
+                , m_values(nullptr)
+                , m_size(0)
+                , m_capacity(0)
+            {
+            }
+            ~mapped_hashmap_t() { close(); }
+
+            bool open(const char* path)
+            {
+                close();
+
+                u64         file_size = 0;
+                void const* file      = vmem_n::map_file(path, file_size);
+                if (file == nullptr)
+                    return false;
+
+                persist_header_t const* header = (persist_header_t const*)file;
+                if (!is_valid(header, file_size))
+                {
+                    vmem_n::unmap_file(file, file_size);
+                    return false;
+                }
+
+                u8 const* base = (u8 const*)file;
+                m_file         = file;
+                m_file_size    = file_size;
+                m_ctrls        = (group_t const*)(base + header->m_ctrls);
+                m_refs         = layout_t::cSplit ? (Refs const*)(base + header->m_refs) : nullptr;
+                m_keys         = (Key const*)(base + header->m_keys);
+                m_values       = (Value const*)(base + header->m_values);
+                m_size         = header->m_size;
+                m_capacity     = header->m_capacity;
+                return true;
+            }
+
+            void close()
+            {
+                vmem_n::unmap_file(m_file, m_file_size);
+                m_file      = nullptr;
+                m_file_size = 0;
+                m_ctrls     = nullptr;
+                m_refs      = nullptr;
+                m_keys      = nullptr;
+                m_values    = nullptr;
+                m_size      = 0;
+                m_capacity  = 0;
+            }
+
+            bool is_open() const { return m_file != nullptr; }
+            bool empty() const { return !size(); }
+            u32  size() const { return m_size; }
+            u32  capacity() const { return m_capacity; }
+
+            Value const* find(Key const& key) const
+            {
+                if (m_size == 0)
+                    return nullptr;
+
+                Hasher     hasher;
+                u64 const  hash = hasher(&key);
+                h2_t const h    = H2(hash);
+                probe_t    seq(H1(hash, m_ctrls), m_capacity);
+                while (true)
+                {
+                    group_t const* ctrl    = m_ctrls + seq.offset();
+                    bitmask_t      bitmask = ctrl->match(h, ctrl->get_used());
+                    for (s8 i : bitmask)
+                    {
+                        // The refs come from the file, an index beyond the items is never followed
+                        u32 const item = layout_t::refs(m_ctrls, m_refs, seq.offset())->get(i);
+                        if (item < m_size && key == m_keys[item])
+                            return &m_values[item];
+                    }
+                    if (ctrl->has_empty() || seq.index() >= m_capacity)
+                        return nullptr;
+                    seq.next();
+                }
+            }
+
+            inline Value const* operator[](Key const& key) const { return find(key); }
+
+        private:
+            static bool is_valid(persist_header_t const* header, u64 file_size)
+            {
+                if (file_size < sizeof(persist_header_t))
+                    return false;
+                if (header->m_magic != persist_header_t::cMagic || header->m_version != persist_header_t::cVersion)
+                    return false;
+                if (header->m_hasher != (u32)Hasher::cId)
+                    return false;
+                if (header->m_sizeof_group != sizeof(group_t) || header->m_sizeof_refs != (layout_t::cSplit ? sizeof(Refs) : 0))
+                    return false;
+                if (header->m_sizeof_key != sizeof(Key) || header->m_sizeof_value != sizeof(Value))
+                    return false;
+                if (((header->m_capacity + 1) & header->m_capacity) != 0)
+                    return false;
+                u64 const num_groups = (u64)header->m_capacity + 1;
+                if ((u64)header->m_size > num_groups * group_t::cWidth)
+                    return false;
+
+                // every section has to be inside the file
+                return is_inside(header->m_ctrls, num_groups * sizeof(group_t), file_size) && is_inside(header->m_refs, num_groups * header->m_sizeof_refs, file_size) &&
+                       is_inside(header->m_keys, (u64)header->m_size * sizeof(Key), file_size) && is_inside(header->m_values, (u64)header->m_size * sizeof(Value), file_size);
+            }
+
+            // A section starts aligned after the header, an empty section is not written so its offset
+            // can be beyond the end of the file. The end is checked by subtraction, 'offset + size' can wrap.
+            static inline bool is_inside(u64 offset, u64 size, u64 file_size)
+            {
+                if (offset < sizeof(persist_header_t) || (offset & (persist_header_t::cAlign - 1)) != 0)
+                    return false;
+                return size == 0 || (offset <= file_size && size <= file_size - offset);
+            }
+
+            void const*    m_file;
+            u64            m_file_size;
+            group_t const* m_ctrls;
+            Refs const*    m_refs; // only used by the split layout
+            Key const*     m_keys;
+            Value const*   m_values;
+            u32            m_size;
+            u32            m_capacity;
+        };
+
+    } // namespace flat_hashmap_n
+
+} // namespace ncore
+
+#endif // __C_GENERICS_CONTAINERS_MAPPED_HASH_MAP_H__
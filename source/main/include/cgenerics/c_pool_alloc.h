@@ -0,0 +1,62 @@
+#ifndef __C_GENERICS_POOL_ALLOC_H__
+#define __C_GENERICS_POOL_ALLOC_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+
+namespace ncore
+{
+    // A fixed size block allocator for the nodes of node based containers. Blocks are carved from chunks
+    // that come from the backing allocator (nullptr = context_t::runtime_alloc()), a freed block goes on
+    // a free list and is the next one to be handed out, so allocate and deallocate are a few instructions
+    // and the nodes of a container stay packed together in memory. Blocks of 64 bytes and larger are cache
+    // line aligned. The chunks are only given back by release() and the destructor, release() drops all
+    // blocks at once, a container can use that to skip freeing its nodes one by one.
+    // A pool is not thread-safe.
+    class pool_alloc_t : public alloc_t
+    {
+    public:
+        enum
+        {
+            cChunkBytes = 64 * 1024, // default size of the chunks that blocks are carved from
+        };
+
+        pool_alloc_t(u32 block_size, alloc_t* allocator = nullptr, u32 chunk_bytes = cChunkBytes);
+        ~pool_alloc_t();
+
+        inline u32 block_size() const { return m_block_size; }
+        inline u32 used() const { return m_used; } // number of blocks that are allocated
+        inline u32 chunks() const { return m_chunks; }
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_release(); // drops all blocks and gives the chunks back
+
+    private:
+        pool_alloc_t(pool_alloc_t const&);            // not copyable
+        pool_alloc_t& operator=(pool_alloc_t const&); // not copyable
+
+        struct link_t
+        {
+            link_t* m_next;
+        };
+
+        alloc_t* m_alloc;
+        u32      m_block_size;
+        u32      m_alignment;
+        u32      m_chunk_blocks;
+        u32      m_used;
+        u32      m_chunks;
+        link_t*  m_free;       // freed blocks
+        link_t*  m_chunk_list; // the first block of every chunk links the chunks
+        u8*      m_cursor;     // the blocks of the newest chunk that were never handed out
+        u8*      m_cursor_end;
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_POOL_ALLOC_H__
@@ -0,0 +1,420 @@
+#ifndef __C_GENERICS_QUEUE_H__
+#define __C_GENERICS_QUEUE_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
+#include "cbase/c_debug.h"
+#include "cbase/c_memory.h"
+#include "cgenerics/c_backoff.h"
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+
+namespace ncore
+{
+    namespace queue_n
+    {
+        enum
+        {
+            cCacheLine   = 64,
+            cMaxCapacity = 0x40000000, // the indices wrap around u32, a full ring has to stay far from that
+        };
+
+        // The capacity rounded up to a power of two
+        inline u32 ring_capacity(u32 capacity)
+        {
+            ASSERT(capacity <= (u32)cMaxCapacity);
+            u32 c = 2;
+            while (c < capacity)
+                c <<= 1;
+            return c;
+        }
+    } // namespace queue_n
+
+    // A fixed capacity ring buffer queue for one producer thread and one consumer thread, lock-free and
+    // wait-free. The head (consumer) and the tail (producer) live on their own cache lines, and each
+    // side keeps a cached copy of the other side's index so it only reads the shared line when the
+    // ring looks full or empty. A batch is copied with at most two memcpy's and published with a
+    // single release store.
+    // The capacity is rounded up to a power of two, items have to be trivially copyable.
+    template <typename T> class spsc_queue_t
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "queue items have to be trivially copyable");
+
+    public:
+        spsc_queue_t(u32 capacity, alloc_t* allocator = nullptr)
+            : m_allocator(allocator != nullptr ? allocator : context_t::runtime_alloc())
+            , m_mask(queue_n::ring_capacity(capacity) - 1)
+        {
+            m_items = (T*)m_allocator->allocate((m_mask + 1) * (u32)sizeof(T), queue_n::cCacheLine);
+            m_head.store(0, std::memory_order_relaxed);
+            m_tail.store(0, std::memory_order_relaxed);
+            m_tail_cache = 0;
+            m_head_cache = 0;
+        }
+
+        ~spsc_queue_t() { m_allocator->deallocate(m_items); }
+
+        inline u32 capacity() const { return m_mask + 1; }
+
+        // A snapshot, only exact when neither side is running
+        inline u32  size() const { return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire); }
+        inline bool empty() const { return size() == 0; }
+
+        // Producer, returns false when the queue is full
+        bool try_push(T const& item)
+        {
+            u32 const tail = m_tail.load(std::memory_order_relaxed);
+            if ((tail - m_head_cache) > m_mask)
+            {
+                m_head_cache = m_head.load(std::memory_order_acquire);
+                if ((tail - m_head_cache) > m_mask)
+                    return false;
+            }
+            m_items[tail & m_mask] = item;
+            m_tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Producer, pushes as many of the 'n' items as there is room for, returns that number
+        u32 try_push(T const* items, u32 n)
+        {
+            u32 const tail = m_tail.load(std::memory_order_relaxed);
+            u32       room = (m_mask + 1) - (tail - m_head_cache);
+            if (room < n)
+            {
+                m_head_cache = m_head.load(std::memory_order_acquire);
+                room         = (m_mask + 1) - (tail - m_head_cache);
+            }
+            if (n > room)
+                n = room;
+            if (n == 0)
+                return 0;
+
+            u32 const at    = tail & m_mask;
+            u32 const first = (m_mask + 1 - at) < n ? (m_mask + 1 - at) : n;
+            nmem::memcpy(m_items + at, items, (u64)first * sizeof(T));
+            if (first < n)
+                nmem::memcpy(m_items, items + first, (u64)(n - first) * sizeof(T));
+            m_tail.store(tail + n, std::memory_order_release);
+            return n;
+        }
+
+        // Consumer, returns false when the queue is empty
+        bool try_pop(T& item)
+        {
+            u32 const head = m_head.load(std::memory_order_relaxed);
+            if (head == m_tail_cache)
+            {
+                m_tail_cache = m_tail.load(std::memory_order_acquire);
+                if (head == m_tail_cache)
+                    return false;
+            }
+            item = m_items[head & m_mask];
+            m_head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer, pops up to 'n' items, returns the number popped
+        u32 try_pop(T* items, u32 n)
+        {
+            u32 const head      = m_head.load(std::memory_order_relaxed);
+            u32       available = m_tail_cache - head;
+            if (available < n)
+            {
+                m_tail_cache = m_tail.load(std::memory_order_acquire);
+                available    = m_tail_cache - head;
+            }
+            if (n > available)
+                n = available;
+            if (n == 0)
+                return 0;
+
+            u32 const at    = head & m_mask;
+            u32 const first = (m_mask + 1 - at) < n ? (m_mask + 1 - at) : n;
+            nmem::memcpy(items, m_items + at, (u64)first * sizeof(T));
+            if (first < n)
+                nmem::memcpy(items + first, m_items, (u64)(n - first) * sizeof(T));
+            m_head.store(head + n, std::memory_order_release);
+            return n;
+        }
+
+        // Blocking versions, they spin and then yield until they can make progress
+        void push(T const& item)
+        {
+            backoff_t backoff;
+            while (!try_push(item))
+                backoff.wait();
+        }
+
+        void push(T const* items, u32 n)
+        {
+            backoff_t backoff;
+            while (n > 0)
+            {
+                u32 const pushed = try_push(items, n);
+                if (pushed == 0)
+                    backoff.wait();
+                items += pushed;
+                n -= pushed;
+            }
+        }
+
+        void pop(T& item)
+        {
+            backoff_t backoff;
+            while (!try_pop(item))
+                backoff.wait();
+        }
+
+        // Waits for at least one item, returns the number popped
+        u32 pop(T* items, u32 n)
+        {
+            backoff_t backoff;
+            u32                popped;
+            while ((popped = try_pop(items, n)) == 0 && n > 0)
+                backoff.wait();
+            return popped;
+        }
+
+    private:
+        // consumer line
+        alignas(queue_n::cCacheLine) std::atomic<u32> m_head;
+        u32                                           m_tail_cache;
+
+        // producer line
+        alignas(queue_n::cCacheLine) std::atomic<u32> m_tail;
+        u32                                           m_head_cache;
+
+        // read-only after construction
+        alignas(queue_n::cCacheLine) alloc_t* m_allocator;
+        u32      m_mask;
+        T*       m_items;
+
+        spsc_queue_t(spsc_queue_t const&);            // not copyable
+        spsc_queue_t& operator=(spsc_queue_t const&); // not copyable
+    };
+
+    // A bounded ring buffer queue for many producer and many consumer threads, lock-free (Dmitry
+    // Vyukov's bounded MPMC queue). Every slot has a sequence number that says whose turn it is: the
+    // producer of position p may write the slot when its sequence is p, it then sets it to p + 1, the
+    // consumer of position p may read it when it is p + 1 and then sets it to p + capacity, the
+    // position of the next lap. Producers and consumers claim positions with a CAS on their own
+    // (cache-line separated) counter and never touch the counter of the other side.
+    // A batch claims a run of consecutive ready slots with a single CAS.
+    // The capacity is rounded up to a power of two, items have to be trivially copyable.
+    template <typename T> class mpmc_queue_t
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "queue items have to be trivially copyable");
+
+    public:
+        mpmc_queue_t(u32 capacity, alloc_t* allocator = nullptr)
+            : m_allocator(allocator != nullptr ? allocator : context_t::runtime_alloc())
+            , m_mask(queue_n::ring_capacity(capacity) - 1)
+        {
+            m_cells = (cell_t*)m_allocator->allocate((m_mask + 1) * (u32)sizeof(cell_t), queue_n::cCacheLine);
+            for (u32 i = 0; i <= m_mask; ++i)
+                new (&m_cells[i].m_sequence) std::atomic<u32>(i);
+            m_enqueue.store(0, std::memory_order_relaxed);
+            m_dequeue.store(0, std::memory_order_relaxed);
+        }
+
+        ~mpmc_queue_t() { m_allocator->deallocate(m_cells); }
+
+        inline u32 capacity() const { return m_mask + 1; }
+
+        // A snapshot, only exact when no thread is pushing or popping
+        inline u32 size() const
+        {
+            u32 const dequeue = m_dequeue.load(std::memory_order_acquire);
+            u32 const enqueue = m_enqueue.load(std::memory_order_acquire);
+            return (s32)(enqueue - dequeue) > 0 ? enqueue - dequeue : 0;
+        }
+        inline bool empty() const { return size() == 0; }
+
+        // Returns false when the queue is full
+        bool try_push(T const& item)
+        {
+            u32 pos = m_enqueue.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell_t&   cell = m_cells[pos & m_mask];
+                s32 const diff = (s32)(cell.m_sequence.load(std::memory_order_acquire) - pos);
+                if (diff == 0)
+                {
+                    if (m_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.m_item = item;
+                        cell.m_sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false; // the consumer of the previous lap did not read the slot yet
+                }
+                else
+                {
+                    pos = m_enqueue.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Pushes up to 'n' items into consecutive free slots, returns the number pushed
+        u32 try_push(T const* items, u32 n)
+        {
+            u32 pos = m_enqueue.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                u32 ready = 0;
+                while (ready < n && ready <= m_mask && m_cells[(pos + ready) & m_mask].m_sequence.load(std::memory_order_acquire) == pos + ready)
+                    ready += 1;
+                if (ready == 0)
+                {
+                    s32 const diff = (s32)(m_cells[pos & m_mask].m_sequence.load(std::memory_order_acquire) - pos);
+                    if (diff < 0 || n == 0)
+                        return 0;
+                    pos = m_enqueue.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (m_enqueue.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed))
+                {
+                    for (u32 i = 0; i < ready; ++i)
+                    {
+                        cell_t& cell = m_cells[(pos + i) & m_mask];
+                        cell.m_item  = items[i];
+                        cell.m_sequence.store(pos + i + 1, std::memory_order_release);
+                    }
+                    return ready;
+                }
+            }
+        }
+
+        // Returns false when the queue is empty
+        bool try_pop(T& item)
+        {
+            u32 pos = m_dequeue.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell_t&   cell = m_cells[pos & m_mask];
+                s32 const diff = (s32)(cell.m_sequence.load(std::memory_order_acquire) - (pos + 1));
+                if (diff == 0)
+                {
+                    if (m_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        item = cell.m_item;
+                        cell.m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false; // the producer of this position did not write the slot yet
+                }
+                else
+                {
+                    pos = m_dequeue.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Pops up to 'n' items from consecutive written slots, returns the number popped
+        u32 try_pop(T* items, u32 n)
+        {
+            u32 pos = m_dequeue.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                u32 ready = 0;
+                while (ready < n && ready <= m_mask && m_cells[(pos + ready) & m_mask].m_sequence.load(std::memory_order_acquire) == pos + ready + 1)
+                    ready += 1;
+                if (ready == 0)
+                {
+                    s32 const diff = (s32)(m_cells[pos & m_mask].m_sequence.load(std::memory_order_acquire) - (pos + 1));
+                    if (diff < 0 || n == 0)
+                        return 0;
+                    pos = m_dequeue.load(std::memory_order_relaxed);
+                    continue;
+                }
+
+                if (m_dequeue.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed))
+                {
+                    for (u32 i = 0; i < ready; ++i)
+                    {
+                        cell_t& cell = m_cells[(pos + i) & m_mask];
+                        items[i]     = cell.m_item;
+                        cell.m_sequence.store(pos + i + m_mask + 1, std::memory_order_release);
+                    }
+                    return ready;
+                }
+            }
+        }
+
+        // Blocking versions, they spin and then yield until they can make progress
+        void push(T const& item)
+        {
+            backoff_t backoff;
+            while (!try_push(item))
+                backoff.wait();
+        }
+
+        void push(T const* items, u32 n)
+        {
+            backoff_t backoff;
+            while (n > 0)
+            {
+                u32 const pushed = try_push(items, n);
+                if (pushed == 0)
+                    backoff.wait();
+                items += pushed;
+                n -= pushed;
+            }
+        }
+
+        void pop(T& item)
+        {
+            backoff_t backoff;
+            while (!try_pop(item))
+                backoff.wait();
+        }
+
+        // Waits for at least one item, returns the number popped
+        u32 pop(T* items, u32 n)
+        {
+            backoff_t backoff;
+            u32                popped;
+            while ((popped = try_pop(items, n)) == 0 && n > 0)
+                backoff.wait();
+            return popped;
+        }
+
+    private:
+        struct cell_t
+        {
+            std::atomic<u32> m_sequence;
+            T                m_item;
+        };
+
+        // producer line
+        alignas(queue_n::cCacheLine) std::atomic<u32> m_enqueue;
+
+        // consumer line
+        alignas(queue_n::cCacheLine) std::atomic<u32> m_dequeue;
+
+        // read-only after construction
+        alignas(queue_n::cCacheLine) alloc_t* m_allocator;
+        u32      m_mask;
+        cell_t*  m_cells;
+
+        mpmc_queue_t(mpmc_queue_t const&);            // not copyable
+        mpmc_queue_t& operator=(mpmc_queue_t const&); // not copyable
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_QUEUE_H__
@@ -0,0 +1,571 @@
+#ifndef __C_GENERICS_SIMD_SEARCH_H__
+#define __C_GENERICS_SIMD_SEARCH_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "cbase/c_integer.h"
+
+#include <type_traits>
+
+// The search kernels are vectorized, the implementation is chosen at compile time depending on
+// the instruction set that the compiler is targetting, without SSE2 the scalar loops are used.
+// This is the one place that detects the instruction set, the hashmap groups use it as well.
+#if defined(__AVX2__)
+#    define CGENERICS_SIMD_AVX2
+#    define CGENERICS_SIMD_SSE2
+#    include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define CGENERICS_SIMD_SSE2
+#    include <emmintrin.h>
+#endif
+
+namespace ncore
+{
+    // Linear search kernels over arrays of arithmetic items (8, 16, 32 and 64 bit integers, f32 and f64).
+    // An item matches when it is == to the value, for floating point this means that NaN never matches
+    // and that -0.0 matches 0.0.
+    namespace simd_n
+    {
+        enum
+        {
+            cLaneNone = 0,
+            cLaneU8   = 1,
+            cLaneU16  = 2,
+            cLaneU32  = 4,
+            cLaneU64  = 8,
+            cLaneF32  = 16,
+            cLaneF64  = 32,
+        };
+
+        // The lane that an item type is searched as, signed integers are searched as unsigned ones
+        template <typename T> struct lane_of_t
+        {
+            enum
+            {
+                value = std::is_integral<T>::value ? (s32)sizeof(T) : (std::is_same<T, f32>::value ? (s32)cLaneF32 : (std::is_same<T, f64>::value ? (s32)cLaneF64 : (s32)cLaneNone))
+            };
+        };
+
+#if defined(CGENERICS_SIMD_SSE2)
+
+#    if defined(CGENERICS_SIMD_AVX2)
+        typedef __m256i vec_t;
+
+        inline vec_t vec_load(void const* p) { return _mm256_loadu_si256((__m256i const*)p); }
+        inline vec_t vec_or(vec_t a, vec_t b) { return _mm256_or_si256(a, b); }
+        inline u32   vec_mask(vec_t a) { return (u32)_mm256_movemask_epi8(a); }
+        inline u32   vec_full_mask() { return 0xffffffff; }
+        inline vec_t vec_zero() { return _mm256_setzero_si256(); }
+        inline vec_t vec_sub8(vec_t a, vec_t b) { return _mm256_sub_epi8(a, b); }
+        inline u64   vec_sum8(vec_t a)
+        {
+            __m256i const s = _mm256_sad_epu8(a, _mm256_setzero_si256());
+            return (u64)_mm256_extract_epi64(s, 0) + (u64)_mm256_extract_epi64(s, 1) + (u64)_mm256_extract_epi64(s, 2) + (u64)_mm256_extract_epi64(s, 3);
+        }
+#    else
+        typedef __m128i vec_t;
+
+        inline vec_t vec_load(void const* p) { return _mm_loadu_si128((__m128i const*)p); }
+        inline vec_t vec_or(vec_t a, vec_t b) { return _mm_or_si128(a, b); }
+        inline u32   vec_mask(vec_t a) { return (u32)_mm_movemask_epi8(a); }
+        inline u32   vec_full_mask() { return 0xffff; }
+        inline vec_t vec_zero() { return _mm_setzero_si128(); }
+        inline vec_t vec_sub8(vec_t a, vec_t b) { return _mm_sub_epi8(a, b); }
+        inline u64   vec_sum8(vec_t a)
+        {
+            __m128i const s = _mm_sad_epu8(a, _mm_setzero_si128());
+            return (u64)(u32)_mm_cvtsi128_si32(s) + (u64)(u32)_mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+        }
+#    endif
+
+        // Per lane type, broadcast a value and compare a vector of items to it, every byte of an equal
+        // item is set to 0xff so that vec_mask has sizeof(item) bits set per equal item.
+        template <s32 Lane> struct lane_t;
+
+        template <> struct lane_t<cLaneU8>
+        {
+            typedef u8 item_t;
+#    if defined(CGENERICS_SIMD_AVX2)
+            static inline vec_t set1(item_t v) { return _mm256_set1_epi8((char)v); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm256_cmpeq_epi8(a, b); }
+#    else
+            static inline vec_t set1(item_t v) { return _mm_set1_epi8((char)v); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm_cmpeq_epi8(a, b); }
+#    endif
+        };
+
+        template <> struct lane_t<cLaneU16>
+        {
+            typedef u16 item_t;
+#    if defined(CGENERICS_SIMD_AVX2)
+            static inline vec_t set1(item_t v) { return _mm256_set1_epi16((short)v); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm256_cmpeq_epi16(a, b); }
+#    else
+            static inline vec_t set1(item_t v) { return _mm_set1_epi16((short)v); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm_cmpeq_epi16(a, b); }
+#    endif
+        };
+
+        template <> struct lane_t<cLaneU32>
+        {
+            typedef u32 item_t;
+#    if defined(CGENERICS_SIMD_AVX2)
+            static inline vec_t set1(item_t v) { return _mm256_set1_epi32((int)v); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm256_cmpeq_epi32(a, b); }
+#    else
+            static inline vec_t set1(item_t v) { return _mm_set1_epi32((int)v); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm_cmpeq_epi32(a, b); }
+#    endif
+        };
+
+        template <> struct lane_t<cLaneU64>
+        {
+            typedef u64 item_t;
+#    if defined(CGENERICS_SIMD_AVX2)
+            static inline vec_t set1(item_t v) { return _mm256_set1_epi64x((long long)v); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm256_cmpeq_epi64(a, b); }
+#    else
+            static inline vec_t set1(item_t v) { return _mm_set1_epi64x((long long)v); }
+            static inline vec_t eq(vec_t a, vec_t b)
+            {
+                // SSE2 has no 64-bit compare, both 32-bit halves have to be equal
+                __m128i const e = _mm_cmpeq_epi32(a, b);
+                return _mm_and_si128(e, _mm_shuffle_epi32(e, _MM_SHUFFLE(2, 3, 0, 1)));
+            }
+#    endif
+        };
+
+        template <> struct lane_t<cLaneF32>
+        {
+            typedef f32 item_t;
+#    if defined(CGENERICS_SIMD_AVX2)
+            static inline vec_t set1(item_t v) { return _mm256_castps_si256(_mm256_set1_ps(v)); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_EQ_OQ)); }
+#    else
+            static inline vec_t set1(item_t v) { return _mm_castps_si128(_mm_set1_ps(v)); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))); }
+#    endif
+        };
+
+        template <> struct lane_t<cLaneF64>
+        {
+            typedef f64 item_t;
+#    if defined(CGENERICS_SIMD_AVX2)
+            static inline vec_t set1(item_t v) { return _mm256_castpd_si256(_mm256_set1_pd(v)); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_EQ_OQ)); }
+#    else
+            static inline vec_t set1(item_t v) { return _mm_castpd_si128(_mm_set1_pd(v)); }
+            static inline vec_t eq(vec_t a, vec_t b) { return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))); }
+#    endif
+        };
+
+        // Index of the first item == 'v', or -1. Four vectors are tested per iteration so that a
+        // long scan is bound by the memory bandwidth and not by the branches.
+        template <s32 Lane> inline s32 find(typename lane_t<Lane>::item_t const* items, u32 n, typename lane_t<Lane>::item_t v)
+        {
+            typedef lane_t<Lane> lane;
+            u32 const            W   = (u32)(sizeof(vec_t) / sizeof(v));
+            vec_t const          key = lane::set1(v);
+
+            u32 i = 0;
+            for (; (i + 4 * W) <= n; i += 4 * W)
+            {
+                vec_t const a = lane::eq(vec_load(items + i), key);
+                vec_t const b = lane::eq(vec_load(items + i + W), key);
+                vec_t const c = lane::eq(vec_load(items + i + 2 * W), key);
+                vec_t const d = lane::eq(vec_load(items + i + 3 * W), key);
+                if (vec_mask(vec_or(vec_or(a, b), vec_or(c, d))) != 0)
+                {
+                    u32 m = vec_mask(a);
+                    if (m != 0)
+                        return (s32)(i + math::countTrailingZeros(m) / sizeof(v));
+                    m = vec_mask(b);
+                    if (m != 0)
+                        return (s32)(i + W + math::countTrailingZeros(m) / sizeof(v));
+                    m = vec_mask(c);
+                    if (m != 0)
+                        return (s32)(i + 2 * W + math::countTrailingZeros(m) / sizeof(v));
+                    return (s32)(i + 3 * W + math::countTrailingZeros(vec_mask(d)) / sizeof(v));
+                }
+            }
+            for (; (i + W) <= n; i += W)
+            {
+                u32 const m = vec_mask(lane::eq(vec_load(items + i), key));
+                if (m != 0)
+                    return (s32)(i + math::countTrailingZeros(m) / sizeof(v));
+            }
+            for (; i < n; ++i)
+            {
+                if (items[i] == v)
+                    return (s32)i;
+            }
+            return -1;
+        }
+
+        // Number of items == 'v'. Every byte of an equal item is 0xff (-1), subtracting the compare
+        // results counts per byte, the byte counters are summed before they can overflow (255 vectors).
+        // The sum counts sizeof(item) bytes per equal item.
+        template <s32 Lane> inline u32 count(typename lane_t<Lane>::item_t const* items, u32 n, typename lane_t<Lane>::item_t v)
+        {
+            typedef lane_t<Lane> lane;
+            u32 const            W   = (u32)(sizeof(vec_t) / sizeof(v));
+            vec_t const          key = lane::set1(v);
+
+            u64 bytes = 0;
+            u32 i     = 0;
+            while ((i + W) <= n)
+            {
+                u32 block = (n - i) / W;
+                if (block > 255)
+                    block = 255;
+
+                vec_t acc = vec_zero();
+                for (u32 b = 0; b < block; ++b, i += W)
+                    acc = vec_sub8(acc, lane::eq(vec_load(items + i), key));
+                bytes += vec_sum8(acc);
+            }
+
+            u32 c = (u32)(bytes / sizeof(v));
+            for (; i < n; ++i)
+                c += (items[i] == v) ? 1 : 0;
+            return c;
+        }
+
+        // Index of the first byte that differs, or 'n'
+        inline u32 mismatch(void const* a, void const* b, u32 n)
+        {
+            u8 const* pa = (u8 const*)a;
+            u8 const* pb = (u8 const*)b;
+            u32 const W  = (u32)sizeof(vec_t);
+
+            u32 i = 0;
+            for (; (i + W) <= n; i += W)
+            {
+                u32 const m = vec_mask(lane_t<cLaneU8>::eq(vec_load(pa + i), vec_load(pb + i)));
+                if (m != vec_full_mask())
+                    return i + math::countTrailingZeros(~m);
+            }
+            for (; i < n; ++i)
+            {
+                if (pa[i] != pb[i])
+                    return i;
+            }
+            return n;
+        }
+
+#else
+
+        template <s32 Lane> struct lane_t;
+        template <> struct lane_t<cLaneU8>
+        {
+            typedef u8 item_t;
+        };
+        template <> struct lane_t<cLaneU16>
+        {
+            typedef u16 item_t;
+        };
+        template <> struct lane_t<cLaneU32>
+        {
+            typedef u32 item_t;
+        };
+        template <> struct lane_t<cLaneU64>
+        {
+            typedef u64 item_t;
+        };
+        template <> struct lane_t<cLaneF32>
+        {
+            typedef f32 item_t;
+        };
+        template <> struct lane_t<cLaneF64>
+        {
+            typedef f64 item_t;
+        };
+
+        template <s32 Lane> inline s32 find(typename lane_t<Lane>::item_t const* items, u32 n, typename lane_t<Lane>::item_t v)
+        {
+            for (u32 i = 0; i < n; ++i)
+            {
+                if (items[i] == v)
+                    return (s32)i;
+            }
+            return -1;
+        }
+
+        template <s32 Lane> inline u32 count(typename lane_t<Lane>::item_t const* items, u32 n, typename lane_t<Lane>::item_t v)
+        {
+            u32 c = 0;
+            for (u32 i = 0; i < n; ++i)
+                c += (items[i] == v) ? 1 : 0;
+            return c;
+        }
+
+        inline u32 mismatch(void const* a, void const* b, u32 n)
+        {
+            u8 const* pa = (u8 const*)a;
+            u8 const* pb = (u8 const*)b;
+            for (u32 i = 0; i < n; ++i)
+            {
+                if (pa[i] != pb[i])
+                    return i;
+            }
+            return n;
+        }
+
+#endif
+
+        // find, count, equal and compare over 'n' items of type T, arithmetic types use the kernels
+        // and any other type is compared item by item with == and value_compare semantics (< and >).
+        template <typename T, s32 Lane = lane_of_t<T>::value> struct search_t
+        {
+            static inline s32 find(T const* items, u32 n, T const& v)
+            {
+                for (u32 i = 0; i < n; ++i)
+                {
+                    if (!(v < items[i]) && !(v > items[i]))
+                        return (s32)i;
+                }
+                return -1;
+            }
+
+            static inline u32 count(T const* items, u32 n, T const& v)
+            {
+                u32 c = 0;
+                for (u32 i = 0; i < n; ++i)
+                    c += (v == items[i]) ? 1 : 0;
+                return c;
+            }
+
+            static inline bool equal(T const* a, T const* b, u32 n)
+            {
+                for (u32 i = 0; i < n; ++i)
+                {
+                    if (!(a[i] == b[i]))
+                        return false;
+                }
+                return true;
+            }
+
+            static inline s32 compare(T const* a, T const* b, u32 n)
+            {
+                for (u32 i = 0; i < n; ++i)
+                {
+                    if (a[i] < b[i])
+                        return -1;
+                    if (a[i] > b[i])
+                        return 1;
+                }
+                return 0;
+            }
+        };
+
+        // Integers, equal items have equal bytes so the first differing byte gives the first differing item
+        template <typename T, s32 Lane> struct search_int_t : public search_t<T, cLaneNone>
+        {
+            typedef typename lane_t<Lane>::item_t item_t;
+
+            static inline s32 find(T const* items, u32 n, T const& v) { return simd_n::find<Lane>((item_t const*)items, n, (item_t)v); }
+            static inline u32 count(T const* items, u32 n, T const& v) { return simd_n::count<Lane>((item_t const*)items, n, (item_t)v); }
+            static inline bool equal(T const* a, T const* b, u32 n) { return mismatch(a, b, n * (u32)sizeof(T)) == n * (u32)sizeof(T); }
+            static inline s32 compare(T const* a, T const* b, u32 n)
+            {
+                u32 const i = mismatch(a, b, n * (u32)sizeof(T)) / (u32)sizeof(T);
+                if (i >= n)
+                    return 0;
+                return a[i] < b[i] ? -1 : 1;
+            }
+        };
+
+        template <typename T> struct search_t<T, cLaneU8> : public search_int_t<T, cLaneU8>
+        {
+        };
+        template <typename T> struct search_t<T, cLaneU16> : public search_int_t<T, cLaneU16>
+        {
+        };
+        template <typename T> struct search_t<T, cLaneU32> : public search_int_t<T, cLaneU32>
+        {
+        };
+        template <typename T> struct search_t<T, cLaneU64> : public search_int_t<T, cLaneU64>
+        {
+        };
+
+        // Floating point, equal and compare stay scalar since the bytes of -0.0 and 0.0 differ
+        template <typename T> struct search_t<T, cLaneF32> : public search_t<T, cLaneNone>
+        {
+            static inline s32 find(T const* items, u32 n, T const& v) { return simd_n::find<cLaneF32>(items, n, v); }
+            static inline u32 count(T const* items, u32 n, T const& v) { return simd_n::count<cLaneF32>(items, n, v); }
+        };
+        template <typename T> struct search_t<T, cLaneF64> : public search_t<T, cLaneNone>
+        {
+            static inline s32 find(T const* items, u32 n, T const& v) { return simd_n::find<cLaneF64>(items, n, v); }
+            static inline u32 count(T const* items, u32 n, T const& v) { return simd_n::count<cLaneF64>(items, n, v); }
+        };
+
+        // Hint to the CPU that 'ptr' will be read soon, 'ptr' does not have to be valid
+        inline void prefetch(const void* ptr)
+        {
+#if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(ptr);
+#elif defined(CGENERICS_SIMD_SSE2)
+            _mm_prefetch((const char*)ptr, _MM_HINT_T0);
+#else
+            (void)ptr;
+#endif
+        }
+
+        // Spin-wait hint, lets the other hyper-thread of the core run while a thread polls
+        inline void pause()
+        {
+#if defined(CGENERICS_SIMD_SSE2)
+            _mm_pause();
+#endif
+        }
+
+        // The number of items in a sorted 64-byte node that are < 'v', the node holds 64 / sizeof(T) items
+        // and is 16 byte aligned. The < compares of the whole node form a prefix of set bits in the
+        // byte mask, so the rank is the number of trailing ones.
+        template <typename T> struct node_rank_t
+        {
+            enum
+            {
+                cItems = 64 / sizeof(T),
+                cSimd  = 0,
+            };
+
+            static inline u32 rank(T const* node, T const& v)
+            {
+                u32 r = 0;
+                for (u32 i = 0; i < cItems; ++i)
+                    r += (node[i] < v) ? 1 : 0;
+                return r;
+            }
+        };
+
+#if defined(CGENERICS_SIMD_SSE2)
+        // Per item type a vector 'a < b', every byte of a lower item is set to 0xff
+        template <typename T> struct less_t;
+
+#    if defined(CGENERICS_SIMD_AVX2)
+        template <> struct less_t<s32>
+        {
+            static inline vec_t set1(s32 v) { return _mm256_set1_epi32(v); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm256_cmpgt_epi32(b, a); }
+        };
+        template <> struct less_t<u32>
+        {
+            static inline vec_t set1(u32 v) { return _mm256_set1_epi32((int)(v ^ 0x80000000u)); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm256_cmpgt_epi32(b, _mm256_xor_si256(a, _mm256_set1_epi32((int)0x80000000u))); }
+        };
+        template <> struct less_t<s64>
+        {
+            static inline vec_t set1(s64 v) { return _mm256_set1_epi64x(v); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm256_cmpgt_epi64(b, a); }
+        };
+        template <> struct less_t<u64>
+        {
+            static inline vec_t set1(u64 v) { return _mm256_set1_epi64x((long long)(v ^ 0x8000000000000000ull)); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm256_cmpgt_epi64(b, _mm256_xor_si256(a, _mm256_set1_epi64x((long long)0x8000000000000000ull))); }
+        };
+        template <> struct less_t<f32>
+        {
+            static inline vec_t set1(f32 v) { return _mm256_castps_si256(_mm256_set1_ps(v)); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _CMP_LT_OQ)); }
+        };
+        template <> struct less_t<f64>
+        {
+            static inline vec_t set1(f64 v) { return _mm256_castpd_si256(_mm256_set1_pd(v)); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(b), _CMP_LT_OQ)); }
+        };
+#    else
+        template <> struct less_t<s32>
+        {
+            static inline vec_t set1(s32 v) { return _mm_set1_epi32(v); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm_cmplt_epi32(a, b); }
+        };
+        template <> struct less_t<u32>
+        {
+            static inline vec_t set1(u32 v) { return _mm_set1_epi32((int)(v ^ 0x80000000u)); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm_cmplt_epi32(_mm_xor_si128(a, _mm_set1_epi32((int)0x80000000u)), b); }
+        };
+        template <> struct less_t<f32>
+        {
+            static inline vec_t set1(f32 v) { return _mm_castps_si128(_mm_set1_ps(v)); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm_castps_si128(_mm_cmplt_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b))); }
+        };
+        template <> struct less_t<f64>
+        {
+            static inline vec_t set1(f64 v) { return _mm_castpd_si128(_mm_set1_pd(v)); }
+            static inline vec_t lt(vec_t a, vec_t b) { return _mm_castpd_si128(_mm_cmplt_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b))); }
+        };
+#    endif
+
+        template <typename T> struct node_rank_simd_t
+        {
+            enum
+            {
+                cItems = 64 / sizeof(T),
+                cSimd  = 1,
+            };
+
+            static inline u32 rank(T const* node, T const& v)
+            {
+                u32 const   W   = (u32)sizeof(vec_t);
+                vec_t const key = less_t<T>::set1(v);
+
+                u64 mask = 0;
+                for (u32 i = 0; i < 64; i += W)
+                    mask |= (u64)vec_mask(less_t<T>::lt(vec_load((u8 const*)node + i), key)) << i;
+                if (~mask == 0)
+                    return cItems;
+                return (u32)math::countTrailingZeros(~mask) / (u32)sizeof(T);
+            }
+        };
+
+        template <> struct node_rank_t<s32> : public node_rank_simd_t<s32>
+        {
+        };
+        template <> struct node_rank_t<u32> : public node_rank_simd_t<u32>
+        {
+        };
+        template <> struct node_rank_t<f32> : public node_rank_simd_t<f32>
+        {
+        };
+        template <> struct node_rank_t<f64> : public node_rank_simd_t<f64>
+        {
+        };
+#    if defined(CGENERICS_SIMD_AVX2)
+        template <> struct node_rank_t<s64> : public node_rank_simd_t<s64>
+        {
+        };
+        template <> struct node_rank_t<u64> : public node_rank_simd_t<u64>
+        {
+        };
+#    endif
+#endif
+
+        // The number of 'n' sorted items that are < 'v'. With SIMD the items are ranked 64 bytes at a time
+        // with node_rank_t and the scan stops at the first 64 bytes that hold an item >= 'v', without
+        // it a plain scan that stops at the first item >= 'v' is faster.
+        template <typename T> inline u32 rank(T const* items, u32 n, T const& v)
+        {
+            u32 i = 0;
+            if (node_rank_t<T>::cSimd)
+            {
+                u32 const C = node_rank_t<T>::cItems;
+                for (; (i + C) <= n; i += C)
+                {
+                    u32 const r = node_rank_t<T>::rank(items + i, v);
+                    if (r < C)
+                        return i + r;
+                }
+            }
+            while (i < n && items[i] < v)
+                ++i;
+            return i;
+        }
+
+    } // namespace simd_n
+} // namespace ncore
+
+#endif // __C_GENERICS_SIMD_SEARCH_H__
@@ -0,0 +1,419 @@
+#ifndef __C_GENERICS_CONTAINERS_SNAPSHOT_HASH_MAP_H__
+#define __C_GENERICS_CONTAINERS_SNAPSHOT_HASH_MAP_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
+#include "cgenerics/c_flat_hash_map.h"
+
+#include <atomic>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+namespace ncore
+{
+    namespace flat_hashmap_n
+    {
+        // Epoch based reclamation for a single writer and up to 'cMaxReaders' reader threads.
+        // A reader announces the global epoch it observed before touching shared memory and clears
+        // it when done, memory retired by the writer at epoch E can be freed once no reader is
+        // still active in an epoch <= E. Readers never wait, only the writer does.
+        class epoch_t
+        {
+        public:
+            enum
+            {
+                cMaxReaders = 64
+            };
+
+            epoch_t()
+                : m_global(1)
+                , m_num_readers(0)
+            {
+                for (u32 i = 0; i < cMaxReaders; ++i)
+                    m_readers[i].m_epoch.store(cIdle, std::memory_order_relaxed);
+            }
+
+            // Returns the reader index to pass to enter/leave, one per reader thread
+            u32 register_reader()
+            {
+                u32 const r = m_num_readers.fetch_add(1, std::memory_order_relaxed);
+                ASSERTS(r < cMaxReaders, "too many readers");
+                return r;
+            }
+
+            inline void enter(u32 reader) { m_readers[reader].m_epoch.store(m_global.load(std::memory_order_seq_cst), std::memory_order_seq_cst); }
+            inline void leave(u32 reader) { m_readers[reader].m_epoch.store(cIdle, std::memory_order_release); }
+
+            // Writer, returns the epoch at which the memory unpublished just before this call is retired
+            inline u64 retire() { return m_global.fetch_add(1, std::memory_order_seq_cst); }
+
+            // Writer, memory retired at 'epoch' can be freed when this returns true
+            bool is_safe(u64 epoch) const
+            {
+                u32 const n = m_num_readers.load(std::memory_order_acquire);
+                for (u32 i = 0; i < n && i < cMaxReaders; ++i)
+                {
+                    if (m_readers[i].m_epoch.load(std::memory_order_seq_cst) <= epoch)
+                        return false;
+                }
+                return true;
+            }
+
+        private:
+            static const u64 cIdle = 0xffffffffffffffffULL;
+
+            // One cache-line per reader, readers only ever write their own line
+            struct reader_t
+            {
+                std::atomic<u64> m_epoch;
+                u8               m_padding[64 - sizeof(std::atomic<u64>)];
+            };
+
+            std::atomic<u64> m_global;
+            std::atomic<u32> m_num_readers;
+            reader_t         m_readers[cMaxReaders];
+        };
+
+        // A hash map for a single writer thread and many reader threads, readers do not take any locks
+        // and never wait. The writer publishes a table through an atomic pointer, when a table runs
+        // out of room the writer builds a new table, publishes it and retires the old one which is
+        // freed once no reader can still be using it (see epoch_t).
+        //
+        // Unlike hashmap_t the items of a table are write-once, an erase only turns the slot into a
+        // tombstone and never moves another item into the hole, so a reader can never observe a torn
+        // key or value. A new item is fully written before its ref (release) and before the group
+        // state (release) that makes it visible. The used/deleted bitmaps of a group are a single
+        // 64-bit word so a reader can never see a slot as empty while it transitions.
+        //
+        // Key and Value have to be trivially copyable, a table is freed without running destructors.
+        template <typename Key, typename Value, typename Hasher = DefaultHash<Key>> class snapshot_hashmap_t
+        {
+            static_assert(std::is_trivially_copyable<Key>::value, "snapshot keys must be trivially copyable");
+            static_assert(std::is_trivially_copyable<Value>::value, "snapshot values must be trivially copyable");
+
+        public:
+            snapshot_hashmap_t(u32 size = 64, alloc_t* allocator = nullptr)
+                : m_allocator(allocator != nullptr ? allocator : context_t::runtime_alloc())
+                , m_size(0)
+                , m_num_retired(0)
+            {
+                u32 const groups = normalize_groups(size);
+                m_writer         = create_table(groups);
+                ASSERTS(m_writer != nullptr, "out of memory");
+                m_table.store(m_writer, std::memory_order_release);
+            }
+
+            ~snapshot_hashmap_t()
+            {
+                for (u32 i = 0; i < m_num_retired; ++i)
+                    destroy_table(m_retired[i].m_table);
+                destroy_table(m_writer);
+            }
+
+            u32 size() const { return m_size; }
+
+            // Reader API, every reader thread registers once and passes its index to find
+            u32 register_reader() { return m_epoch.register_reader(); }
+
+            // Copies the value of 'key' into 'value', wait-free
+            bool find(u32 reader, Key const& key, Value& value) const
+            {
+                m_epoch.enter(reader);
+                table_t const* table = m_table.load(std::memory_order_acquire);
+                Value const*   v     = find_in(table, key);
+                if (v != nullptr)
+                    value = *v;
+                m_epoch.leave(reader);
+                return v != nullptr;
+            }
+
+            // Writer API, only one thread may call these
+
+            Value const* find(Key const& key) const { return find_in(m_writer, key); }
+
+            bool insert(Key const& key, Value const& value)
+            {
+                Hasher    hasher;
+                u64 const hash = hasher(&key);
+                if (find_in(m_writer, key, hash) != nullptr)
+                    return false;
+
+                // Out of memory, the map is left as it was
+                if (m_writer->m_count == m_writer->m_max_items || m_writer->m_growth_left == 0)
+                {
+                    if (!grow())
+                        return false;
+                }
+
+                insert_new(m_writer, key, value, hash);
+                m_size += 1;
+                return true;
+            }
+
+            bool erase(Key const& key)
+            {
+                Hasher    hasher;
+                u64 const hash = hasher(&key);
+                group_t*  group;
+                s8        slot;
+                if (!find_slot(m_writer, key, hash, group, slot))
+                    return false;
+
+                u64 const state   = group->m_state.load(std::memory_order_relaxed);
+                u64 const used    = ((u64)1 << slot);
+                u64 const deleted = ((u64)1 << (32 + slot));
+                group->m_state.store((state | deleted) & ~used, std::memory_order_release);
+                m_size -= 1;
+                return true;
+            }
+
+            // Writer, frees the tables that are no longer in use by any reader
+            void reclaim()
+            {
+                u32 n = 0;
+                for (u32 i = 0; i < m_num_retired; ++i)
+                {
+                    if (m_epoch.is_safe(m_retired[i].m_epoch))
+                        destroy_table(m_retired[i].m_table);
+                    else
+                        m_retired[n++] = m_retired[i];
+                }
+                m_num_retired = n;
+            }
+
+        private:
+            // A group as seen by the readers, every field is accessed atomically
+            struct group_t
+            {
+                std::atomic<u64> m_state; // low 32 bits: used, high 32 bits: deleted
+                std::atomic<u32> m_hash[ctrl_meta_t::cWidth / 4];
+                std::atomic<u32> m_refs[ctrl_meta_t::cWidth];
+            };
+
+            struct table_t
+            {
+                u32      m_capacity; // number of groups - 1
+                u32      m_count;    // number of items written, including erased ones
+                u32      m_max_items;
+                u32      m_growth_left;
+                group_t* m_groups;
+                Key*     m_keys;
+                Value*   m_values;
+            };
+
+            struct retired_t
+            {
+                table_t* m_table;
+                u64      m_epoch;
+            };
+
+            enum
+            {
+                cMaxRetired = 32
+            };
+
+            inline u32 normalize_groups(u32 size) const
+            {
+                u32 groups = 2;
+                while ((groups * ctrl_meta_t::cWidth * 7 / 8) < size)
+                    groups *= 2;
+                return groups;
+            }
+
+            // Returns nullptr when the allocator runs out of memory
+            table_t* create_table(u32 groups)
+            {
+                u32 const slots     = groups * ctrl_meta_t::cWidth;
+                u32 const max_items = slots * 7 / 8;
+
+                table_t* table = (table_t*)m_allocator->allocate(sizeof(table_t), sizeof(void*));
+                if (table == nullptr)
+                    return nullptr;
+                table->m_capacity    = groups - 1;
+                table->m_count       = 0;
+                table->m_max_items   = max_items;
+                table->m_growth_left = max_items;
+                table->m_groups      = (group_t*)m_allocator->allocate(sizeof(group_t) * groups, 64);
+                table->m_keys        = (Key*)m_allocator->allocate(sizeof(Key) * max_items, sizeof(void*));
+                table->m_values      = (Value*)m_allocator->allocate(sizeof(Value) * max_items, sizeof(void*));
+                if (table->m_groups == nullptr || table->m_keys == nullptr || table->m_values == nullptr)
+                {
+                    destroy_table(table);
+                    return nullptr;
+                }
+                for (u32 g = 0; g < groups; ++g)
+                {
+                    group_t* group = new (&table->m_groups[g]) group_t();
+                    group->m_state.store(0, std::memory_order_relaxed);
+                    for (u32 i = 0; i < ctrl_meta_t::cWidth / 4; ++i)
+                        group->m_hash[i].store(0, std::memory_order_relaxed);
+                    for (u32 i = 0; i < ctrl_meta_t::cWidth; ++i)
+                        group->m_refs[i].store(0, std::memory_order_relaxed);
+                }
+                return table;
+            }
+
+            void destroy_table(table_t* table)
+            {
+                if (table->m_groups != nullptr)
+                    m_allocator->deallocate(table->m_groups);
+                if (table->m_keys != nullptr)
+                    m_allocator->deallocate(table->m_keys);
+                if (table->m_values != nullptr)
+                    m_allocator->deallocate(table->m_values);
+                m_allocator->deallocate(table);
+            }
+
+            // Take a consistent copy of the metadata of a group so that we can use the (SIMD) match
+            static inline u32 load_group(group_t const* group, ctrl_meta_t& meta)
+            {
+                u64 const state = group->m_state.load(std::memory_order_acquire);
+                for (u32 i = 0; i < ctrl_meta_t::cWidth / 4; ++i)
+                    meta.m_hash_DW[i] = group->m_hash[i].load(std::memory_order_relaxed);
+                meta.m_empty   = ~((u32)state | (u32)(state >> 32));
+                meta.m_deleted = (u32)(state >> 32);
+                return (u32)state;
+            }
+
+            inline Value const* find_in(table_t const* table, Key const& key) const
+            {
+                Hasher hasher;
+                return find_in(table, key, hasher(&key));
+            }
+
+            Value const* find_in(table_t const* table, Key const& key, u64 hash) const
+            {
+                group_t* group;
+                s8       slot;
+                u32      item;
+                if (!find_slot(table, key, hash, group, slot, &item))
+                    return nullptr;
+                return &table->m_values[item];
+            }
+
+            bool find_slot(table_t const* table, Key const& key, u64 hash, group_t*& group, s8& slot, u32* item = nullptr) const
+            {
+                h2_t const h = H2(hash);
+                probe_t    seq(H1(hash, table), table->m_capacity);
+                while (true)
+                {
+                    group_t*    g = &table->m_groups[seq.offset()];
+                    ctrl_meta_t meta;
+                    u32 const   used    = load_group(g, meta);
+                    bitmask_t   bitmask = meta.match(h, used);
+                    for (s8 i : bitmask)
+                    {
+                        u32 const ref = g->m_refs[i].load(std::memory_order_acquire);
+                        if (key == table->m_keys[ref])
+                        {
+                            group = g;
+                            slot  = i;
+                            if (item != nullptr)
+                                *item = ref;
+                            return true;
+                        }
+                    }
+                    if (meta.has_empty())
+                        return false;
+                    seq.next();
+                    if (seq.index() > table->m_capacity)
+                        return false;
+                }
+            }
+
+            // Writer, the item is written first, then its ref and hash and finally the group state
+            void insert_new(table_t* table, Key const& key, Value const& value, u64 hash)
+            {
+                u32 const item = table->m_count++;
+                new (&table->m_keys[item]) Key(key);
+                new (&table->m_values[item]) Value(value);
+
+                probe_t seq(H1(hash, table), table->m_capacity);
+                while (true)
+                {
+                    group_t*  group = &table->m_groups[seq.offset()];
+                    u64 const state = group->m_state.load(std::memory_order_relaxed);
+                    u32 const free  = ~(u32)state; // empty or deleted
+                    if (free != 0)
+                    {
+                        s8 const slot = (s8)math::findFirstBit(free);
+                        if ((((u32)state | (u32)(state >> 32)) & ((u32)1 << slot)) == 0)
+                            table->m_growth_left -= 1; // slot was empty, not a tombstone
+
+                        group->m_refs[slot].store(item, std::memory_order_release);
+
+                        u32 const word  = group->m_hash[slot >> 2].load(std::memory_order_relaxed);
+                        u32 const shift = (slot & 3) * 8;
+                        group->m_hash[slot >> 2].store((word & ~((u32)0xFF << shift)) | ((u32)H2(hash) << shift), std::memory_order_relaxed);
+
+                        u64 const used    = ((u64)1 << slot);
+                        u64 const deleted = ((u64)1 << (32 + slot));
+                        group->m_state.store((state | used) & ~deleted, std::memory_order_release);
+                        return;
+                    }
+                    seq.next();
+                    ASSERTS(seq.index() <= table->m_capacity, "full table!");
+                }
+            }
+
+            // Writer, build a new table with all the live items and publish it, returns false when
+            // the new table can not be allocated and keeps the current one
+            bool grow()
+            {
+                table_t* old    = m_writer;
+                u32      groups = old->m_capacity + 1;
+                if ((u64)m_size * 2 > old->m_max_items)
+                    groups *= 2; // mostly live items, otherwise mostly tombstones and we keep the size
+
+                table_t* table = create_table(groups);
+                if (table == nullptr)
+                    return false;
+                Hasher   hasher;
+                for (u32 g = 0; g <= old->m_capacity; ++g)
+                {
+                    group_t*  group = &old->m_groups[g];
+                    u64 const state = group->m_state.load(std::memory_order_relaxed);
+                    bitmask_t used  = (u32)state;
+                    for (s8 i : used)
+                    {
+                        u32 const item = group->m_refs[i].load(std::memory_order_relaxed);
+                        insert_new(table, old->m_keys[item], old->m_values[item], hasher(&old->m_keys[item]));
+                    }
+                }
+
+                m_writer = table;
+                m_table.store(table, std::memory_order_seq_cst);
+
+                // Readers that entered before this point may still use the old table
+                while (m_num_retired == cMaxRetired)
+                {
+                    reclaim();
+                    if (m_num_retired == cMaxRetired)
+                        std::this_thread::yield();
+                }
+                m_retired[m_num_retired].m_table = old;
+                m_retired[m_num_retired].m_epoch = m_epoch.retire();
+                m_num_retired += 1;
+                reclaim();
+                return true;
+            }
+
+            alloc_t*              m_allocator;
+            std::atomic<table_t*> m_table;  // published table, read by the readers
+            table_t*              m_writer; // same table as m_table, private to the writer
+            u32                   m_size;
+            u32                   m_num_retired;
+            retired_t             m_retired[cMaxRetired];
+            mutable epoch_t       m_epoch;
+        };
+
+    } // namespace flat_hashmap_n
+
+} // namespace ncore
+
+#endif // __C_GENERICS_CONTAINERS_SNAPSHOT_HASH_MAP_H__
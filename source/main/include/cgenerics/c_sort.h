@@ -0,0 +1,976 @@
+#ifndef __C_GENERICS_SORT_H__
+#define __C_GENERICS_SORT_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_debug.h"
+#include "cbase/c_integer.h"
+#include "cbase/c_memory.h"
+#include "cgenerics/c_vector.h"
+
+#include <thread>
+#include <type_traits>
+
+namespace ncore
+{
+    namespace sort_n
+    {
+        enum
+        {
+            cInsertionSortItems = 24,      // ranges below this are insertion sorted
+            cNintherItems       = 128,     // ranges above this take the pivot from a median of medians
+            cPartialInsertions  = 8,       // moves a partial insertion sort may do before it gives up
+            cBlockItems         = 64,      // items per block of the branchless partition
+            cRadixItemsPerByte  = 512,     // pdqsort beats radix_sort below this many items per key byte
+            cRadixCacheBytes    = 1 << 20, // radix_sort does a MSD pass first when the items are larger
+            cMaxThreads         = 64,      // parallel_sort uses at most this many threads
+            cMinParallelItems   = 1 << 16, // parallel_sort gives every thread at least this many items
+        };
+
+        // The ascending order of value_compare, (value_compare(lhs, rhs) < 0). The sort functions detect
+        // this order and radix sort integers and floats with it.
+        template <typename T> struct value_less_t
+        {
+            inline bool operator()(T const& lhs, T const& rhs) const { return lhs < rhs; }
+        };
+
+        template <typename T> inline void swap_items(T* a, T* b)
+        {
+            T tmp(static_cast<T&&>(*a));
+            *a = static_cast<T&&>(*b);
+            *b = static_cast<T&&>(tmp);
+        }
+
+        // ------------------------------------------------------------------------------------------
+        // pdqsort, pattern-defeating quicksort (Orson Peters). Quicksort with a median-of-3 or ninther
+        // pivot, insertion sort for small ranges and heapsort as the fallback when partitions keep
+        // being unbalanced, so it is O(n log n) in the worst case. Patterns are cheap:
+        // - a range that the partition did not change is finished with a partial insertion sort, that
+        //   makes sorted and reversed input linear
+        // - a pivot equal to the item before the range puts all the equal items in place at once, that
+        //   makes input with few distinct values linear
+        // - unbalanced partitions shuffle a few items to break the pattern
+        // Arithmetic items are partitioned branchless (BlockQuicksort), the compares fill offset blocks
+        // and the items are swapped afterwards, so a random pivot costs no mispredictions.
+        namespace pdq_n
+        {
+            template <typename T, typename Less> inline void insertion_sort(T* begin, T* end, Less& less)
+            {
+                if (begin == end)
+                    return;
+                for (T* cur = begin + 1; cur != end; ++cur)
+                {
+                    T* sift   = cur;
+                    T* sift_1 = cur - 1;
+                    if (less(*sift, *sift_1))
+                    {
+                        T tmp(static_cast<T&&>(*sift));
+                        do
+                        {
+                            *sift-- = static_cast<T&&>(*sift_1);
+                        } while (sift != begin && less(tmp, *--sift_1));
+                        *sift = static_cast<T&&>(tmp);
+                    }
+                }
+            }
+
+            // There is an item before 'begin' that is not greater than any item in the range
+            template <typename T, typename Less> inline void unguarded_insertion_sort(T* begin, T* end, Less& less)
+            {
+                if (begin == end)
+                    return;
+                for (T* cur = begin + 1; cur != end; ++cur)
+                {
+                    T* sift   = cur;
+                    T* sift_1 = cur - 1;
+                    if (less(*sift, *sift_1))
+                    {
+                        T tmp(static_cast<T&&>(*sift));
+                        do
+                        {
+                            *sift-- = static_cast<T&&>(*sift_1);
+                        } while (less(tmp, *--sift_1));
+                        *sift = static_cast<T&&>(tmp);
+                    }
+                }
+            }
+
+            // Returns false when it gives up after cPartialInsertions moves, the range is then not sorted
+            template <typename T, typename Less> inline bool partial_insertion_sort(T* begin, T* end, Less& less)
+            {
+                if (begin == end)
+                    return true;
+                u32 moves = 0;
+                for (T* cur = begin + 1; cur != end; ++cur)
+                {
+                    T* sift   = cur;
+                    T* sift_1 = cur - 1;
+                    if (less(*sift, *sift_1))
+                    {
+                        T tmp(static_cast<T&&>(*sift));
+                        do
+                        {
+                            *sift-- = static_cast<T&&>(*sift_1);
+                        } while (sift != begin && less(tmp, *--sift_1));
+                        *sift = static_cast<T&&>(tmp);
+                        moves += (u32)(cur - sift);
+                    }
+                    if (moves > cPartialInsertions)
+                        return false;
+                }
+                return true;
+            }
+
+            template <typename T, typename Less> inline void sort2(T* a, T* b, Less& less)
+            {
+                if (less(*b, *a))
+                    swap_items(a, b);
+            }
+
+            template <typename T, typename Less> inline void sort3(T* a, T* b, T* c, Less& less)
+            {
+                sort2(a, b, less);
+                sort2(b, c, less);
+                sort2(a, b, less);
+            }
+
+            template <typename T, typename Less> void sift_down(T* items, ptr_t i, ptr_t n, Less& less)
+            {
+                T tmp(static_cast<T&&>(items[i]));
+                for (;;)
+                {
+                    ptr_t child = 2 * i + 1;
+                    if (child >= n)
+                        break;
+                    if (child + 1 < n && less(items[child], items[child + 1]))
+                        child += 1;
+                    if (!less(tmp, items[child]))
+                        break;
+                    items[i] = static_cast<T&&>(items[child]);
+                    i        = child;
+                }
+                items[i] = static_cast<T&&>(tmp);
+            }
+
+            template <typename T, typename Less> void heap_sort(T* begin, T* end, Less& less)
+            {
+                ptr_t const n = (ptr_t)(end - begin);
+                for (ptr_t i = n / 2; i > 0; --i)
+                    sift_down(begin, i - 1, n, less);
+                for (ptr_t i = n; i > 1; --i)
+                {
+                    swap_items(begin, begin + (i - 1));
+                    sift_down(begin, 0, i - 1, less);
+                }
+            }
+
+            // Partitions around the pivot at *begin, the items equal to the pivot go to the left.
+            // Used when the pivot equals the item before the range, then everything that is not
+            // greater than the pivot is already in its final place. Returns the pivot position.
+            template <typename T, typename Less> T* partition_left(T* begin, T* end, Less& less)
+            {
+                T  pivot(static_cast<T&&>(*begin));
+                T* first = begin;
+                T* last  = end;
+
+                while (less(pivot, *--last))
+                {
+                }
+                if (last + 1 == end)
+                {
+                    while (first < last && !less(pivot, *++first))
+                    {
+                    }
+                }
+                else
+                {
+                    while (!less(pivot, *++first))
+                    {
+                    }
+                }
+
+                while (first < last)
+                {
+                    swap_items(first, last);
+                    while (less(pivot, *--last))
+                    {
+                    }
+                    while (!less(pivot, *++first))
+                    {
+                    }
+                }
+
+                T* pivot_pos = last;
+                *begin       = static_cast<T&&>(*pivot_pos);
+                *pivot_pos   = static_cast<T&&>(pivot);
+                return pivot_pos;
+            }
+
+            // Partitions around the pivot at *begin, the items equal to the pivot go to the right.
+            // Returns the pivot position, 'already_partitioned' is set when no item had to be moved.
+            template <typename T, typename Less> T* partition_right(T* begin, T* end, Less& less, bool& already_partitioned)
+            {
+                T  pivot(static_cast<T&&>(*begin));
+                T* first = begin;
+                T* last  = end;
+
+                // the median of 3 guarantees an item >= pivot on the right, the first loop needs no bound
+                while (less(*++first, pivot))
+                {
+                }
+                if (first - 1 == begin)
+                {
+                    while (first < last && !less(*--last, pivot))
+                    {
+                    }
+                }
+                else
+                {
+                    while (!less(*--last, pivot))
+                    {
+                    }
+                }
+
+                already_partitioned = first >= last;
+                while (first < last)
+                {
+                    swap_items(first, last);
+                    while (less(*++first, pivot))
+                    {
+                    }
+                    while (!less(*--last, pivot))
+                    {
+                    }
+                }
+
+                T* pivot_pos = first - 1;
+                *begin       = static_cast<T&&>(*pivot_pos);
+                *pivot_pos   = static_cast<T&&>(pivot);
+                return pivot_pos;
+            }
+
+            // Swaps the items at the offsets of the left block with the items at the offsets of the
+            // right block. With the same number on both sides a cyclic permutation saves a move per item,
+            // but then descending input would not be partitioned in linear time, so that case swaps.
+            template <typename T> inline void swap_offsets(T* first, T* last, u8 const* offsets_l, u8 const* offsets_r, u32 num, bool use_swaps)
+            {
+                if (use_swaps)
+                {
+                    for (u32 i = 0; i < num; ++i)
+                        swap_items(first + offsets_l[i], last - offsets_r[i]);
+                }
+                else if (num > 0)
+                {
+                    T* l = first + offsets_l[0];
+                    T* r = last - offsets_r[0];
+                    T  tmp(static_cast<T&&>(*l));
+                    *l = static_cast<T&&>(*r);
+                    for (u32 i = 1; i < num; ++i)
+                    {
+                        l  = first + offsets_l[i];
+                        *r = static_cast<T&&>(*l);
+                        r  = last - offsets_r[i];
+                        *l = static_cast<T&&>(*r);
+                    }
+                    *r = static_cast<T&&>(tmp);
+                }
+            }
+
+            // partition_right without branches on the compares
+            template <typename T, typename Less> T* partition_right_branchless(T* begin, T* end, Less& less, bool& already_partitioned)
+            {
+                T  pivot(static_cast<T&&>(*begin));
+                T* first = begin;
+                T* last  = end;
+
+                while (less(*++first, pivot))
+                {
+                }
+                if (first - 1 == begin)
+                {
+                    while (first < last && !less(*--last, pivot))
+                    {
+                    }
+                }
+                else
+                {
+                    while (!less(*--last, pivot))
+                    {
+                    }
+                }
+
+                already_partitioned = first >= last;
+                if (!already_partitioned)
+                {
+                    swap_items(first, last);
+                    ++first;
+
+                    // the offsets of the items that are on the wrong side, relative to the block bases
+                    alignas(64) u8 offsets_l[cBlockItems];
+                    alignas(64) u8 offsets_r[cBlockItems];
+
+                    T*  offsets_l_base = first;
+                    T*  offsets_r_base = last;
+                    u32 num_l          = 0;
+                    u32 num_r          = 0;
+                    u32 start_l        = 0;
+                    u32 start_r        = 0;
+
+                    while (first < last)
+                    {
+                        // the number of items to look at for each block, a block that still has
+                        // offsets is not refilled
+                        u32 const num_unknown = (u32)(last - first);
+                        u32 const left_split  = num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+                        u32 const right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+                        if (left_split >= (u32)cBlockItems)
+                        {
+                            for (u32 i = 0; i < (u32)cBlockItems;)
+                            {
+                                offsets_l[num_l] = (u8)i++;
+                                num_l += !less(*first, pivot);
+                                ++first;
+                                offsets_l[num_l] = (u8)i++;
+                                num_l += !less(*first, pivot);
+                                ++first;
+                                offsets_l[num_l] = (u8)i++;
+                                num_l += !less(*first, pivot);
+                                ++first;
+                                offsets_l[num_l] = (u8)i++;
+                                num_l += !less(*first, pivot);
+                                ++first;
+                            }
+                        }
+                        else
+                        {
+                            for (u32 i = 0; i < left_split;)
+                            {
+                                offsets_l[num_l] = (u8)i++;
+                                num_l += !less(*first, pivot);
+                                ++first;
+                            }
+                        }
+
+                        if (right_split >= (u32)cBlockItems)
+                        {
+                            for (u32 i = 0; i < (u32)cBlockItems;)
+                            {
+                                offsets_r[num_r] = (u8)++i;
+                                num_r += less(*--last, pivot);
+                                offsets_r[num_r] = (u8)++i;
+                                num_r += less(*--last, pivot);
+                                offsets_r[num_r] = (u8)++i;
+                                num_r += less(*--last, pivot);
+                                offsets_r[num_r] = (u8)++i;
+                                num_r += less(*--last, pivot);
+                            }
+                        }
+                        else
+                        {
+                            for (u32 i = 0; i < right_split;)
+                            {
+                                offsets_r[num_r] = (u8)++i;
+                                num_r += less(*--last, pivot);
+                            }
+                        }
+
+                        u32 const num = num_l < num_r ? num_l : num_r;
+                        swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+                        num_l -= num;
+                        num_r -= num;
+                        start_l += num;
+                        start_r += num;
+
+                        if (num_l == 0)
+                        {
+                            start_l        = 0;
+                            offsets_l_base = first;
+                        }
+                        if (num_r == 0)
+                        {
+                            start_r        = 0;
+                            offsets_r_base = last;
+                        }
+                    }
+
+                    // one block has offsets left, their items go to the end of the other side
+                    if (num_l)
+                    {
+                        u8 const* offsets = offsets_l + start_l;
+                        while (num_l--)
+                            swap_items(offsets_l_base + offsets[num_l], --last);
+                        first = last;
+                    }
+                    if (num_r)
+                    {
+                        u8 const* offsets = offsets_r + start_r;
+                        while (num_r--)
+                        {
+                            swap_items(offsets_r_base - offsets[num_r], first);
+                            ++first;
+                        }
+                        last = first;
+                    }
+                }
+
+                T* pivot_pos = first - 1;
+                *begin       = static_cast<T&&>(*pivot_pos);
+                *pivot_pos   = static_cast<T&&>(pivot);
+                return pivot_pos;
+            }
+
+            template <typename T, typename Less, bool Branchless> struct partitioner_t
+            {
+                static inline T* partition(T* begin, T* end, Less& less, bool& already_partitioned) { return partition_right(begin, end, less, already_partitioned); }
+            };
+
+            template <typename T, typename Less> struct partitioner_t<T, Less, true>
+            {
+                static inline T* partition(T* begin, T* end, Less& less, bool& already_partitioned) { return partition_right_branchless(begin, end, less, already_partitioned); }
+            };
+
+            // 'bad_allowed' is the number of unbalanced partitions left before heapsort takes over,
+            // 'leftmost' is false when the item before 'begin' is a pivot that is <= every item.
+            template <typename T, typename Less, bool Branchless> void sort_loop(T* begin, T* end, Less& less, s32 bad_allowed, bool leftmost)
+            {
+                for (;;)
+                {
+                    ptr_t const size = (ptr_t)(end - begin);
+                    if (size < (ptr_t)cInsertionSortItems)
+                    {
+                        if (leftmost)
+                            insertion_sort(begin, end, less);
+                        else
+                            unguarded_insertion_sort(begin, end, less);
+                        return;
+                    }
+
+                    // the pivot is moved to *begin
+                    ptr_t const s2 = size / 2;
+                    if (size > (ptr_t)cNintherItems)
+                    {
+                        sort3(begin, begin + s2, end - 1, less);
+                        sort3(begin + 1, begin + (s2 - 1), end - 2, less);
+                        sort3(begin + 2, begin + (s2 + 1), end - 3, less);
+                        sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), less);
+                        swap_items(begin, begin + s2);
+                    }
+                    else
+                    {
+                        sort3(begin + s2, begin, end - 1, less);
+                    }
+
+                    // the pivot equals the item before the range, the items equal to it are done
+                    if (!leftmost && !less(*(begin - 1), *begin))
+                    {
+                        begin = partition_left(begin, end, less) + 1;
+                        continue;
+                    }
+
+                    bool      already_partitioned = false;
+                    T* const  pivot_pos           = partitioner_t<T, Less, Branchless>::partition(begin, end, less, already_partitioned);
+                    ptr_t const l_size            = (ptr_t)(pivot_pos - begin);
+                    ptr_t const r_size            = (ptr_t)(end - (pivot_pos + 1));
+
+                    if (l_size < size / 8 || r_size < size / 8)
+                    {
+                        if (--bad_allowed == 0)
+                        {
+                            heap_sort(begin, end, less);
+                            return;
+                        }
+
+                        if (l_size >= (ptr_t)cInsertionSortItems)
+                        {
+                            swap_items(begin, begin + l_size / 4);
+                            swap_items(pivot_pos - 1, pivot_pos - l_size / 4);
+                            if (l_size > (ptr_t)cNintherItems)
+                            {
+                                swap_items(begin + 1, begin + (l_size / 4 + 1));
+                                swap_items(begin + 2, begin + (l_size / 4 + 2));
+                                swap_items(pivot_pos - 2, pivot_pos - (l_size / 4 + 1));
+                                swap_items(pivot_pos - 3, pivot_pos - (l_size / 4 + 2));
+                            }
+                        }
+                        if (r_size >= (ptr_t)cInsertionSortItems)
+                        {
+                            swap_items(pivot_pos + 1, pivot_pos + (1 + r_size / 4));
+                            swap_items(end - 1, end - r_size / 4);
+                            if (r_size > (ptr_t)cNintherItems)
+                            {
+                                swap_items(pivot_pos + 2, pivot_pos + (2 + r_size / 4));
+                                swap_items(pivot_pos + 3, pivot_pos + (3 + r_size / 4));
+                                swap_items(end - 2, end - (1 + r_size / 4));
+                                swap_items(end - 3, end - (2 + r_size / 4));
+                            }
+                        }
+                    }
+                    else if (already_partitioned && partial_insertion_sort(begin, pivot_pos, less) && partial_insertion_sort(pivot_pos + 1, end, less))
+                    {
+                        return;
+                    }
+
+                    // recurse into the left part, loop on the right part
+                    sort_loop<T, Less, Branchless>(begin, pivot_pos, less, bad_allowed, leftmost);
+                    begin    = pivot_pos + 1;
+                    leftmost = false;
+                }
+            }
+        } // namespace pdq_n
+
+        // Sorts 'n' items in place, not stable, O(n log n) worst case
+        template <typename T, typename Less> void pdqsort(T* items, u32 n, Less less)
+        {
+            if (n < 2)
+                return;
+            s32 const bad_allowed = (s32)(31 - math::countLeadingZeros(n));
+            pdq_n::sort_loop<T, Less, std::is_arithmetic<T>::value>(items, items + n, less, bad_allowed, true);
+        }
+
+        // ------------------------------------------------------------------------------------------
+        // LSD radix sort, one pass of 8 bits per key byte starting at the lowest byte. The histograms
+        // of all the bytes are counted in a single read of the input, a byte that is the same for
+        // every key (e.g. the upper bytes of small ids) skips its pass. The item ends up in a position
+        // that only depends on its key, so the time does not depend on the order of the input.
+        // The key of a signed integer flips the sign bit, the key of a float flips the sign bit of
+        // positive numbers and all the bits of negative numbers, the unsigned order of the keys is
+        // then the order of the values (NaN's with the sign bit set sort first, the others last).
+        enum
+        {
+            cRadixUnsigned = 0,
+            cRadixSigned   = 1,
+            cRadixFloat    = 2,
+        };
+
+        template <u32 Bytes> struct radix_bits_t;
+        template <> struct radix_bits_t<1>
+        {
+            typedef u8 type;
+        };
+        template <> struct radix_bits_t<2>
+        {
+            typedef u16 type;
+        };
+        template <> struct radix_bits_t<4>
+        {
+            typedef u32 type;
+        };
+        template <> struct radix_bits_t<8>
+        {
+            typedef u64 type;
+        };
+
+        // Integers and floats of 1, 2, 4 or 8 bytes can be radix sorted
+        template <typename T> struct is_radix_sortable_t
+        {
+            enum
+            {
+                value = std::is_arithmetic<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8)
+            };
+        };
+
+        template <typename T> struct radix_kind_t
+        {
+            enum
+            {
+                value = std::is_floating_point<T>::value ? cRadixFloat : (std::is_signed<T>::value ? cRadixSigned : cRadixUnsigned)
+            };
+        };
+
+        template <typename T, s32 Kind = radix_kind_t<T>::value> struct radix_key_t
+        {
+            typedef typename radix_bits_t<sizeof(T)>::type bits_t;
+            static inline bits_t key(T v) { return (bits_t)v; }
+        };
+
+        template <typename T> struct radix_key_t<T, cRadixSigned>
+        {
+            typedef typename radix_bits_t<sizeof(T)>::type bits_t;
+            static inline bits_t key(T v) { return (bits_t)((bits_t)v ^ ((bits_t)1 << (sizeof(T) * 8 - 1))); }
+        };
+
+        template <typename T> struct radix_key_t<T, cRadixFloat>
+        {
+            typedef typename radix_bits_t<sizeof(T)>::type bits_t;
+            static inline bits_t key(T v)
+            {
+                bits_t bits;
+                nmem::memcpy(&bits, &v, sizeof(T));
+                bits_t const sign = bits >> (sizeof(T) * 8 - 1);
+                return bits ^ ((bits_t)(0 - sign) | ((bits_t)1 << (sizeof(T) * 8 - 1)));
+            }
+        };
+
+        // Below this many items pdqsort is faster, every key byte is a pass of radix_sort
+        template <typename T> inline u32 radix_min_items() { return (u32)cRadixItemsPerByte * (u32)sizeof(T); }
+
+        namespace radix_n
+        {
+            // The histograms of all the key bytes in one read of the items
+            template <typename T> void count(T const* items, u32 n, u32 (*counts)[256])
+            {
+                typedef radix_key_t<T>          key_t;
+                typedef typename key_t::bits_t bits_t;
+
+                nmem::memset(counts, 0, sizeof(T) * 256 * sizeof(u32));
+                for (u32 i = 0; i < n; ++i)
+                {
+                    bits_t const k = key_t::key(items[i]);
+                    for (u32 p = 0; p < (u32)sizeof(T); ++p)
+                        counts[p][(k >> (p * 8)) & 0xff] += 1;
+                }
+            }
+
+            template <typename T> inline u32 byte_of(T v, u32 p) { return (u32)(radix_key_t<T>::key(v) >> (p * 8)) & 0xff; }
+
+            // Turns a histogram into the write positions
+            inline void prefix_sum(u32* count)
+            {
+                u32 offset = 0;
+                for (u32 b = 0; b < 256; ++b)
+                {
+                    u32 const c = count[b];
+                    count[b]    = offset;
+                    offset += c;
+                }
+            }
+
+            template <typename T> inline void scatter(T const* src, T* dst, u32 n, u32* offsets, u32 p)
+            {
+                for (u32 i = 0; i < n; ++i)
+                {
+                    T const v                        = src[i];
+                    dst[offsets[byte_of(v, p)]++] = v;
+                }
+            }
+
+            // The LSD passes over the bytes below 'passes', the items ping-pong between 'src' and
+            // 'dst', returns the one that holds the sorted items
+            template <typename T> T* lsd(T* src, T* dst, u32 n, u32 (*counts)[256], u32 passes)
+            {
+                for (u32 p = 0; p < passes; ++p)
+                {
+                    if (counts[p][byte_of(src[0], p)] == n)
+                        continue;
+                    prefix_sum(counts[p]);
+                    scatter(src, dst, n, counts[p], p);
+                    T* const tmp = src;
+                    src          = dst;
+                    dst          = tmp;
+                }
+                return src;
+            }
+
+            // Sorts the items in 'src' on the bytes below 'passes', returns the one of 'src' and 'dst'
+            // that holds the sorted items.
+            // When the items do not fit in the cache every LSD pass would scatter them over main
+            // memory, so the highest byte that is not constant goes first (MSD) and splits the items
+            // into 256 buckets, which are sorted the same way until they fit in the cache. Buckets that
+            // are small are finished with pdqsort.
+            template <typename T> T* sort_bytes(T* src, T* dst, u32 n, u32 passes)
+            {
+                u32 counts[sizeof(T)][256];
+                count(src, n, counts);
+
+                // the highest byte that is not the same for every item
+                s32 top = (s32)passes - 1;
+                while (top >= 0 && counts[top][byte_of(src[0], (u32)top)] == n)
+                    top -= 1;
+                if (top < 0)
+                    return src;
+
+                if (top == 0 || ((u64)n * sizeof(T)) <= (u64)cRadixCacheBytes)
+                    return lsd(src, dst, n, counts, (u32)top + 1);
+
+                u32 buckets[257];
+                buckets[0] = 0;
+                for (u32 b = 0; b < 256; ++b)
+                    buckets[b + 1] = buckets[b] + counts[top][b];
+
+                prefix_sum(counts[top]);
+                scatter(src, dst, n, counts[top], (u32)top);
+
+                value_less_t<T> less;
+                for (u32 b = 0; b < 256; ++b)
+                {
+                    u32 const begin = buckets[b];
+                    u32 const size  = buckets[b + 1] - begin;
+                    if (size < radix_min_items<T>())
+                    {
+                        pdqsort(dst + begin, size, less);
+                        continue;
+                    }
+                    T const* sorted = sort_bytes(dst + begin, src + begin, size, (u32)top);
+                    if (sorted != dst + begin)
+                        nmem::memcpy(dst + begin, sorted, (u64)size * sizeof(T));
+                }
+                return dst;
+            }
+        } // namespace radix_n
+
+        // Sorts 'n' items, 'scratch' has room for 'n' items and is clobbered
+        template <typename T> void radix_sort(T* items, u32 n, T* scratch)
+        {
+            static_assert(is_radix_sortable_t<T>::value, "radix_sort sorts integers and floats");
+
+            if (n < 2)
+                return;
+            T const* sorted = radix_n::sort_bytes(items, scratch, n, (u32)sizeof(T));
+            if (sorted != items)
+                nmem::memcpy(items, sorted, (u64)n * sizeof(T));
+        }
+
+        // A scratch buffer for 'n' items, nullptr when its size does not fit the u32 of alloc_t or
+        // when the allocator is out of memory. The callers then fall back to pdqsort.
+        template <typename T> inline T* allocate_scratch(alloc_t* allocator, u32 n)
+        {
+            u64 const size = (u64)n * sizeof(T);
+            if (size >= ((u64)1 << 32))
+                return nullptr;
+            return (T*)allocator->allocate((u32)size, (u32)alignof(T));
+        }
+
+        // Sorts 'n' items with a scratch buffer from 'allocator'
+        template <typename T> void radix_sort(T* items, u32 n, alloc_t* allocator)
+        {
+            if (n < 2)
+                return;
+            T* scratch = allocate_scratch<T>(allocator, n);
+            if (scratch == nullptr)
+            {
+                pdqsort(items, n, value_less_t<T>());
+                return;
+            }
+            radix_sort(items, n, scratch);
+            allocator->deallocate(scratch);
+        }
+
+        // ------------------------------------------------------------------------------------------
+        // The serial sort of a range, the ascending order of integers and floats radix sorts large
+        // ranges, everything else goes to pdqsort.
+        template <typename T, typename Less, bool Radix = is_radix_sortable_t<T>::value && std::is_same<Less, value_less_t<T> >::value> struct sorter_t
+        {
+            static inline bool uses_scratch(u32 n) { return false; }
+            static inline void sort(T* items, u32 n, Less& less, T* scratch) { pdqsort(items, n, less); }
+        };
+
+        template <typename T, typename Less> struct sorter_t<T, Less, true>
+        {
+            static inline bool uses_scratch(u32 n) { return n >= radix_min_items<T>(); }
+            static inline void sort(T* items, u32 n, Less& less, T* scratch)
+            {
+                if (n >= radix_min_items<T>())
+                    radix_sort(items, n, scratch);
+                else
+                    pdqsort(items, n, less);
+            }
+        };
+
+        // Sorts 'n' items, a radix sort allocates its scratch buffer from 'allocator'
+        template <typename T, typename Less> void sort(T* items, u32 n, Less less, alloc_t* allocator)
+        {
+            if (!sorter_t<T, Less>::uses_scratch(n))
+            {
+                sorter_t<T, Less>::sort(items, n, less, nullptr);
+                return;
+            }
+            T* scratch = allocate_scratch<T>(allocator, n);
+            if (scratch == nullptr)
+            {
+                pdqsort(items, n, less);
+                return;
+            }
+            sorter_t<T, Less>::sort(items, n, less, scratch);
+            allocator->deallocate(scratch);
+        }
+
+        // ------------------------------------------------------------------------------------------
+        // Parallel merge sort. The input is cut into one run per thread and every thread sorts its run
+        // with the serial sort. Then rounds of merges halve the number of runs, in every round each
+        // thread writes an equal share of the output: the start of its share in a pair of runs is
+        // found with a binary search (the merge path co-rank), so a round is balanced no matter how
+        // many pairs there are. The rounds ping-pong between the items and a scratch buffer.
+        namespace parallel_n
+        {
+            // The number of items of 'a' among the first 'k' items of the stable merge of 'a' and 'b'
+            template <typename T, typename Less> inline u32 corank(T const* a, u32 na, T const* b, u32 nb, u32 k, Less& less)
+            {
+                u32 lo = k > nb ? k - nb : 0;
+                u32 hi = k < na ? k : na;
+                while (lo < hi)
+                {
+                    u32 const i = (lo + hi) >> 1;
+                    if (less(b[k - i - 1], a[i]))
+                        hi = i;
+                    else
+                        lo = i + 1;
+                }
+                return lo;
+            }
+
+            template <typename T, typename Less> inline void merge(T const* a, T const* a_end, T const* b, T const* b_end, T* out, Less& less)
+            {
+                while (a < a_end && b < b_end)
+                {
+                    if (less(*b, *a))
+                        *out++ = *b++;
+                    else
+                        *out++ = *a++;
+                }
+                while (a < a_end)
+                    *out++ = *a++;
+                while (b < b_end)
+                    *out++ = *b++;
+            }
+
+            // Writes output items [lo, hi) of a merge round, run i spans [runs[i], runs[i + 1])
+            template <typename T, typename Less> void merge_share(T const* src, T* dst, u32 const* runs, u32 num_runs, u32 lo, u32 hi, Less less)
+            {
+                for (u32 r = 0; r < num_runs; r += 2)
+                {
+                    u32 const begin = runs[r];
+                    u32 const end   = runs[(r + 2) < num_runs ? (r + 2) : num_runs];
+                    u32 const s     = lo > begin ? lo : begin;
+                    u32 const e     = hi < end ? hi : end;
+                    if (s >= e)
+                        continue;
+
+                    if ((r + 1) == num_runs)
+                    {
+                        // the last run has no partner
+                        nmem::memcpy(dst + s, src + s, (u64)(e - s) * sizeof(T));
+                        continue;
+                    }
+
+                    u32 const mid = runs[r + 1];
+                    T const*  a   = src + begin;
+                    T const*  b   = src + mid;
+                    u32 const na  = mid - begin;
+                    u32 const nb  = end - mid;
+                    u32 const i0  = corank(a, na, b, nb, s - begin, less);
+                    u32 const i1  = corank(a, na, b, nb, e - begin, less);
+                    merge(a + i0, a + i1, b + (s - begin - i0), b + (e - begin - i1), dst + s, less);
+                }
+            }
+
+            template <typename T, typename Less> void sort(T* items, u32 n, Less less, u32 threads, alloc_t* allocator)
+            {
+                T* scratch = allocate_scratch<T>(allocator, n);
+                if (scratch == nullptr)
+                {
+                    pdqsort(items, n, less);
+                    return;
+                }
+
+                u32 runs[cMaxThreads + 1];
+                for (u32 t = 0; t <= threads; ++t)
+                    runs[t] = (u32)(((u64)n * t) / threads);
+
+                std::thread workers[cMaxThreads];
+
+                // Phase 1: sort the runs, a radix sort uses the part of the scratch buffer of its run
+                for (u32 t = 0; t < threads; ++t)
+                {
+                    workers[t] = std::thread([=]() {
+                        Less run_less(less);
+                        sorter_t<T, Less>::sort(items + runs[t], runs[t + 1] - runs[t], run_less, scratch + runs[t]);
+                    });
+                }
+                for (u32 t = 0; t < threads; ++t)
+                    workers[t].join();
+
+                // Phase 2: merge pairs of runs until one run is left
+                T*  src      = items;
+                T*  dst      = scratch;
+                u32 num_runs = threads;
+                while (num_runs > 1)
+                {
+                    for (u32 t = 0; t < threads; ++t)
+                    {
+                        u32 const lo = (u32)(((u64)n * t) / threads);
+                        u32 const hi = (u32)(((u64)n * (t + 1)) / threads);
+                        workers[t]   = std::thread([=, &runs]() { merge_share(src, dst, runs, num_runs, lo, hi, less); });
+                    }
+                    for (u32 t = 0; t < threads; ++t)
+                        workers[t].join();
+
+                    u32 merged = 0;
+                    for (u32 r = 0; r < num_runs; r += 2)
+                        runs[merged++] = runs[r];
+                    runs[merged] = n;
+                    num_runs     = merged;
+
+                    T* const tmp = src;
+                    src          = dst;
+                    dst          = tmp;
+                }
+
+                if (src != items)
+                {
+                    for (u32 t = 0; t < threads; ++t)
+                    {
+                        u32 const lo = (u32)(((u64)n * t) / threads);
+                        u32 const hi = (u32)(((u64)n * (t + 1)) / threads);
+                        workers[t]   = std::thread([=]() { nmem::memcpy(items + lo, src + lo, (u64)(hi - lo) * sizeof(T)); });
+                    }
+                    for (u32 t = 0; t < threads; ++t)
+                        workers[t].join();
+                }
+
+                allocator->deallocate(scratch);
+            }
+
+            // The merges copy items as bytes, other types are sorted by the calling thread
+            template <typename T, typename Less, bool Trivial = std::is_trivially_copyable<T>::value> struct dispatch_t
+            {
+                static inline void sort(T* items, u32 n, Less& less, u32 threads, alloc_t* allocator) { sort_n::sort(items, n, less, allocator); }
+            };
+
+            template <typename T, typename Less> struct dispatch_t<T, Less, true>
+            {
+                static inline void sort(T* items, u32 n, Less& less, u32 threads, alloc_t* allocator) { parallel_n::sort(items, n, less, threads, allocator); }
+            };
+        } // namespace parallel_n
+
+        // Sorts 'n' items with up to 'threads' threads, 0 means the number of hardware threads. Every
+        // thread gets at least cMinParallelItems items, smaller inputs are sorted by the calling thread.
+        // Only trivially copyable items are sorted in parallel. Needs a scratch buffer of 'n' items,
+        // without one the calling thread sorts the items with pdqsort.
+        template <typename T, typename Less> void parallel_sort(T* items, u32 n, Less less, u32 threads, alloc_t* allocator)
+        {
+            if (threads == 0)
+                threads = std::thread::hardware_concurrency();
+            if (threads > (u32)cMaxThreads)
+                threads = cMaxThreads;
+            if (threads > n / (u32)cMinParallelItems)
+                threads = n / (u32)cMinParallelItems;
+
+            if (threads <= 1)
+                sort(items, n, less, allocator);
+            else
+                parallel_n::dispatch_t<T, Less>::sort(items, n, less, threads, allocator);
+        }
+
+        // ------------------------------------------------------------------------------------------
+        // vector_t, scratch memory comes from the allocator of the vector
+
+        // Sorts the items in the order of value_compare, integers and floats with a radix sort and
+        // other types with pdqsort. Not stable.
+        template <typename T> inline void sort(vector_t<T>& items) { sort(items.begin(), items.size(), value_less_t<T>(), items.allocator()); }
+
+        // Sorts the items with pdqsort, 'less(lhs, rhs)' has to be a strict weak order
+        template <typename T, typename Less> inline void sort(vector_t<T>& items, Less less) { sort(items.begin(), items.size(), less, items.allocator()); }
+
+        // Sorts the items like sort(items) with up to 'threads' threads, 0 means the number of hardware
+        // threads. Small vectors and items that are not trivially copyable are sorted by this thread.
+        template <typename T> inline void parallel_sort(vector_t<T>& items, u32 threads = 0) { parallel_sort(items.begin(), items.size(), value_less_t<T>(), threads, items.allocator()); }
+        template <typename T, typename Less> inline void parallel_sort(vector_t<T>& items, u32 threads, Less less) { parallel_sort(items.begin(), items.size(), less, threads, items.allocator()); }
+
+    } // namespace sort_n
+} // namespace ncore
+
+#endif // __C_GENERICS_SORT_H__
@@ -0,0 +1,281 @@
+#ifndef __C_GENERICS_SORTED_INDEX_H__
+#define __C_GENERICS_SORTED_INDEX_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
+#include "cbase/c_debug.h"
+#include "cbase/c_integer.h"
+#include "cbase/c_memory.h"
+#include "cgenerics/c_simd_search.h"
+#include "cgenerics/c_vector.h"
+
+#include <limits>
+#include <type_traits>
+
+namespace ncore
+{
+    // The layouts of a sorted_index_t
+    enum
+    {
+        // Eytzinger, the items in breadth first order of an implicit binary tree (children of k are 2k and 2k+1).
+        // The descendants that are 64/sizeof(T) slots further share a cache line, it is prefetched while
+        // the search descends so the memory latency of the levels overlaps.
+        cSortedEytzinger = 0,
+        // A static B+ tree of 64-byte nodes (S+ tree), the leaves are the sorted items and every node is
+        // searched with a SIMD compare, a search touches one cache line per level of (64/sizeof(T)+1)-way
+        // fanout. Only for arithmetic types.
+        cSortedBlocked = 1,
+    };
+
+    // A read-only search index that is built once from sorted items and answers:
+    // - find(key): the position of 'key' in the sorted items, or -1
+    // - lower_bound(key): the position of the first item >= key, or size() when there is none
+    // - rank(key): the number of items < key
+    // The items are copied, the source can be released after build. Positions are in the sorted order
+    // of the items that build was given, with duplicates the first one is found.
+    // T needs operator<, the blocked layout needs an arithmetic T (NaN is not supported).
+    template <typename T, s32 Layout = cSortedEytzinger> class sorted_index_t;
+
+    namespace nsorted
+    {
+        template <typename T> inline T* allocate(alloc_t* allocator, u64 count)
+        {
+            ASSERT((count * sizeof(T)) < ((u64)1 << 32));
+            return (T*)allocator->allocate((u32)(count * sizeof(T)), 64);
+        }
+
+        template <typename T> inline void deallocate(alloc_t* allocator, T*& ptr)
+        {
+            if (ptr != nullptr)
+                allocator->deallocate(ptr);
+            ptr = nullptr;
+        }
+
+        // The key that pads the nodes of the blocked layout, no key is larger
+        template <typename T> inline T padding()
+        {
+            return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max();
+        }
+    } // namespace nsorted
+
+    template <typename T> class sorted_index_t<T, cSortedEytzinger>
+    {
+    public:
+        sorted_index_t(alloc_t* allocator = nullptr)
+            : m_alloc(allocator != nullptr ? allocator : context_t::runtime_alloc())
+            , m_items(nullptr)
+            , m_rank(nullptr)
+            , m_size(0)
+        {
+        }
+        ~sorted_index_t() { clear(); }
+
+        inline u32  size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+
+        void clear()
+        {
+            for (u32 k = 1; k <= m_size; ++k)
+                m_items[k].~T();
+            nsorted::deallocate(m_alloc, m_items);
+            nsorted::deallocate(m_alloc, m_rank);
+            m_size = 0;
+        }
+
+        // 'items' must be sorted ascending
+        void build(T const* items, u32 count)
+        {
+            clear();
+            if (count == 0)
+                return;
+
+            // slot 0 is not used, so the descendants of slot k at the prefetch depth start at slot
+            // k * cPrefetch, which is a 64-byte boundary of the 64-byte aligned block
+            m_size  = count;
+            m_items = nsorted::allocate<T>(m_alloc, (u64)count + 1);
+            m_rank  = nsorted::allocate<u32>(m_alloc, (u64)count + 1);
+            fill(items, 0, 1);
+        }
+        void build(vector_t<T> const& sorted) { build(sorted.begin(), sorted.size()); }
+
+        inline u32 lower_bound(T const& key) const
+        {
+            u32 const k = search(key);
+            return k == 0 ? m_size : m_rank[k];
+        }
+
+        inline u32 rank(T const& key) const { return lower_bound(key); }
+
+        inline s32 find(T const& key) const
+        {
+            u32 const k = search(key);
+            if (k == 0 || key < m_items[k])
+                return -1;
+            return (s32)m_rank[k];
+        }
+
+    private:
+        enum
+        {
+            // how far ahead the descent is prefetched, the descendants of slot k at that depth
+            // start at slot k * cPrefetch
+            cPrefetch = (sizeof(T) >= 64) ? 1 : (64 / sizeof(T)),
+        };
+
+        // In-order walk of the implicit tree, slot k gets the next item in sorted order
+        u32 fill(T const* items, u32 i, u32 k)
+        {
+            if (k <= m_size)
+            {
+                i = fill(items, i, 2 * k);
+                new (m_items + k) T(items[i]);
+                m_rank[k] = i++;
+                i         = fill(items, i, 2 * k + 1);
+            }
+            return i;
+        }
+
+        // The slot of the lower bound, or 0. The descent goes right on every item < key and left
+        // otherwise, the lower bound is where it went left for the last time, the trailing ones of
+        // the final slot number are the right turns after that.
+        inline u32 search(T const& key) const
+        {
+            u64 k = 1;
+            while (k <= m_size)
+            {
+                simd_n::prefetch((u8 const*)m_items + (k * cPrefetch) * sizeof(T));
+                k = 2 * k + ((m_items[k] < key) ? 1 : 0);
+            }
+            k >>= math::countTrailingZeros(~k) + 1;
+            return (u32)k;
+        }
+
+        sorted_index_t(sorted_index_t const&);
+        sorted_index_t& operator=(sorted_index_t const&);
+
+        alloc_t* m_alloc;
+        T*       m_items;
+        u32*     m_rank;
+        u32      m_size;
+    };
+
+    template <typename T> class sorted_index_t<T, cSortedBlocked>
+    {
+        static_assert(std::is_arithmetic<T>::value, "the blocked layout needs an arithmetic item type");
+
+    public:
+        sorted_index_t(alloc_t* allocator = nullptr)
+            : m_alloc(allocator != nullptr ? allocator : context_t::runtime_alloc())
+            , m_tree(nullptr)
+            , m_size(0)
+            , m_height(0)
+        {
+        }
+        ~sorted_index_t() { clear(); }
+
+        inline u32  size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+
+        void clear()
+        {
+            nsorted::deallocate(m_alloc, m_tree);
+            m_size   = 0;
+            m_height = 0;
+        }
+
+        // 'items' must be sorted ascending
+        void build(T const* items, u32 count)
+        {
+            clear();
+            if (count == 0)
+                return;
+
+            // layer 0 are the sorted items padded to whole nodes, every layer above has a key for each
+            // child but the first, the smallest key in the subtree of that child
+            m_size      = count;
+            m_height    = 1;
+            m_offset[0] = 0;
+
+            u32 n = count;
+            for (;;)
+            {
+                m_offset[m_height] = m_offset[m_height - 1] + nodes(n) * cB;
+                if (n <= cB)
+                    break;
+                n = parent_keys(n);
+                m_height += 1;
+                ASSERT(m_height < cMaxHeight);
+            }
+
+            m_tree = nsorted::allocate<T>(m_alloc, m_offset[m_height]);
+            nmem::memcpy(m_tree, items, count * sizeof(T));
+            for (u32 i = count; i < m_offset[1]; ++i)
+                m_tree[i] = nsorted::padding<T>();
+
+            for (u32 h = 1; h < m_height; ++h)
+            {
+                u32 const keys = m_offset[h + 1] - m_offset[h];
+                for (u32 i = 0; i < keys; ++i)
+                {
+                    // the child to the right of key j of node i, then leftmost down to layer 0
+                    u64 k = (u64)(i / cB) * (cB + 1) + (i % cB) + 1;
+                    for (u32 l = 1; l < h; ++l)
+                        k *= (cB + 1);
+                    m_tree[m_offset[h] + i] = (k * cB < count) ? m_tree[k * cB] : nsorted::padding<T>();
+                }
+            }
+        }
+        void build(vector_t<T> const& sorted) { build(sorted.begin(), sorted.size()); }
+
+        inline u32 lower_bound(T const& key) const
+        {
+            if (m_size == 0)
+                return 0;
+
+            u32 k = 0;
+            for (u32 h = m_height - 1; h > 0; --h)
+            {
+                u32 const i = simd_n::node_rank_t<T>::rank(m_tree + m_offset[h] + k, key);
+                k           = k * (cB + 1) + i * cB;
+            }
+            k += simd_n::node_rank_t<T>::rank(m_tree + k, key);
+            return k < m_size ? k : m_size;
+        }
+
+        inline u32 rank(T const& key) const { return lower_bound(key); }
+
+        inline s32 find(T const& key) const
+        {
+            u32 const i = lower_bound(key);
+            if (i == m_size || key < m_tree[i])
+                return -1;
+            return (s32)i;
+        }
+
+    private:
+        enum
+        {
+            cB         = 64 / sizeof(T), // keys per node
+            cMaxHeight = 16,
+        };
+
+        static inline u32 nodes(u32 n) { return (n + cB - 1) / cB; }
+        static inline u32 parent_keys(u32 n) { return (nodes(n) + cB) / (cB + 1) * cB; }
+
+        sorted_index_t(sorted_index_t const&);
+        sorted_index_t& operator=(sorted_index_t const&);
+
+        alloc_t* m_alloc;
+        T*       m_tree;
+        u32      m_size;
+        u32      m_height;
+        u32      m_offset[cMaxHeight + 1];
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_SORTED_INDEX_H__
@@ -0,0 +1,165 @@
+#ifndef __C_GENERICS_TTMAP_H__
+#define __C_GENERICS_TTMAP_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cgenerics/c_pool_alloc.h"
+
+namespace ncore
+{
+    class ttmap_t;
+
+    // Computes the 128-bit hash of a key, the default hashes the key bytes with two seeded wyhash passes
+    typedef void (*ttmap_hash_fn)(const void* key, u32 sizeof_key, u64& high, u64& low);
+
+    // Walks the bits of a 128-bit key hash, the lowest 'root_bits' bits index the root table and every
+    // following pair of bits selects a child of a 4-way node
+    struct ttmap_idxer_t
+    {
+        ttmap_idxer_t(u64 const hash[2], u32 root_bits)
+            : m_rootsize(1u << root_bits)
+            , m_depth(0)
+        {
+            m_hash[0] = hash[0];
+            m_hash[1] = hash[1];
+            reset(root_bits);
+        }
+
+        inline u32 root() const { return (u32)(m_hash[0] & (m_rootsize - 1)); }
+
+        // The child index at the next level, or -1 when all the bits are used
+        inline s32 next()
+        {
+            if (m_depth > 126)
+                return -1;
+            s32 const i = (s32)(bit(m_depth) | (bit(m_depth + 1) << 1));
+            m_depth += 2;
+            return i;
+        }
+
+        inline void reset(u32 root_bits) { m_depth = (s32)root_bits; }
+
+        u64 m_hash[2];
+        u32 m_rootsize;
+        s32 m_depth; // the next bit to use
+
+    private:
+        inline u32 bit(s32 i) const { return (u32)(m_hash[i >> 6] >> (i & 63)) & 1; }
+    };
+
+    // The item of a key, operator[] of ttmap_t returns one: assign a value to insert or update the item,
+    // remove() erases it. empty() is true when the key is not in the map.
+    class ttmap_value_t
+    {
+    public:
+        ttmap_value_t(ttmap_t* map, void const* key, void** value)
+            : m_map(map)
+            , m_key(key)
+            , m_value(value)
+        {
+        }
+
+        void           remove();
+        ttmap_value_t& operator=(void* value);
+
+        bool operator==(ttmap_value_t const& other) const { return m_value == other.m_value; }
+        bool operator!=(ttmap_value_t const& other) const { return m_value != other.m_value; }
+
+        inline bool        empty() const { return m_value == nullptr; }
+        inline const void* key() const { return m_key; }
+        inline void*       value() const { return m_value != nullptr ? *m_value : nullptr; }
+
+    private:
+        ttmap_t*    m_map;
+        void const* m_key;
+        void**      m_value;
+    };
+
+    // A hash trie map from fixed size keys to void* values. The 128-bit hash of a key indexes a root
+    // table and then a path of 4-way nodes, a slot holds nothing, an item or a node. Inserting into a
+    // slot that holds an item with another hash pushes both down into new nodes until their hash bits
+    // part, removing collapses nodes that are left with a single item. So the map never rehashes or
+    // moves items when it grows, the worst insert allocates a few nodes, against the doubling resize of
+    // hashmap_t that touches every item. Lookups take more (dependent) reads, the depth grows with
+    // log4(size / root size).
+    // The keys are copied into the items, items and nodes come from two pool_alloc_t's so there are no
+    // per item allocations. Not thread-safe.
+    class ttmap_t
+    {
+    public:
+        enum
+        {
+            cRootBits = 12, // default root table size, 4096 slots
+        };
+
+        ttmap_t(alloc_t* allocator, u32 sizeof_key, ttmap_hash_fn key_hasher = nullptr, u32 root_bits = cRootBits);
+        ~ttmap_t();
+
+        inline u32  size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+        inline u32  nodes() const { return m_nodes.used(); }
+
+        // Returns false when the key is already there, the value is then not changed
+        bool insert(const void* key, void* value);
+        bool remove(const void* key);
+
+        // The value of 'key' or nullptr when the key is not there
+        void** find(const void* key) const;
+
+        ttmap_value_t operator[](const void* key) { return ttmap_value_t(this, key, find(key)); }
+
+        void clear();
+
+    protected:
+        friend class ttmap_value_t;
+
+        struct node_t
+        {
+            ptr_t m_elements[4]; // 0 (empty), node_t* or item_t* | cItemTag
+        };
+
+        // Items with the same 128-bit hash are chained, the key bytes follow the item
+        struct item_t
+        {
+            u64     m_hash[2];
+            void*   m_value;
+            item_t* m_next;
+
+            inline u8*       key() { return (u8*)(this + 1); }
+            inline u8 const* key() const { return (u8 const*)(this + 1); }
+        };
+
+        enum
+        {
+            cItemTag  = 1,
+            cMaxDepth = 66, // root slot and 64 levels of 2 bits
+        };
+
+        static inline bool    is_item(ptr_t e) { return (e & cItemTag) != 0; }
+        static inline node_t* as_node(ptr_t e) { return (node_t*)e; }
+        static inline item_t* as_item(ptr_t e) { return (item_t*)(e & ~(ptr_t)cItemTag); }
+
+        void    hash(const void* key, u64 hash[2]) const;
+        item_t* find_item(ptr_t e, u64 const hash[2], const void* key) const;
+
+        alloc_t*      m_allocator;
+        ttmap_hash_fn m_hasher;
+        u32           m_sizeof_key;
+        u32           m_root_bits;
+        u32           m_rootsize;
+        u32           m_size;
+        ptr_t*        m_roottable;
+        pool_alloc_t  m_nodes;
+        pool_alloc_t  m_items;
+
+    private:
+        ttmap_t(ttmap_t const&);            // not copyable
+        ttmap_t& operator=(ttmap_t const&); // not copyable
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_TTMAP_H__
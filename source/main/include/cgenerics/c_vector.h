@@ -5,17 +5,166 @@
 #pragma once
 #endif
 
+#include "cbase/c_memory.h"
+#include "cgenerics/c_simd_search.h"
+
+#include <new>
+#include <type_traits>
+
 namespace ncore
 {
-    template <typename T> inline void value_copy(T* dst, T const* src, s32 item_count)
+    class alloc_t;
+
+    // The objects of a trivially relocatable type can be moved to another address with a memcpy, the
+    // source is then raw memory, no move constructor or destructor is called. This holds for every
+    // trivially copyable type, types that own a resource through a handle or a pointer can opt in with
+    // CGENERICS_TRIVIALLY_RELOCATABLE(type) at global scope.
+    template <typename T> struct is_trivially_relocatable_t
+    {
+        enum
+        {
+            value = std::is_trivially_copyable<T>::value
+        };
+    };
+
+#define CGENERICS_TRIVIALLY_RELOCATABLE(type)               \
+    namespace ncore                                         \
+    {                                                       \
+        template <> struct is_trivially_relocatable_t<type> \
+        {                                                   \
+            enum                                            \
+            {                                               \
+                value = 1                                   \
+            };                                              \
+        };                                                  \
+    }
+
+    // The bulk operations on items are selected at compile time by the kind of the item type:
+    // - cValueTrivial, trivially copyable, memcpy/memmove and a fill that doubles with memcpy
+    // - cValueRelocatable, trivially relocatable, memmove to move items, constructors to copy them
+    // - cValueGeneric, anything else, move construction and destruction one item at a time
+    enum
+    {
+        cValueGeneric     = 0,
+        cValueRelocatable = 1,
+        cValueTrivial     = 2,
+    };
+
+    template <typename T> struct value_kind_t
+    {
+        enum
+        {
+            value = std::is_trivially_copyable<T>::value ? cValueTrivial : (is_trivially_relocatable_t<T>::value ? cValueRelocatable : cValueGeneric)
+        };
+    };
+
+    // 'construct' and 'relocate' write to raw memory, 'copy' and 'fill' assign to constructed items,
+    // 'relocate' handles overlapping ranges and leaves the source as raw memory.
+    template <typename T, s32 Kind = value_kind_t<T>::value> struct value_ops_t
+    {
+        static inline void copy(T* dst, T const* src, u32 n)
+        {
+            for (u32 i = 0; i < n; ++i)
+                dst[i] = src[i];
+        }
+        static inline void fill(T* dst, T const& value, u32 n)
+        {
+            for (u32 i = 0; i < n; ++i)
+                dst[i] = value;
+        }
+        static inline void construct(T* dst, T const* src, u32 n)
+        {
+            for (u32 i = 0; i < n; ++i)
+                new (dst + i) T(src[i]);
+        }
+        static inline void construct_default(T* dst, u32 n)
+        {
+            for (u32 i = 0; i < n; ++i)
+                new (dst + i) T();
+        }
+        static inline void relocate(T* dst, T* src, u32 n)
+        {
+            if (dst < src)
+            {
+                for (u32 i = 0; i < n; ++i)
+                {
+                    new (dst + i) T(static_cast<T&&>(src[i]));
+                    src[i].~T();
+                }
+            }
+            else if (dst > src)
+            {
+                for (u32 i = n; i > 0; --i)
+                {
+                    new (dst + i - 1) T(static_cast<T&&>(src[i - 1]));
+                    src[i - 1].~T();
+                }
+            }
+        }
+        static inline void destroy(T* p, u32 n)
+        {
+            if (!std::is_trivially_destructible<T>::value)
+            {
+                for (u32 i = 0; i < n; ++i)
+                    p[i].~T();
+            }
+        }
+    };
+
+    template <typename T> struct value_ops_t<T, cValueRelocatable> : public value_ops_t<T, cValueGeneric>
     {
-        while (item_count > 0)
+        static inline void relocate(T* dst, T* src, u32 n)
         {
-            *dst++ = *src++;
-            --item_count;
+            if (n > 0 && dst != src)
+                x_memmove(dst, src, (u64)n * sizeof(T));
         }
+    };
+
+    template <typename T> struct value_ops_t<T, cValueTrivial>
+    {
+        static inline void copy(T* dst, T const* src, u32 n)
+        {
+            if (n > 0)
+                nmem::memcpy(dst, src, (u64)n * sizeof(T));
+        }
+        static inline void fill(T* dst, T const& value, u32 n)
+        {
+            if (sizeof(T) == 1)
+            {
+                if (n > 0)
+                    nmem::memset(dst, *(u8 const*)&value, n);
+                return;
+            }
+
+            // a few items one by one, then double the filled range with memcpy until it is done
+            u32 done = n < 16 ? n : 16;
+            for (u32 i = 0; i < done; ++i)
+                dst[i] = value;
+            while (done < n)
+            {
+                u32 const count = (n - done) < done ? (n - done) : done;
+                nmem::memcpy(dst + done, dst, (u64)count * sizeof(T));
+                done += count;
+            }
+        }
+        static inline void construct(T* dst, T const* src, u32 n) { copy(dst, src, n); }
+        static inline void construct_default(T* dst, u32 n) {} // like a POD array, the items are not initialized
+        static inline void relocate(T* dst, T* src, u32 n)
+        {
+            if (n > 0 && dst != src)
+                x_memmove(dst, src, (u64)n * sizeof(T));
+        }
+        static inline void destroy(T* p, u32 n) {}
+    };
+
+    template <typename T> inline void value_copy(T* dst, T const* src, s32 item_count)
+    {
+        if (item_count > 0)
+            value_ops_t<T>::copy(dst, src, (u32)item_count);
     }
 
+    template <typename T> inline void value_fill(T* dst, T const& value, u32 item_count) { value_ops_t<T>::fill(dst, value, item_count); }
+
     template <typename T> inline s32 value_compare(T const& lhs, T const& rhs)
     {
         if (lhs < rhs)
@@ -32,23 +181,35 @@ namespace ncore
         inline u32  size() const { return m_size; }
         inline u32  size_in_bytes() const { return m_size * m_sizeof; }
         inline u32  capacity() const { return m_capacity; }
-        void        clear();
-        void        reserve(u32 new_capacity);
-        void        resize(u32 new_size);
+
+        // Reserve address space for 'max_capacity' items and use virtual memory as the storage, growing
+        // then commits pages behind the existing items and never copies them. Only possible while the
+        // vector has no storage yet, the capacity can not grow beyond 'max_capacity'.
+        bool reserve_virtual(u32 max_capacity);
+        bool is_virtual() const { return m_max_capacity != 0; }
+
+        // The allocator that the (heap) storage comes from
+        alloc_t* allocator() const { return m_alloc; }
+
+        // True while the items are in the inline buffer of an inline_vector_t
+        bool is_inline() const { return __is_inline(); }
 
     protected:
-        vector_base_t(u32 sizeofitem)
-            : m_p(nullptr)
-            , m_size(0)
-            , m_sizeof(sizeofitem)
-            , m_capacity(0)
-        {
-        }
+        // A nullptr allocator means context_t::runtime_alloc().
+        // An 'inline_capacity' != 0 means that the derived class has a buffer for that many items
+        // directly behind this object, see inline_vector_t.
+        vector_base_t(u32 sizeofitem, alloc_t* allocator = nullptr, u32 inline_capacity = 0);
 
-        bool __set_capacity(u32 min_new_capacity);
-        void __copy_range(void* dst, void* src, u32 n);
-        void __insert(u32 index, const void* p, u32 n);
-        void __erase(u32 start, u32 n);
+        inline void* __inline_data() const { return (u8*)this + sizeof(vector_base_t); }
+        inline bool  __is_inline() const { return m_inline_capacity != 0 && m_p == __inline_data(); }
+
+        // Moves 'n' items to raw memory, the source is raw memory afterwards. The storage functions
+        // use memcpy when this is nullptr, which is fine for trivially relocatable items.
+        typedef void (*relocate_fn_t)(void* dst, void* src, u32 n);
+
+        bool __set_capacity(u32 min_new_capacity, relocate_fn_t relocate = nullptr);
+        void __move_from(vector_base_t& other, relocate_fn_t relocate = nullptr);
+        void __relocate(void* dst, void* src, u32 n, relocate_fn_t relocate);
         void __reverse();
         s32  __compare(vector_base_t const* rhs) const;
         bool __is_equal(vector_base_t const* rhs) const;
@@ -56,15 +217,27 @@ namespace ncore
         void* __assume_ownership();
         bool  __grant_ownership(void* p, u32 sizeofitem, u32 size, u32 capacity);
 
-        void* m_p;
-        u32   m_size;
-        u32   m_sizeof;
-        u32   m_capacity;
+        void*    m_p;
+        u32      m_size;
+        u32      m_sizeof;
+        u32      m_capacity;
+        u32      m_max_capacity; // != 0 when the storage is a reserved range of virtual memory
+        alloc_t* m_alloc;
+        u32      m_inline_capacity; // != 0 for an inline_vector_t
     };
 
     template <typename T> class vector_t : protected vector_base_t
     {
     public:
+        using vector_base_t::allocator;
+        using vector_base_t::capacity;
+        using vector_base_t::empty;
+        using vector_base_t::is_inline;
+        using vector_base_t::is_virtual;
+        using vector_base_t::reserve_virtual;
+        using vector_base_t::size;
+        using vector_base_t::size_in_bytes;
+
         vector_t()
             : vector_base_t(sizeof(T))
         {
@@ -72,32 +245,170 @@ namespace ncore
         vector_t(u32 n)
             : vector_base_t(sizeof(T))
         {
-            __set_capacity(n);
+            __set_capacity(n, relocator());
+        }
+
+        // The storage is allocated from 'allocator', with an arena allocator the vector can be
+        // released together with the arena instead of being destructed.
+        // A template so that 'vector_t<T> v(0)' stays a capacity, a literal 0 does not deduce 'A*'.
+        template <typename A, typename = typename std::enable_if<std::is_convertible<A*, alloc_t*>::value>::type>
+        explicit vector_t(A* allocator)
+            : vector_base_t(sizeof(T), allocator)
+        {
+        }
+        vector_t(u32 n, alloc_t* allocator)
+            : vector_base_t(sizeof(T), allocator)
+        {
+            __set_capacity(n, relocator());
         }
 
+        // The copy allocates from the same allocator as 'other'
         vector_t(const vector_t& other)
-            : vector_base_t(other.m_sizeof)
+            : vector_base_t(other.m_sizeof, other.m_alloc)
         {
-            __set_capacity(other.m_size);
+            __set_capacity(other.m_size, relocator());
+            value_ops_t<T>::construct(begin(), other.begin(), other.m_size);
             m_size = other.m_size;
-            __copy_range(m_p, other.m_p, m_size);
+        }
+
+        // Takes over the storage of 'other', or relocates the items when they are in an inline buffer
+        vector_t(vector_t&& other)
+            : vector_base_t(other.m_sizeof, other.m_alloc)
+        {
+            __move_from(other, relocator());
+        }
+
+        vector_t& operator=(const vector_t& other)
+        {
+            if (this != &other)
+            {
+                if (other.m_size <= m_size)
+                {
+                    value_ops_t<T>::copy(begin(), other.begin(), other.m_size);
+                    value_ops_t<T>::destroy(begin() + other.m_size, m_size - other.m_size);
+                }
+                else
+                {
+                    reserve(other.m_size);
+                    value_ops_t<T>::copy(begin(), other.begin(), m_size);
+                    value_ops_t<T>::construct(begin() + m_size, other.begin() + m_size, other.m_size - m_size);
+                }
+                m_size = other.m_size;
+            }
+            return *this;
+        }
+
+        vector_t& operator=(vector_t&& other)
+        {
+            if (this != &other)
+            {
+                value_ops_t<T>::destroy(begin(), m_size);
+                m_size = 0;
+                __move_from(other, relocator());
+            }
+            return *this;
         }
 
         ~vector_t()
         {
             if (m_p)
             {
+                value_ops_t<T>::destroy(begin(), m_size);
                 __set_capacity(0);
             }
         }
 
-        void        insert(u32 index, const T* p, u32 n);
-        void        erase(u32 start, u32 n) { __erase(start, n); }
-        inline void erase(u32 index) { __erase(index, 1); }
-        void        reverse();
+        void clear()
+        {
+            if (m_p)
+            {
+                value_ops_t<T>::destroy(begin(), m_size);
+                m_size = 0;
+                __set_capacity(0);
+            }
+        }
+
+        // reserve never shrinks, use shrink_to_fit to release unused capacity
+        void reserve(u32 new_capacity)
+        {
+            if (new_capacity > m_capacity)
+                __set_capacity(new_capacity, relocator());
+        }
+
+        void shrink_to_fit() { __set_capacity(m_size, relocator()); }
+
+        // Growing default constructs the new items (trivially copyable items are not initialized),
+        // resize(0) sets the container to empty, but does not free the allocated block.
+        void resize(u32 new_size)
+        {
+            if (new_size < m_size)
+            {
+                value_ops_t<T>::destroy(begin() + new_size, m_size - new_size);
+            }
+            else if (new_size > m_size)
+            {
+                if (new_size > m_capacity)
+                    __set_capacity(new_size, relocator());
+                value_ops_t<T>::construct_default(begin() + m_size, new_size - m_size);
+            }
+            m_size = new_size;
+        }
+
+        // 'p' can not point into this vector
+        void insert(u32 index, const T* p, u32 n)
+        {
+            ASSERT(index <= m_size);
+            ASSERT(!m_p || (p + n) <= begin() || p >= end());
+            if (n == 0 || index > m_size)
+                return;
+
+            if ((m_size + n) > m_capacity)
+                __set_capacity(m_size + n, relocator());
+            T* items = begin();
+            value_ops_t<T>::relocate(items + index + n, items + index, m_size - index);
+            value_ops_t<T>::construct(items + index, p, n);
+            m_size += n;
+        }
+
+        void erase(u32 start, u32 n)
+        {
+            ASSERT((start + n) <= m_size);
+            if (n == 0 || (start + n) > m_size)
+                return;
+
+            T* items = begin();
+            value_ops_t<T>::destroy(items + start, n);
+            value_ops_t<T>::relocate(items + start, items + start + n, m_size - (start + n));
+            m_size -= n;
+        }
 
-        T*   assume_ownership() { return (T*)__assume_ownership(); }
-        bool grant_ownership(T* p, u32 size, u32 capacity) { __grant_ownership(p, size, capacity); }
+        inline void erase(u32 index) { erase(index, 1); }
+
+        void reverse()
+        {
+            if ((s32)value_kind_t<T>::value != cValueGeneric)
+            {
+                __reverse();
+                return;
+            }
+            T* lo = begin();
+            T* hi = end();
+            while (lo < --hi)
+            {
+                T tmp(static_cast<T&&>(*lo));
+                *lo   = static_cast<T&&>(*hi);
+                *hi   = static_cast<T&&>(tmp);
+                lo++;
+            }
+        }
+
+        T* assume_ownership() { return (T*)__assume_ownership(); }
+        bool grant_ownership(T* p, u32 size, u32 capacity)
+        {
+            value_ops_t<T>::destroy(begin(), m_size);
+            m_size = 0;
+            return __grant_ownership(p, sizeof(T), size, capacity);
+        }
 
         inline const T* begin() const { return (T*)m_p; }
         T*              begin() { return (T*)m_p; }
@@ -130,21 +441,21 @@ namespace ncore
             return ptr_at(cur_size);
         }
 
-        inline void push_front(const T& obj) { __insert(0, &obj, 1); }
+        inline void push_front(const T& obj) { insert(0, &obj, 1); }
         inline void push_back(const T& obj)
         {
-            ASSERT(!m_p || (&obj < m_p) || (&obj >= ptr_at(m_size)));
+            ASSERT(!m_p || (&obj < m_p) || (&obj >= end()));
             if (m_size >= m_capacity)
-                __set_capacity(m_size + 1);
-            value_copy(ptr_at(m_size), &obj, 1);
+                __set_capacity(m_size + 1, relocator());
+            new (ptr_at(m_size)) T(obj);
             m_size++;
         }
 
         inline void push_back_value(T obj)
         {
             if (m_size >= m_capacity)
-                __set_capacity(m_size + 1);
-            value_copy(ptr_at(m_size), &obj, 1);
+                __set_capacity(m_size + 1, relocator());
+            new (ptr_at(m_size)) T(static_cast<T&&>(obj));
             m_size++;
         }
 
@@ -152,13 +463,16 @@ namespace ncore
         {
             ASSERT(m_size);
             if (m_size)
+            {
                 m_size--;
+                value_ops_t<T>::destroy(begin() + m_size, 1);
+            }
         }
 
         vector_t<T>& append(const vector_t<T>& other)
         {
             if (other.m_size)
-                insert(m_size, other.m_p, other.m_size);
+                insert(m_size, other.begin(), other.m_size);
             return *this;
         }
 
@@ -182,114 +496,127 @@ namespace ncore
             {
                 T* item = ptr_at(index);
                 T* back = ptr_at(m_size - 1);
-                value_copy<T>(item, back, 1);
+                *item   = static_cast<T&&>(*back);
             }
             pop_back();
         }
 
-        inline bool operator==(const vector_t& rhs) const;
-        inline bool operator<(const vector_t& rhs) const;
+        // Item wise, == and < over the items, a shorter vector that is a prefix of the other is less
+        inline bool operator==(const vector_t& rhs) const { return m_size == rhs.m_size && simd_n::search_t<T>::equal(begin(), rhs.begin(), m_size); }
+        inline bool operator!=(const vector_t& rhs) const { return !(*this == rhs); }
+        inline bool operator<(const vector_t& rhs) const { return compare(rhs) < 0; }
 
-        inline s32 find(const T& item) const
+        // Lexicographic compare, returns -1, 0 or 1
+        inline s32 compare(const vector_t& rhs) const
         {
-            const T* p     = begin();
-            const T* p_end = end();
+            u32 const n = m_size < rhs.m_size ? m_size : rhs.m_size;
+            s32 const c = simd_n::search_t<T>::compare(begin(), rhs.begin(), n);
+            if (c != 0)
+                return c;
+            if (m_size == rhs.m_size)
+                return 0;
+            return m_size < rhs.m_size ? -1 : 1;
+        }
 
-            u32 index = 0;
-            while (p != p_end)
+        // Linear search, integers and floats are searched with the SIMD kernels of c_simd_search.h
+        inline s32 find(const T& item) const { return simd_n::search_t<T>::find(begin(), m_size, item); }
+
+        // Binary search in sorted items, the halving does not branch on the compare so the loop has
+        // a fixed trip count and no mispredictions, the first of equal items is found.
+        inline s32 find_sorted(const T& key) const
+        {
+            if (m_size == 0)
+                return -1;
+
+            const T* base = begin();
+            u32      n    = m_size;
+            while (n > 1)
             {
-                if (value_compare<T>(&item, p) == 0)
-                    return index;
-                p++;
-                index++;
+                u32 const half = n >> 1;
+                base           = (base[half - 1] < key) ? base + half : base;
+                n -= half;
             }
+            if (*base < key)
+                base++;
 
-            return -1;
+            if (base == end() || value_compare<T>(key, *base) != 0)
+                return -1;
+            return (s32)(base - begin());
         }
 
-        inline s32 find_sorted(const T& key) const
+        inline u32 count_occurences(const T& key) const { return simd_n::search_t<T>::count(begin(), m_size, key); }
+
+        inline void set_all(const T& key) { value_fill<T>(begin(), key, m_size); }
+
+    protected:
+        vector_t(alloc_t* allocator, u32 inline_capacity)
+            : vector_base_t(sizeof(T), allocator, inline_capacity)
         {
-            if (m_size)
-            {
-                // Uniform binary search - Knuth Algorithm 6.2.1 U, unrolled twice.
-                s32 i = ((m_size + 1) >> 1) - 1;
-                s32 m = m_size;
+        }
 
-                for (;;)
-                {
-                    ASSERT_OPEN_RANGE(i, 0, (s32)m_size);
-                    const T* pKey_i = (T*)ptr_at(i);
-                    s32      cmp    = value_compare(key, *pKey_i);
-                    if (cmp == 0)
-                        return i;
-                    m >>= 1;
-                    if (!m)
-                        break;
-                    //  0 -> 0
-                    // -1 -> 1
-                    //  1 -> 0
-                    // -1 -> 1
-                    cmp = (1 - cmp) >> 1;
-                    i += (((m + 1) >> 1) ^ cmp) - cmp;
-
-                    ASSERT_OPEN_RANGE(i, 0, (s32)m_size);
-                    pKey_i = (T*)ptr_at(i);
-                    cmp    = value_compare(key, *pKey_i);
-                    if (cmp == 0)
-                        return i;
-                    m >>= 1;
-                    if (!m)
-                        break;
-                    cmp = (1 - cmp) >> 1;
-                    i += (((m + 1) >> 1) ^ cmp) - cmp;
-                }
-            }
+        // Trivially relocatable items are moved with memcpy by the base
+        static void          relocate_items(void* dst, void* src, u32 n) { value_ops_t<T>::relocate((T*)dst, (T*)src, n); }
+        static relocate_fn_t relocator() { return (s32)value_kind_t<T>::value == cValueGeneric ? &relocate_items : nullptr; }
+    };
 
-            return -1;
+    // A vector_t that keeps up to N items in a buffer inside the object, the first push_back does not
+    // allocate. Growing beyond N items spills the items to a heap block from the allocator, dropping
+    // back to N items or less with clear or shrink_to_fit moves them back into the buffer and frees
+    // the block. It is a vector_t, so it can be passed to anything that takes a vector_t<T>&.
+    template <typename T, u32 N> class inline_vector_t : public vector_t<T>
+    {
+        static_assert(N > 0, "an inline_vector_t needs an inline capacity");
+        static_assert(alignof(T) <= alignof(vector_base_t), "the inline buffer directly follows the vector_base_t");
+
+    public:
+        inline_vector_t(alloc_t* allocator = nullptr)
+            : vector_t<T>(allocator, N)
+        {
+            ASSERT((void*)m_inline == this->__inline_data());
         }
 
-        inline u32 count_occurences(const T& key) const
+        inline_vector_t(const vector_t<T>& other)
+            : vector_t<T>(other.allocator(), N)
         {
-            const T* p     = (T*)m_p;
-            const T* p_end = (T*)m_p + m_size;
+            vector_t<T>::operator=(other);
+        }
 
-            u32 c = 0;
-            while (p != p_end)
-            {
-                if (key == *p)
-                    c++;
-                p++;
-            }
-            return c;
+        inline_vector_t(const inline_vector_t& other)
+            : vector_t<T>(other.allocator(), N)
+        {
+            vector_t<T>::operator=(other);
         }
 
-        inline s32 find(const void* item) const
+        // Takes over a heap block of 'other', inline items are relocated
+        inline_vector_t(vector_t<T>&& other)
+            : vector_t<T>(other.allocator(), N)
         {
-            const u8* p     = (u8*)m_p;
-            const u8* p_end = (u8*)m_p + m_size * m_sizeof;
+            this->__move_from(other, this->relocator());
+        }
 
-            u32 index = 0;
-            while (p != p_end)
-            {
-                if (value_compare<T>(item, p, m_sizeof) == 0)
-                    return index;
-                p += m_sizeof;
-                index++;
-            }
+        inline_vector_t(inline_vector_t&& other)
+            : vector_t<T>(other.allocator(), N)
+        {
+            this->__move_from(other, this->relocator());
+        }
 
-            return -1;
+        inline_vector_t& operator=(const inline_vector_t& other)
+        {
+            vector_t<T>::operator=(other);
+            return *this;
         }
 
-        inline void set_all(const T& key)
+        inline_vector_t& operator=(inline_vector_t&& other)
         {
-            T* pDst     = (T*)m_p;
-            T* pDst_end = (T*)pDst + m_size;
-            while (pDst != pDst_end)
-            {
-                value_copy<T>(pDst, &key, 1);
-                pDst++;
-            }
+            vector_t<T>::operator=(static_cast<vector_t<T>&&>(other));
+            return *this;
         }
+
+        static inline u32 inline_capacity() { return N; }
+
+    private:
+        // aligned like the base, so the buffer can not be placed in its tail padding
+        alignas(vector_base_t) u8 m_inline[N * sizeof(T)];
     };
 
 } // namespace ncore
@@ -0,0 +1,194 @@
+#ifndef __C_GENERICS_VMEM_H__
+#define __C_GENERICS_VMEM_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
+#include "cbase/c_memory.h"
+
+#include <new>
+
+namespace ncore
+{
+    // Virtual memory, reserve a range of address space once and commit/decommit pages at the end of it
+    // on demand. Memory that is committed reads as zero the first time it is touched.
+    namespace vmem_n
+    {
+        u32   page_size();
+        void* reserve(u64 size);
+        bool  commit(void* addr, u64 size);
+        bool  decommit(void* addr, u64 size);
+        void  release(void* addr, u64 size);
+
+        // Map a whole file read-only, the pages are shared with every other process that maps the file
+        void const* map_file(const char* path, u64& size);
+        void        unmap_file(void const* addr, u64 size);
+
+        // A block of bytes that write_file puts at 'm_offset' in the file
+        struct file_section_t
+        {
+            u64         m_offset;
+            void const* m_data;
+            u64         m_size;
+        };
+
+        // Create or truncate 'path' and write the sections, they are ordered by offset and do not overlap,
+        // the gaps between them are zero filled
+        bool write_file(const char* path, file_section_t const* sections, u32 num_sections);
+
+        inline u64 page_align(u64 size)
+        {
+            u64 const page = page_size();
+            return (size + page - 1) & ~(page - 1);
+        }
+    } // namespace vmem_n
+
+    // A drop-in for array_t<T> (create/destroy, size/cap_cur, set_size/set_capacity, get_item/set_item/add_item)
+    // that keeps its items in a reserved range of virtual memory. Growing commits more pages behind the existing
+    // items, so the items never move and nothing is copied. When the reserved range is exhausted the array moves
+    // once to a range that is twice as large. Only the array header is allocated from 'allocator'.
+    // When the address space can not be reserved create returns nullptr, when pages can not be committed
+    // set_capacity returns false and the capacity stays as it was.
+    // T must be bitwise movable since the items are not constructed or destructed.
+    template <typename T> class vmem_array_t
+    {
+    public:
+        enum
+        {
+            cReserveBytes = 1 << 28, // default address space reserved per array
+        };
+
+        static vmem_array_t<T>* create(u32 size, u32 cap, alloc_t* allocator = nullptr, u64 reserve_bytes = cReserveBytes)
+        {
+            u64 const need = (u64)cap * sizeof(T);
+            if (reserve_bytes < need)
+                reserve_bytes = need;
+            if (allocator == nullptr)
+                allocator = context_t::runtime_alloc();
+
+            u64 const reserved = vmem_n::page_align(reserve_bytes);
+            T*        data     = (T*)vmem_n::reserve(reserved);
+            if (data == nullptr)
+                return nullptr;
+            void* mem = allocator->allocate(sizeof(vmem_array_t<T>));
+            if (mem == nullptr)
+            {
+                vmem_n::release(data, reserved);
+                return nullptr;
+            }
+
+            vmem_array_t<T>* a = new (mem) vmem_array_t<T>();
+            a->m_alloc         = allocator;
+            a->m_reserved      = reserved;
+            a->m_data          = data;
+            if (!a->set_capacity(cap))
+            {
+                destroy(a);
+                return nullptr;
+            }
+            a->m_size = size;
+            return a;
+        }
+
+        static void destroy(vmem_array_t<T>*& a)
+        {
+            if (a != nullptr)
+            {
+                vmem_n::release(a->m_data, a->m_reserved);
+                a->m_alloc->deallocate(a);
+                a = nullptr;
+            }
+        }
+
+        inline u32  size() const { return m_size; }
+        inline u32  cap_cur() const { return m_cap; }
+        inline u32  cap_max() const { return (u32)((m_reserved / sizeof(T)) < 0xffffffff ? (m_reserved / sizeof(T)) : 0xffffffff); }
+        inline void set_size(u32 size)
+        {
+            ASSERT(size <= m_cap);
+            m_size = size;
+        }
+
+        inline T*   get_item(u32 i) const { return m_data + i; }
+        inline void set_item(u32 i, T const& item) { m_data[i] = item; }
+        inline void add_item(T const& item)
+        {
+            ASSERT(m_size < m_cap);
+            m_data[m_size++] = item;
+        }
+
+        // Commits (or decommits) the pages needed for 'cap' items, the capacity is rounded up to a whole page.
+        // Returns false when the pages could not be committed, the array is unchanged then.
+        bool set_capacity(u32 cap)
+        {
+            u64 const bytes = vmem_n::page_align((u64)cap * sizeof(T));
+            if (bytes > m_reserved && !relocate(bytes))
+                return false;
+            if (bytes > m_committed)
+            {
+                if (!vmem_n::commit((u8*)m_data + m_committed, bytes - m_committed))
+                    return false;
+            }
+            else if (bytes < m_committed && cap >= m_size)
+            {
+                vmem_n::decommit((u8*)m_data + bytes, m_committed - bytes);
+            }
+            else
+            {
+                return true;
+            }
+            m_committed = bytes;
+            m_cap       = (u32)((m_committed / sizeof(T)) < 0xffffffff ? (m_committed / sizeof(T)) : 0xffffffff);
+            return true;
+        }
+
+    private:
+        vmem_array_t()
+            : m_data(nullptr)
+            , m_alloc(nullptr)
+            , m_reserved(0)
+            , m_committed(0)
+            , m_size(0)
+            , m_cap(0)
+        {
+        }
+
+        // The reserved range is too small, move to a range that is at least twice as large
+        bool relocate(u64 bytes)
+        {
+            u64 reserved = m_reserved > 0 ? m_reserved * 2 : vmem_n::page_size();
+            while (reserved < bytes)
+                reserved *= 2;
+
+            T* data = (T*)vmem_n::reserve(reserved);
+            if (data == nullptr)
+                return false;
+            if (m_committed > 0)
+            {
+                if (!vmem_n::commit(data, m_committed))
+                {
+                    vmem_n::release(data, reserved);
+                    return false;
+                }
+                nmem::memcpy(data, m_data, m_committed);
+            }
+            vmem_n::release(m_data, m_reserved);
+            m_data     = data;
+            m_reserved = reserved;
+            return true;
+        }
+
+        T*       m_data;
+        alloc_t* m_alloc;
+        u64      m_reserved;
+        u64      m_committed;
+        u32      m_size;
+        u32      m_cap;
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_VMEM_H__
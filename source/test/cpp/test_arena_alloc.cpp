@@ -0,0 +1,112 @@
+#include "ccore/c_allocator.h"
+
+#include "cgenerics/c_arena_alloc.h"
+
+#include "cunittest/cunittest.h"
+
+#include <thread>
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(arena_alloc)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(allocate_and_reset)
+        {
+            arena_alloc_t arena(1 << 20);
+            CHECK_EQUAL((u64)0, arena.used());
+
+            u8* a = (u8*)arena.allocate(10);
+            u8* b = (u8*)arena.allocate(10);
+            CHECK_NOT_NULL(a);
+            CHECK_NOT_NULL(b);
+            CHECK_TRUE(b >= a + 10);
+            for (s32 i = 0; i < 10; ++i)
+            {
+                a[i] = (u8)i;
+                b[i] = (u8)(i + 10);
+            }
+            for (s32 i = 0; i < 10; ++i)
+            {
+                CHECK_EQUAL(i, (s32)a[i]);
+            }
+
+            // deallocate does not give anything back, reset does
+            arena.deallocate(b);
+            CHECK_TRUE(arena.used() >= 20);
+            arena.reset();
+            CHECK_EQUAL((u64)0, arena.used());
+            CHECK_EQUAL(a, (u8*)arena.allocate(10));
+        }
+
+        UNITTEST_TEST(alignment)
+        {
+            arena_alloc_t arena(1 << 20);
+            arena.allocate(1);
+            void* p = arena.allocate(100, 64);
+            CHECK_EQUAL((u64)0, ((u64)p) & 63);
+            arena.allocate(3);
+            p = arena.allocate(8, 16);
+            CHECK_EQUAL((u64)0, ((u64)p) & 15);
+        }
+
+        UNITTEST_TEST(mark_and_rewind)
+        {
+            arena_alloc_t arena(1 << 20);
+            arena.allocate(100);
+            u64 const mark = arena.mark();
+            void*     p    = arena.allocate(1000);
+            arena.allocate(1000);
+            arena.rewind(mark);
+            CHECK_EQUAL(mark, arena.used());
+            CHECK_EQUAL(p, arena.allocate(1000));
+        }
+
+        UNITTEST_TEST(commit_and_release)
+        {
+            arena_alloc_t arena(1 << 24);
+            u8* p = (u8*)arena.allocate(1 << 20);
+            CHECK_NOT_NULL(p);
+            CHECK_TRUE(arena.committed() >= (1 << 20));
+            p[0]             = 1;
+            p[(1 << 20) - 1] = 2;
+
+            // the committed pages are kept over a reset
+            u64 const committed = arena.committed();
+            arena.reset();
+            CHECK_EQUAL(committed, arena.committed());
+
+            arena.release();
+            CHECK_EQUAL((u64)0, arena.committed());
+            CHECK_EQUAL((u64)0, arena.used());
+
+            // the range can still be used after a release
+            p = (u8*)arena.allocate(100);
+            CHECK_NOT_NULL(p);
+            p[99] = 3;
+        }
+
+        UNITTEST_TEST(frame_arena_per_thread)
+        {
+            arena_alloc_t* main_arena   = frame_arena();
+            arena_alloc_t* thread_arena = nullptr;
+            u64            thread_used  = 0;
+            std::thread    thread([&]() {
+                thread_arena = frame_arena();
+                frame_scope_t scope;
+                scope.arena()->allocate(1000);
+                thread_used = scope.arena()->used();
+            });
+            thread.join();
+
+            CHECK_TRUE(main_arena != thread_arena);
+            CHECK_TRUE(thread_used >= 1000);
+            CHECK_EQUAL(main_arena, frame_arena());
+        }
+    }
+}
+UNITTEST_SUITE_END
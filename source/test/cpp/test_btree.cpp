@@ -0,0 +1,320 @@
+#include "ccore/c_allocator.h"
+
+#include "cgenerics/c_btree.h"
+#include "cgenerics/c_pool_alloc.h"
+
+#include "cunittest/cunittest.h"
+
+#include <map>
+
+using namespace ncore;
+
+namespace
+{
+    // A key that owns heap memory, so a leaked or doubly destroyed key shows up under a leak checker
+    struct name_t
+    {
+        name_t()
+            : m_id(new s32(0))
+        {
+        }
+        name_t(s32 id)
+            : m_id(new s32(id))
+        {
+        }
+        name_t(name_t const& other)
+            : m_id(new s32(*other.m_id))
+        {
+        }
+        ~name_t() { delete m_id; }
+        name_t& operator=(name_t const& other)
+        {
+            *m_id = *other.m_id;
+            return *this;
+        }
+        bool operator<(name_t const& other) const { return *m_id < *other.m_id; }
+
+        s32* m_id;
+    };
+
+    struct rng_t
+    {
+        rng_t()
+            : m_state(0x2545F4914F6CDD1DULL)
+        {
+        }
+        u32 next(u32 n)
+        {
+            m_state ^= m_state << 13;
+            m_state ^= m_state >> 7;
+            m_state ^= m_state << 17;
+            return (u32)(m_state % n);
+        }
+        u64 m_state;
+    };
+
+    // The map holds exactly the items of the reference, in order
+    template <typename Map> bool same_items(Map const& map, std::map<u32, u32> const& ref)
+    {
+        if (map.size() != (u32)ref.size())
+            return false;
+        typename Map::iterator i = map.begin();
+        for (std::map<u32, u32>::const_iterator r = ref.begin(); r != ref.end(); ++r, ++i)
+        {
+            if (i == map.end() || i.first() != r->first || i.second() != r->second)
+                return false;
+        }
+        return i == map.end();
+    }
+
+    // Random inserts and erases checked against std::map
+    template <u32 NodeBytes> bool matches_std_map(u32 ops, u32 range)
+    {
+        btree_map_t<u32, u32, NodeBytes> map;
+        std::map<u32, u32>               ref;
+        rng_t                            rng;
+        for (u32 op = 0; op < ops; ++op)
+        {
+            u32 const key = rng.next(range);
+            if (rng.next(3) != 0)
+            {
+                bool const inserted = map.insert(key, op);
+                if (inserted != ref.insert(std::make_pair(key, op)).second)
+                    return false;
+            }
+            else
+            {
+                if (map.erase(key) != (ref.erase(key) == 1))
+                    return false;
+            }
+
+            u32 const probe = rng.next(range);
+            u32*      value = map.find(probe);
+            if ((value != nullptr) != (ref.count(probe) == 1))
+                return false;
+            if (value != nullptr && *value != ref[probe])
+                return false;
+        }
+        if (!same_items(map, ref))
+            return false;
+
+        // erase everything again, in random order
+        while (!ref.empty())
+        {
+            std::map<u32, u32>::iterator r = ref.lower_bound(rng.next(range));
+            if (r == ref.end())
+                r = ref.begin();
+            if (!map.erase(r->first))
+                return false;
+            ref.erase(r);
+        }
+        return map.empty() && map.height() == 0 && map.nodes() == 0;
+    }
+} // namespace
+
+UNITTEST_SUITE_BEGIN(btree)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(pool_alloc)
+        {
+            pool_alloc_t pool(100, nullptr, 1024);
+            CHECK_EQUAL((u32)128, pool.block_size());
+
+            void* a = pool.allocate(100, 64);
+            void* b = pool.allocate(100, 64);
+            CHECK_EQUAL((u64)0, ((u64)b - (u64)a) & 63);
+            CHECK_EQUAL((u32)2, pool.used());
+
+            // a freed block is handed out next
+            pool.deallocate(a);
+            CHECK_EQUAL(a, pool.allocate(100));
+
+            for (s32 i = 0; i < 20; ++i)
+                pool.allocate(64);
+            CHECK_EQUAL((u32)22, pool.used());
+            CHECK_TRUE(pool.chunks() >= 3);
+
+            pool.release();
+            CHECK_EQUAL((u32)0, pool.used());
+            CHECK_EQUAL((u32)0, pool.chunks());
+        }
+
+        UNITTEST_TEST(insert_find_erase)
+        {
+            btree_map_t<u32, u32> map;
+            CHECK_TRUE(map.empty());
+            CHECK_NULL(map.find(1));
+            CHECK_FALSE(map.erase(1));
+            CHECK_TRUE(map.begin() == map.end());
+
+            for (u32 i = 0; i < 1000; ++i)
+                CHECK_TRUE(map.insert(i * 2, i));
+            CHECK_FALSE(map.insert(10, 0));
+            CHECK_EQUAL((u32)5, *map.find(10));
+            CHECK_EQUAL((u32)1000, map.size());
+            CHECK_TRUE(map.height() > 1);
+
+            for (u32 i = 0; i < 1000; ++i)
+            {
+                CHECK_TRUE(map.contains(i * 2));
+                CHECK_FALSE(map.contains(i * 2 + 1));
+            }
+
+            for (u32 i = 0; i < 1000; i += 2)
+                CHECK_TRUE(map.erase(i * 2));
+            CHECK_EQUAL((u32)500, map.size());
+            for (u32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL((i & 1) == 1, map.contains(i * 2));
+        }
+
+        UNITTEST_TEST(ascending_inserts_fill_the_leaves)
+        {
+            btree_map_t<u32, u32> map;
+            u32 const             n = map.leaf_capacity() * 100;
+            for (u32 i = 0; i < n; ++i)
+                map.insert(i, i);
+
+            // the appends split off empty leaves, all leaves but the last are full
+            u32 leaves = 0;
+            for (u32 i = 0; i < n; i += map.leaf_capacity())
+                leaves += 1;
+            CHECK_TRUE(map.nodes() < leaves + leaves / 4);
+        }
+
+        UNITTEST_TEST(random_against_std_map)
+        {
+            CHECK_TRUE(matches_std_map<256>(20000, 5000));
+            CHECK_TRUE(matches_std_map<64>(20000, 2000));
+            CHECK_TRUE(matches_std_map<1024>(20000, 50000));
+        }
+
+        UNITTEST_TEST(range_iteration)
+        {
+            btree_map_t<u32, u32, 64> map;
+            for (u32 i = 0; i < 1000; ++i)
+                map.insert(i * 10, i);
+
+            // [995, 2005) holds 1000, 1010, ..., 2000
+            u32 count = 0;
+            u32 last  = 0;
+            for (btree_map_t<u32, u32, 64>::iterator i = map.lower_bound(995); i != map.end() && i.first() < 2005; ++i)
+            {
+                CHECK_TRUE(i.first() > last);
+                last = i.first();
+                count += 1;
+            }
+            CHECK_EQUAL((u32)101, count);
+            CHECK_EQUAL((u32)2000, last);
+
+            CHECK_EQUAL((u32)1000, map.lower_bound(1000).first());
+            CHECK_EQUAL((u32)1010, map.upper_bound(1000).first());
+            CHECK_TRUE(map.lower_bound(99991) == map.end());
+            CHECK_EQUAL((u32)0, map.lower_bound(0).first());
+
+            // values can be changed through the iterator
+            map.lower_bound(500).second() = 7;
+            CHECK_EQUAL((u32)7, *map.find(500));
+        }
+
+        UNITTEST_TEST(build_from)
+        {
+            u32 const n      = 10007;
+            u32*      keys   = new u32[n];
+            u32*      values = new u32[n];
+            for (u32 i = 0; i < n; ++i)
+            {
+                keys[i]   = i * 3;
+                values[i] = i;
+            }
+
+            btree_map_t<u32, u32> map;
+            map.insert(1, 1);
+            map.build_from(keys, values, n);
+            CHECK_EQUAL(n, map.size());
+            CHECK_FALSE(map.contains(1));
+
+            u32 i = 0;
+            for (btree_map_t<u32, u32>::iterator it = map.begin(); it != map.end(); ++it, ++i)
+            {
+                CHECK_EQUAL(keys[i], it.first());
+                CHECK_EQUAL(values[i], it.second());
+            }
+            CHECK_EQUAL(n, i);
+
+            // the bulk loaded tree takes inserts and erases like any other
+            CHECK_TRUE(map.insert(1, 1));
+            CHECK_TRUE(map.erase(3));
+            CHECK_FALSE(map.contains(3));
+            CHECK_EQUAL((u32)1, *map.find(1));
+            for (u32 j = 0; j < n; j += 2)
+                CHECK_TRUE(map.erase(keys[j]));
+            for (u32 j = 3; j < n; j += 2)
+                CHECK_EQUAL(j, *map.find(keys[j]));
+
+            delete[] keys;
+            delete[] values;
+        }
+
+        UNITTEST_TEST(set)
+        {
+            btree_set_t<s64> set;
+            for (s64 i = -500; i < 500; ++i)
+                CHECK_TRUE(set.insert(i * 7));
+            CHECK_FALSE(set.insert(0));
+            CHECK_TRUE(set.contains(-3500));
+            CHECK_FALSE(set.contains(-3499));
+
+            s64 prev  = -100000;
+            u32 count = 0;
+            for (btree_set_t<s64>::iterator i = set.begin(); i != set.end(); ++i, ++count)
+            {
+                CHECK_TRUE(*i > prev);
+                prev = *i;
+            }
+            CHECK_EQUAL((u32)1000, count);
+
+            s64 const keys[] = {1, 2, 3, 5, 8, 13};
+            set.build_from(keys, 6);
+            CHECK_EQUAL((u32)6, set.size());
+            CHECK_EQUAL((s64)5, *set.lower_bound(4));
+        }
+
+        UNITTEST_TEST(non_trivial_keys)
+        {
+            btree_map_t<name_t, u32, 128> map;
+            for (s32 i = 0; i < 2000; ++i)
+                map.insert(name_t((i * 7919) % 2000), (u32)i);
+            CHECK_EQUAL((u32)2000, map.size());
+            for (s32 i = 0; i < 2000; i += 3)
+                CHECK_TRUE(map.erase(name_t(i)));
+
+            s32 prev = -1;
+            for (btree_map_t<name_t, u32, 128>::iterator i = map.begin(); i != map.end(); ++i)
+            {
+                CHECK_TRUE(*i.first().m_id > prev);
+                prev = *i.first().m_id;
+            }
+            map.clear();
+            CHECK_TRUE(map.empty());
+        }
+
+        UNITTEST_TEST(allocator)
+        {
+            // the node chunks come from the allocator that is passed in
+            pool_alloc_t backing(1 << 16, nullptr, 1 << 16);
+            {
+                btree_map_t<u64, u64> map(&backing);
+                for (u64 i = 0; i < 10000; ++i)
+                    map.insert(i, i);
+                CHECK_EQUAL((u32)10000, map.size());
+                CHECK_TRUE(backing.used() > 0);
+            }
+            CHECK_EQUAL((u32)0, backing.used());
+        }
+    }
+}
+UNITTEST_SUITE_END
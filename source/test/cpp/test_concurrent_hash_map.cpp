@@ -0,0 +1,101 @@
+#include "ccore/c_allocator.h"
+
+#include "cgenerics/c_concurrent_hash_map.h"
+
+#include "cunittest/cunittest.h"
+
+#include <thread>
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(concurrent_hashmap)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(insert_find_erase)
+        {
+            flat_hashmap_n::concurrent_hashmap_t<s32, s32> map;
+            for (s32 i = 0; i < 1000; ++i)
+            {
+                CHECK_TRUE(map.insert(i, i * 2));
+            }
+            CHECK_FALSE(map.insert(10, 10));
+            CHECK_EQUAL((u32)1000, map.size());
+
+            s32 value = 0;
+            CHECK_TRUE(map.find(10, [&](s32 const& v) { value = v; }));
+            CHECK_EQUAL(20, value);
+            CHECK_FALSE(map.find(1000, [&](s32 const& v) { value = v; }));
+
+            for (s32 i = 0; i < 1000; i += 2)
+            {
+                CHECK_TRUE(map.erase(i));
+            }
+            CHECK_EQUAL((u32)500, map.size());
+        }
+
+        UNITTEST_TEST(batch)
+        {
+            flat_hashmap_n::concurrent_hashmap_t<s32, s32> map;
+
+            const u32 n = 1000;
+            s32       keys[n];
+            s32       values[n];
+            for (u32 i = 0; i < n; ++i)
+            {
+                keys[i]   = (s32)i;
+                values[i] = (s32)i + 1;
+            }
+            CHECK_EQUAL(n, map.insert_batch(keys, values, n));
+            CHECK_EQUAL((u32)0, map.insert_batch(keys, values, n));
+            CHECK_EQUAL(n / 2, map.erase_batch(keys, n / 2));
+
+            u32 found = 0;
+            u32 wrong = 0;
+            map.find_batch(keys, n, [&](u32 i, s32 const* value) {
+                if (value != nullptr)
+                {
+                    found += 1;
+                    wrong += (i < n / 2 || *value != values[i]) ? 1 : 0;
+                }
+            });
+            CHECK_EQUAL(n / 2, found);
+            CHECK_EQUAL((u32)0, wrong);
+        }
+
+        UNITTEST_TEST(threads)
+        {
+            flat_hashmap_n::concurrent_hashmap_t<s32, s32> map;
+
+            // Every thread inserts and erases its own range of keys while also reading the ranges of others
+            const s32   num_threads = 4;
+            const s32   n           = 20000;
+            std::thread threads[num_threads];
+            for (s32 t = 0; t < num_threads; ++t)
+            {
+                threads[t] = std::thread([&map, t]() {
+                    s32 const base = t * n;
+                    for (s32 i = 0; i < n; ++i)
+                    {
+                        map.insert(base + i, base + i);
+                        map.find(((t + 1) % num_threads) * n + i, [](s32 const&) {});
+                    }
+                    for (s32 i = 0; i < n; i += 2)
+                        map.erase(base + i);
+                });
+            }
+            for (s32 t = 0; t < num_threads; ++t)
+                threads[t].join();
+
+            CHECK_EQUAL((u32)(num_threads * n / 2), map.size());
+            for (s32 i = 0; i < num_threads * n; ++i)
+            {
+                CHECK_EQUAL((i & 1) != 0, map.find(i, [](s32 const&) {}));
+            }
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -1,13 +1,76 @@
 #include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
 #include "cbase/c_darray.h"
 
+#include "cgenerics/c_arena_alloc.h"
 #include "cgenerics/c_flat_hash_map.h"
+#include "cgenerics/c_flat_hash_map_build.h"
+#include "cgenerics/c_mapped_hash_map.h"
 #include "cgenerics/c_vector.h"
 
+#include "cgenerics/test_allocator.h"
+
 #include "cunittest/cunittest.h"
 
+#include <stdio.h>
+
 using namespace ncore;
 
+namespace
+{
+    // heap_array_t that counts every item it reads, writes or moves, as a measure of the work a
+    // hashmap operation does
+    static u64 s_touches = 0;
+
+    template <typename T> class touch_array_t
+    {
+    public:
+        static touch_array_t<T>* create(u32 size, u32 cap, alloc_t* allocator = nullptr)
+        {
+            touch_array_t<T>* a = new (context_t::runtime_alloc()->allocate(sizeof(touch_array_t<T>))) touch_array_t<T>();
+            a->m_array          = heap_array_t<T>::create(size, cap, allocator);
+            return a;
+        }
+        static void destroy(touch_array_t<T>*& a)
+        {
+            if (a != nullptr)
+            {
+                heap_array_t<T>::destroy(a->m_array);
+                context_t::runtime_alloc()->deallocate(a);
+                a = nullptr;
+            }
+        }
+
+        inline u32  size() const { return m_array->size(); }
+        inline u32  cap_cur() const { return m_array->cap_cur(); }
+        inline void set_size(u32 size) { m_array->set_size(size); }
+        inline T*   get_item(u32 i) const
+        {
+            s_touches += 1;
+            return m_array->get_item(i);
+        }
+        inline void set_item(u32 i, T const& item)
+        {
+            s_touches += 1;
+            m_array->set_item(i, item);
+        }
+        inline void add_item(T const& item)
+        {
+            s_touches += 1;
+            m_array->add_item(item);
+        }
+        bool set_capacity(u32 cap)
+        {
+            if (cap != m_array->cap_cur())
+                s_touches += m_array->size();
+            return m_array->set_capacity(cap);
+        }
+
+    private:
+        heap_array_t<T>* m_array;
+    };
+} // namespace
+
 UNITTEST_SUITE_BEGIN(flat_hashmap)
 {
     UNITTEST_FIXTURE(main)
@@ -29,6 +92,79 @@ UNITTEST_SUITE_BEGIN(flat_hashmap)
             CHECK_EQUAL(0x389bd94a9cbf2525, hash);
         }
 
+        UNITTEST_TEST(fold_mul)
+        {
+            CHECK_EQUAL((u64)0, flat_hashmap_n::fold_mul(0, 0x123456789abcdefULL));
+            CHECK_EQUAL((u64)6, flat_hashmap_n::fold_mul(2, 3));
+            // (2^64 - 1) * (2^64 - 1) = 2^128 - 2^65 + 1, hi = 0xFFFFFFFFFFFFFFFE, lo = 1
+            CHECK_EQUAL((u64)0xFFFFFFFFFFFFFFFFULL, flat_hashmap_n::fold_mul(0xFFFFFFFFFFFFFFFFULL, 0xFFFFFFFFFFFFFFFFULL));
+        }
+
+        UNITTEST_TEST(wyhash)
+        {
+            // All lengths, including the partial tails, should produce different hashes
+            u8  data[40];
+            u64 hashes[40];
+            for (s32 i = 0; i < 40; ++i)
+                data[i] = (u8)(i * 7 + 1);
+            for (u32 n = 0; n < 40; ++n)
+            {
+                hashes[n] = flat_hashmap_n::WYHASH64(data, n, 0);
+                for (u32 p = 0; p < n; ++p)
+                {
+                    CHECK_NOT_EQUAL(hashes[p], hashes[n]);
+                }
+            }
+        }
+
+        // Distribution of H2 (fingerprint) and H1 (group) for sequential and strided keys, with
+        // 65536 keys every H2 value should be seen ~256 times and every group of a table with
+        // 2048 groups should receive ~32 keys.
+        template <typename Key, typename Hasher> static bool hash_distribution(u64 stride)
+        {
+            const u32 n      = 65536;
+            const u32 groups = 2048;
+            u32       h2[256];
+            u32       h1[groups];
+            for (u32 i = 0; i < 256; ++i)
+                h2[i] = 0;
+            for (u32 i = 0; i < groups; ++i)
+                h1[i] = 0;
+
+            Hasher hasher;
+            for (u32 i = 0; i < n; ++i)
+            {
+                Key const key  = (Key)(i * stride);
+                u64 const hash = hasher(&key);
+                h2[flat_hashmap_n::H2(hash)] += 1;
+                h1[flat_hashmap_n::H1(hash, nullptr) & (groups - 1)] += 1;
+            }
+
+            for (u32 i = 0; i < 256; ++i)
+            {
+                if (h2[i] < 128 || h2[i] > 384)
+                    return false;
+            }
+            for (u32 i = 0; i < groups; ++i)
+            {
+                if (h1[i] > 72)
+                    return false;
+            }
+            return true;
+        }
+
+        UNITTEST_TEST(hash_quality)
+        {
+            const u64 strides[] = {1, 2, 7, 256, 4096, 65536};
+            for (s32 i = 0; i < 6; ++i)
+            {
+                CHECK_TRUE((hash_distribution<u32, flat_hashmap_n::IntHash<u32>>(strides[i])));
+                CHECK_TRUE((hash_distribution<u64, flat_hashmap_n::IntHash<u64>>(strides[i])));
+                CHECK_TRUE((hash_distribution<u64, flat_hashmap_n::WyHash<u64>>(strides[i])));
+                CHECK_TRUE((hash_distribution<u64, flat_hashmap_n::IntHash<u64>>(strides[i] << 32)));
+            }
+        }
+
         UNITTEST_TEST(ctrl_single)
         {
             flat_hashmap_n::ctrl_t ctrl;
@@ -56,6 +192,897 @@ UNITTEST_SUITE_BEGIN(flat_hashmap)
                 }
             }
         }
+
+        UNITTEST_TEST(ctrl_match_simd)
+        {
+            flat_hashmap_n::ctrl_t ctrl;
+            ctrl.clear();
+
+            // Fill the group with hashes from a small range so that there are many duplicates
+            u64 rnd = 0x9E3779B97F4A7C15ull;
+            for (s32 r = 0; r < 1000; r++)
+            {
+                for (s8 p = 0; p < 32; p++)
+                {
+                    rnd ^= rnd << 13;
+                    rnd ^= rnd >> 7;
+                    rnd ^= rnd << 17;
+                    ctrl.set_hash((u8)(rnd & 0x7), p);
+                }
+                u32 const mask = (u32)(rnd >> 32);
+                for (s32 h = 0; h < 8; h++)
+                {
+                    u32 const expected = ctrl.match_scalar((u8)h, mask);
+                    CHECK_EQUAL(expected, ctrl.match((u8)h, mask));
+#if defined(CGENERICS_SIMD_SSE2)
+                    CHECK_EQUAL(expected, ctrl.match_sse2((u8)h, mask));
+#endif
+#if defined(CGENERICS_SIMD_AVX2)
+                    CHECK_EQUAL(expected, ctrl.match_avx2((u8)h, mask));
+#endif
+                }
+            }
+
+            // H2 values with the top bit set must not suffer from signed compares
+            for (s8 p = 0; p < 32; p++)
+                ctrl.set_hash((u8)(0x80 + p), p);
+            for (s32 p = 0; p < 32; p++)
+            {
+                CHECK_EQUAL((u32)(1 << p), ctrl.match((u8)(0x80 + p), 0xffffffff));
+                CHECK_EQUAL(ctrl.match_scalar((u8)(0x80 + p), 0x55555555), ctrl.match((u8)(0x80 + p), 0x55555555));
+            }
+        }
+
+        UNITTEST_TEST(ctrl_refs)
+        {
+            CHECK_EQUAL(128, (s32)sizeof(flat_hashmap_n::ref32_t));
+            CHECK_EQUAL(96, (s32)sizeof(flat_hashmap_n::ref24_t));
+            CHECK_EQUAL(80, (s32)sizeof(flat_hashmap_n::ref20_t));
+
+            flat_hashmap_n::ctrl24_t ctrl24;
+            flat_hashmap_n::ctrl20_t ctrl20;
+            ctrl24.clear();
+            ctrl20.clear();
+            for (s8 p = 0; p < 32; p++)
+            {
+                ctrl24.set_ref(0xFFFFFF - p * 0x10101, p);
+                ctrl20.set_ref(0xFFFFF - p * 0x1111, p);
+            }
+            for (s8 p = 0; p < 32; p++)
+            {
+                CHECK_EQUAL((u32)(0xFFFFFF - p * 0x10101), ctrl24.get_ref(p));
+                CHECK_EQUAL((u32)(0xFFFFF - p * 0x1111), ctrl20.get_ref(p));
+            }
+
+            // Overwriting a ref should not disturb the neighbour that shares its nibble byte
+            CHECK_EQUAL((u32)(0xFFFFF - 5 * 0x1111), ctrl20.replace_ref(0x12345, 5));
+            CHECK_EQUAL((u32)0x12345, ctrl20.get_ref(5));
+            CHECK_EQUAL((u32)(0xFFFFF - 4 * 0x1111), ctrl20.get_ref(4));
+        }
+
+        UNITTEST_TEST(insert_erase_find_ref20)
+        {
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::Fnv1aHash<s32>, flat_hashmap_n::ref20_t> map;
+            CHECK_EQUAL((u32)0x100000, map.max_size());
+
+            const s32 n = 70000;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            for (s32 i = 0; i < n; i += 2)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+            }
+            for (s32 i = 1; i < n; i += 2)
+            {
+                s32* value = map.find(i);
+                CHECK_NOT_NULL(value);
+                CHECK_EQUAL(i, *value);
+            }
+        }
+
+        UNITTEST_TEST(insert_ref20_full)
+        {
+            // A full ref20_t map refuses the next item instead of truncating its item index
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref20_t> map;
+
+            const s32 n = (s32)map.max_size();
+            bool      ok = true;
+            for (s32 i = 0; i < n; ++i)
+                ok = ok && map.insert(i, i);
+            CHECK_TRUE(ok);
+            CHECK_EQUAL((u32)n, map.size());
+
+            CHECK_FALSE(map.insert(n, n));
+            CHECK_EQUAL((u32)n, map.size());
+            CHECK_NULL(map.find(n));
+
+            for (s32 i = 0; i < n; ++i)
+            {
+                s32 const* value = map.find(i);
+                ok               = ok && value != nullptr && *value == i;
+            }
+            CHECK_TRUE(ok);
+
+            // after an erase there is room for one more
+            CHECK_TRUE(map.erase(0));
+            CHECK_TRUE(map.insert(n, n));
+            CHECK_FALSE(map.insert(n + 1, n + 1));
+            CHECK_EQUAL(n, *map.find(n));
+        }
+
+        UNITTEST_TEST(insert_erase_find_split)
+        {
+            CHECK_EQUAL(64, (s32)sizeof(flat_hashmap_n::ctrl_line_t));
+
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::Fnv1aHash<s32>, flat_hashmap_n::ref24_t, flat_hashmap_n::layout_split_t> map;
+
+            const s32 n = 10000;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            for (s32 i = 0; i < n; i += 2)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+            }
+            for (s32 i = 0; i < n; ++i)
+            {
+                s32* value = map.find(i);
+                if (i & 1)
+                {
+                    CHECK_NOT_NULL(value);
+                    CHECK_EQUAL(i, *value);
+                }
+                else
+                {
+                    CHECK_NULL(value);
+                }
+            }
+        }
+
+        UNITTEST_TEST(insert_erase_find_vmem)
+        {
+            // Keys and values in virtual memory, the arrays grow in place
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref32_t, flat_hashmap_n::layout_packed_t, vmem_array_t> map;
+            map.insert(0, 0);
+            s32 const* value = map.find(0);
+
+            const s32 n = 100000;
+            for (s32 i = 1; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            CHECK_EQUAL(value, map.find(0));
+            for (s32 i = 0; i < n; ++i)
+            {
+                s32* v = map.find(i);
+                CHECK_NOT_NULL(v);
+                CHECK_EQUAL(i, *v);
+            }
+            for (s32 i = 0; i < n; i += 2)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+            }
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL((i & 1) == 1, map.find(i) != nullptr);
+            }
+        }
+
+        UNITTEST_TEST(vmem_array_failures)
+        {
+            // 4G items of 64 KB do not fit in the address space, reserving fails
+            struct block_t
+            {
+                u8 m_bytes[65536];
+            };
+            vmem_array_t<block_t>* huge = vmem_array_t<block_t>::create(0, 0xffffffff);
+            CHECK_NULL(huge);
+
+            // growing beyond the reserved range fails as well, the array stays as it was
+            vmem_array_t<block_t>* blocks = vmem_array_t<block_t>::create(0, 4, nullptr, 4 * sizeof(block_t));
+            CHECK_NOT_NULL(blocks);
+            u32 const cap = blocks->cap_cur();
+            CHECK_FALSE(blocks->set_capacity(0xffffffff));
+            CHECK_EQUAL(cap, blocks->cap_cur());
+            block_t block;
+            block.m_bytes[0] = 7;
+            blocks->add_item(block);
+            CHECK_EQUAL((u8)7, blocks->get_item(0)->m_bytes[0]);
+            vmem_array_t<block_t>::destroy(blocks);
+        }
+
+        UNITTEST_TEST(insert_out_of_memory)
+        {
+            // When the table can not grow the insert fails and the map keeps working
+            counting_alloc_t alloc;
+            for (u32 incremental = 0; incremental < 2; ++incremental)
+            {
+                flat_hashmap_n::hashmap_t<s32, s32> map(64, incremental == 1, &alloc);
+                map.set_incremental_rehash(incremental);
+
+                s32 n = 0;
+                while (map.capacity() < 64)
+                {
+                    CHECK_TRUE(map.insert(n, n));
+                    n += 1;
+                }
+                alloc.m_refuse = true;
+                while (map.insert(n, n))
+                    n += 1;
+                CHECK_EQUAL((u32)n, map.size());
+                CHECK_FALSE(map.insert(n, n));
+                CHECK_EQUAL((u32)n, map.size());
+                CHECK_FALSE(map.reserve(n * 4));
+
+                alloc.m_refuse = false;
+                bool ok        = true;
+                for (s32 i = 0; i < n; ++i)
+                {
+                    s32 const* value = map.find(i);
+                    ok               = ok && value != nullptr && *value == i;
+                }
+                CHECK_TRUE(ok);
+                CHECK_TRUE(map.insert(n, n));
+                CHECK_EQUAL((u32)(n + 1), map.size());
+                CHECK_EQUAL(n, *map.find(n));
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+        }
+
+        UNITTEST_TEST(find_batch)
+        {
+            const s32 n = 20000;
+            flat_hashmap_n::hashmap_t<s32, s32> map;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i * 3, i));
+            }
+
+            // Every third key exists, the batch size is not a multiple of the internal batch size
+            const u32 batch = 1000;
+            s32       keys[batch];
+            s32*      values[batch];
+            for (s32 b = 0; b < (n * 3); b += batch)
+            {
+                for (u32 i = 0; i < batch; ++i)
+                    keys[i] = b + (s32)i;
+                map.find_batch(keys, batch - 3, values);
+                for (u32 i = 0; i < batch - 3; ++i)
+                {
+                    CHECK_EQUAL(map.find(keys[i]), values[i]);
+                }
+            }
+        }
+
+        UNITTEST_TEST(insert_erase_find_backrefs)
+        {
+            flat_hashmap_n::hashmap_t<s32, s32> map(64, true);
+
+            const s32 n = 20000;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            for (s32 i = 0; i < n; i += 3)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+            }
+            for (s32 i = n; i < n * 2; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            for (s32 i = 0; i < n * 2; ++i)
+            {
+                s32* value = map.find(i);
+                if (i < n && (i % 3) == 0)
+                {
+                    CHECK_NULL(value);
+                }
+                else
+                {
+                    CHECK_NOT_NULL(value);
+                    CHECK_EQUAL(i, *value);
+                }
+            }
+            for (s32 i = 0; i < n * 2; ++i)
+            {
+                CHECK_EQUAL(i >= n || (i % 3) != 0, map.erase(i));
+            }
+            CHECK_TRUE(map.empty());
+        }
+
+        template <typename Map> static void incremental_rehash_churn(Map& map)
+        {
+            map.set_incremental_rehash(1);
+
+            const s32 n        = 20000;
+            bool      rehashed = false;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+                rehashed = rehashed || map.is_rehashing();
+
+                // Erase some while a migration might be in progress
+                if ((i % 5) == 4)
+                {
+                    CHECK_EQUAL(true, map.erase(i - 2));
+                }
+            }
+            CHECK_TRUE(rehashed);
+
+            for (s32 i = 0; i < n; ++i)
+            {
+                s32* value = map.find(i);
+                if ((i % 5) == 2)
+                {
+                    CHECK_NULL(value);
+                }
+                else
+                {
+                    CHECK_NOT_NULL(value);
+                    CHECK_EQUAL(i, *value);
+                }
+            }
+
+            map.set_incremental_rehash(0);
+            CHECK_FALSE(map.is_rehashing());
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL((i % 5) != 2, map.erase(i));
+            }
+            CHECK_TRUE(map.empty());
+        }
+
+        UNITTEST_TEST(incremental_rehash)
+        {
+            flat_hashmap_n::hashmap_t<s32, s32> map;
+            incremental_rehash_churn(map);
+
+            flat_hashmap_n::hashmap_t<s32, s32> map_backrefs(64, true);
+            incremental_rehash_churn(map_backrefs);
+
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref32_t, flat_hashmap_n::layout_split_t> map_split;
+            incremental_rehash_churn(map_split);
+        }
+
+        UNITTEST_TEST(incremental_rehash_bounded)
+        {
+            // Growing from 64 to 256K items, with the incremental rehash no single insert or erase may
+            // touch more than a few groups worth of items, stop-the-world resizes touch all items
+            const s32 n = 256 * 1024;
+            for (u32 backrefs = 0; backrefs < 2; ++backrefs)
+            {
+                flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref32_t, flat_hashmap_n::layout_packed_t, touch_array_t> map(64, backrefs == 1);
+                map.set_incremental_rehash(2);
+                u32 const capacity = map.capacity();
+
+                u64 worst = 0;
+                for (s32 i = 0; i < n; ++i)
+                {
+                    u64 const before = s_touches;
+                    map.insert(i, i);
+                    if ((i % 7) == 6)
+                        map.erase(i - 3);
+                    worst = (s_touches - before) > worst ? (s_touches - before) : worst;
+                }
+                CHECK_TRUE(map.capacity() > capacity * 1000);
+                CHECK_TRUE(worst < 2048);
+
+                bool ok    = true;
+                s32  count = 0;
+                for (auto it = map.begin(); it != map.end(); ++it)
+                {
+                    ok = ok && (it.first() % 7) != 3 && it.second() == it.first();
+                    count += 1;
+                }
+                CHECK_TRUE(ok);
+                CHECK_EQUAL((s32)map.size(), count);
+                for (s32 i = 0; i < n; ++i)
+                {
+                    s32 const* value = map.find(i);
+                    ok               = ok && ((i % 7) == 3 ? value == nullptr : (value != nullptr && *value == i));
+                }
+                CHECK_TRUE(ok);
+            }
+
+            // the reference, a stop-the-world resize touches every item
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref32_t, flat_hashmap_n::layout_packed_t, touch_array_t> map;
+            u64 worst = 0;
+            for (s32 i = 0; i < n; ++i)
+            {
+                u64 const before = s_touches;
+                map.insert(i, i);
+                worst = (s_touches - before) > worst ? (s_touches - before) : worst;
+            }
+            CHECK_TRUE(worst > (u64)n / 2);
+        }
+
+        template <typename Map> static void build_from_keys(Map& map, u32 threads)
+        {
+            // 50000 keys of which 10000 are duplicates, the first occurrence should win
+            const s32      n      = 50000;
+            const s32      unique = 40000;
+            array_t<s32>*  keys   = array_t<s32>::create(n, n);
+            array_t<s32>*  values = array_t<s32>::create(n, n);
+            for (s32 i = 0; i < n; ++i)
+            {
+                keys->set_item(i, (i * 7) % unique);
+                values->set_item(i, i);
+            }
+
+            CHECK_EQUAL((u32)unique, flat_hashmap_n::build_from(map, keys->get_item(0), values->get_item(0), n, threads));
+            CHECK_EQUAL((u32)unique, map.size());
+            for (s32 i = 0; i < unique; ++i)
+            {
+                s32* value = map.find((i * 7) % unique);
+                CHECK_NOT_NULL(value);
+                CHECK_EQUAL(i, *value);
+            }
+            CHECK_NULL(map.find(unique));
+
+            // The map is fully functional after a bulk build
+            for (s32 i = 0; i < unique; i += 2)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+            }
+            for (s32 i = 0; i < unique; ++i)
+            {
+                CHECK_EQUAL((i & 1) == 1, map.find(i) != nullptr);
+            }
+
+            array_t<s32>::destroy(keys);
+            array_t<s32>::destroy(values);
+        }
+
+        UNITTEST_TEST(build_from)
+        {
+            flat_hashmap_n::hashmap_t<s32, s32> map_serial;
+            build_from_keys(map_serial, 1);
+
+            flat_hashmap_n::hashmap_t<s32, s32> map;
+            build_from_keys(map, 4);
+
+            flat_hashmap_n::hashmap_t<s32, s32> map_backrefs(64, true);
+            build_from_keys(map_backrefs, 3);
+
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref24_t, flat_hashmap_n::layout_split_t> map_split;
+            build_from_keys(map_split, 8);
+        }
+
+        UNITTEST_TEST(build_from_full)
+        {
+            // More keys than a ref20_t map can hold, the keys beyond max_size() are refused like insert does
+            flat_hashmap_n::hashmap_t<u32, u32, flat_hashmap_n::DefaultHash<u32>, flat_hashmap_n::ref20_t> map;
+            u32 const      max    = map.max_size();
+            u32 const      n      = max + 50000;
+            array_t<u32>*  keys   = array_t<u32>::create(n, n);
+            array_t<u32>*  values = array_t<u32>::create(n, n);
+            for (u32 i = 0; i < n; ++i)
+            {
+                keys->set_item(i, i * 3);
+                values->set_item(i, i);
+            }
+
+            CHECK_EQUAL(max, flat_hashmap_n::build_from(map, keys->get_item(0), values->get_item(0), n, 4));
+            CHECK_EQUAL(max, map.size());
+            bool ok = true;
+            for (u32 i = 0; i < n; ++i)
+            {
+                u32 const* value = map.find(i * 3);
+                ok               = ok && (i < max ? (value != nullptr && *value == i) : value == nullptr);
+            }
+            CHECK_TRUE(ok);
+            CHECK_FALSE(map.insert(1, 1));
+
+            // an absurd thread count is clamped before the partitions are counted
+            flat_hashmap_n::hashmap_t<u32, u32> map_threads;
+            CHECK_EQUAL((u32)10000, flat_hashmap_n::build_from(map_threads, keys->get_item(0), values->get_item(0), 10000, 0xffffffff));
+
+            array_t<u32>::destroy(keys);
+            array_t<u32>::destroy(values);
+        }
+
+        template <typename Map, typename MappedMap> static void save_and_map(Map& map, MappedMap& mapped, const char* path)
+        {
+            const s32 n = 10000;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i * 5, i));
+            }
+            for (s32 i = 0; i < n; i += 3)
+            {
+                CHECK_EQUAL(true, map.erase(i * 5));
+            }
+            CHECK_TRUE(flat_hashmap_n::save(map, path));
+
+            CHECK_TRUE(mapped.open(path));
+            CHECK_EQUAL(map.size(), mapped.size());
+            CHECK_EQUAL(map.capacity(), mapped.capacity());
+            for (s32 i = 0; i < n * 5; ++i)
+            {
+                s32 const* value = mapped.find(i);
+                if ((i % 5) != 0 || ((i / 5) % 3) == 0)
+                {
+                    CHECK_NULL(value);
+                }
+                else
+                {
+                    CHECK_NOT_NULL(value);
+                    CHECK_EQUAL(i / 5, *value);
+                }
+            }
+            mapped.close();
+            remove(path);
+        }
+
+        UNITTEST_TEST(save_and_map)
+        {
+            flat_hashmap_n::hashmap_t<s32, s32>        map;
+            flat_hashmap_n::mapped_hashmap_t<s32, s32> mapped;
+            save_and_map(map, mapped, "cgenerics_test_packed.map");
+
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref24_t, flat_hashmap_n::layout_split_t>        map_split;
+            flat_hashmap_n::mapped_hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref24_t, flat_hashmap_n::layout_split_t> mapped_split;
+            save_and_map(map_split, mapped_split, "cgenerics_test_split.map");
+
+            // A file is only opened with the parameters that it was saved with
+            flat_hashmap_n::hashmap_t<s32, s32> empty;
+            CHECK_TRUE(flat_hashmap_n::save(empty, "cgenerics_test_empty.map"));
+            flat_hashmap_n::mapped_hashmap_t<s32, s32, flat_hashmap_n::Fnv1aHash<s32>> mapped_fnv;
+            CHECK_FALSE(mapped_fnv.open("cgenerics_test_empty.map"));
+            CHECK_TRUE(mapped.open("cgenerics_test_empty.map"));
+            CHECK_TRUE(mapped.empty());
+            CHECK_NULL(mapped.find(0));
+            mapped.close();
+            remove("cgenerics_test_empty.map");
+        }
+
+        UNITTEST_TEST(map_corrupt_refs)
+        {
+            typedef flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref24_t, flat_hashmap_n::layout_split_t>        map_t;
+            typedef flat_hashmap_n::mapped_hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref24_t, flat_hashmap_n::layout_split_t> mapped_t;
+
+            const s32 n = 1000;
+            map_t     map;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_TRUE(map.insert(i, i));
+            }
+            CHECK_TRUE(flat_hashmap_n::save(map, "cgenerics_test_corrupt.map"));
+
+            // Point every ref far beyond the items that are in the file
+            FILE* file = fopen("cgenerics_test_corrupt.map", "r+b");
+            CHECK_NOT_NULL(file);
+            flat_hashmap_n::persist_header_t header;
+            CHECK_EQUAL((size_t)1, fread(&header, sizeof(header), 1, file));
+            u64 const refs_size = (u64)(header.m_capacity + 1) * header.m_sizeof_refs;
+            fseek(file, (long)header.m_refs, SEEK_SET);
+            for (u64 i = 0; i < refs_size; ++i)
+                fputc(0xff, file);
+            fclose(file);
+
+            mapped_t mapped;
+            CHECK_TRUE(mapped.open("cgenerics_test_corrupt.map"));
+            bool ok = true;
+            for (s32 i = 0; i < n; ++i)
+            {
+                ok = ok && mapped.find(i) == nullptr;
+            }
+            CHECK_TRUE(ok);
+            mapped.close();
+            remove("cgenerics_test_corrupt.map");
+        }
+
+        static bool open_with_header(flat_hashmap_n::persist_header_t const& header, const char* path)
+        {
+            FILE* file = fopen(path, "r+b");
+            if (file == nullptr)
+                return false;
+            fwrite(&header, sizeof(header), 1, file);
+            fclose(file);
+
+            flat_hashmap_n::mapped_hashmap_t<s32, s32> mapped;
+            return mapped.open(path);
+        }
+
+        UNITTEST_TEST(map_corrupt_header)
+        {
+            flat_hashmap_n::hashmap_t<s32, s32> map;
+            for (s32 i = 0; i < 1000; ++i)
+            {
+                CHECK_TRUE(map.insert(i, i));
+            }
+            CHECK_TRUE(flat_hashmap_n::save(map, "cgenerics_test_header.map"));
+
+            FILE* file = fopen("cgenerics_test_header.map", "rb");
+            CHECK_NOT_NULL(file);
+            flat_hashmap_n::persist_header_t header;
+            CHECK_EQUAL((size_t)1, fread(&header, sizeof(header), 1, file));
+            fclose(file);
+            CHECK_TRUE(open_with_header(header, "cgenerics_test_header.map"));
+
+            // an offset that wraps around when the size of the section is added
+            flat_hashmap_n::persist_header_t corrupt = header;
+            corrupt.m_keys                           = 0xFFFFFFFFFFFFFF00ull;
+            CHECK_FALSE(open_with_header(corrupt, "cgenerics_test_header.map"));
+
+            // a section that overlaps the header
+            corrupt         = header;
+            corrupt.m_ctrls = 0;
+            CHECK_FALSE(open_with_header(corrupt, "cgenerics_test_header.map"));
+
+            // a section that is not aligned
+            corrupt          = header;
+            corrupt.m_values = header.m_values + 4;
+            CHECK_FALSE(open_with_header(corrupt, "cgenerics_test_header.map"));
+
+            // more items than the groups can reference
+            corrupt        = header;
+            corrupt.m_size = (header.m_capacity + 1) * 32 + 1;
+            CHECK_FALSE(open_with_header(corrupt, "cgenerics_test_header.map"));
+
+            CHECK_TRUE(open_with_header(header, "cgenerics_test_header.map"));
+            remove("cgenerics_test_header.map");
+        }
+
+#if defined(CGENERICS_FLAT_HASHMAP_STATS)
+        UNITTEST_TEST(stats)
+        {
+            const s32                           n = 10000;
+            flat_hashmap_n::hashmap_t<s32, s32> map;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            for (s32 i = 0; i < n * 2; ++i)
+            {
+                CHECK_EQUAL(i < n, map.find(i) != nullptr);
+            }
+            for (s32 i = 0; i < n; i += 2)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+            }
+
+            flat_hashmap_n::hashmap_stats_t stats;
+            map.stats(stats);
+
+            u64 hits = 0, misses = 0, inserts = 0;
+            for (u32 i = 0; i < flat_hashmap_n::hashmap_stats_t::cHistogramSize; ++i)
+            {
+                hits += stats.m_hits[i];
+                misses += stats.m_misses[i];
+                inserts += stats.m_inserts[i];
+            }
+            CHECK_EQUAL((u64)n, hits);
+            CHECK_EQUAL((u64)n, misses);
+            CHECK_EQUAL((u64)n, inserts);
+            CHECK_TRUE(stats.m_resizes > 0);
+            CHECK_TRUE(stats.m_h2_matches >= (u64)n);
+            CHECK_TRUE(stats.h2_false_match_rate() < 0.1);
+            CHECK_EQUAL((u32)(map.capacity() + 1), stats.m_groups);
+            CHECK_TRUE(stats.m_tombstones <= (u32)(n / 2));
+            CHECK_TRUE(stats.full_group_ratio() <= 1.0);
+
+            map.reset_stats();
+            map.stats(stats);
+            CHECK_EQUAL((u64)0, stats.m_resizes);
+            CHECK_EQUAL((u64)0, stats.m_h2_matches);
+        }
+#endif
+
+        UNITTEST_TEST(reserve_and_shrink)
+        {
+            flat_hashmap_n::hashmap_t<s32, s32> map;
+            map.reserve(10000);
+            u32 const capacity = map.capacity();
+            for (s32 i = 0; i < 10000; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            CHECK_EQUAL(capacity, map.capacity());
+
+            for (s32 i = 100; i < 10000; ++i)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+            }
+            CHECK_EQUAL(capacity, map.capacity());
+
+            map.shrink_to_fit();
+            CHECK_TRUE(map.capacity() < capacity);
+            CHECK_EQUAL((u32)100, map.size());
+            for (s32 i = 0; i < 10000; ++i)
+            {
+                s32* value = map.find(i);
+                CHECK_EQUAL(i < 100, value != nullptr);
+                if (value != nullptr)
+                    CHECK_EQUAL(i, *value);
+            }
+
+            // The map is fully functional after shrinking
+            for (s32 i = 100; i < 5000; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            for (s32 i = 0; i < 5000; ++i)
+            {
+                CHECK_NOT_NULL(map.find(i));
+            }
+        }
+
+        UNITTEST_TEST(allocator)
+        {
+            counting_alloc_t alloc;
+            {
+                // ctrls, keys and values, a header and a block each
+                flat_hashmap_n::hashmap_t<s32, s32> map(64, false, &alloc);
+                CHECK_EQUAL((alloc_t*)&alloc, map.allocator());
+                CHECK_EQUAL(6, alloc.m_live);
+
+                for (s32 i = 0; i < 10000; ++i)
+                {
+                    CHECK_EQUAL(true, map.insert(i, i));
+                }
+                CHECK_EQUAL(6, alloc.m_live);
+
+                // shrinking returns the large blocks
+                for (s32 i = 10; i < 10000; ++i)
+                {
+                    CHECK_EQUAL(true, map.erase(i));
+                }
+                map.shrink_to_fit();
+                CHECK_EQUAL(6, alloc.m_live);
+                CHECK_EQUAL((u32)10, map.size());
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+            CHECK_TRUE(alloc.m_allocs > 6);
+
+            {
+                // the allocator can be passed without the backrefs flag, no backrefs are allocated
+                flat_hashmap_n::hashmap_t<s32, s32> map(64, &alloc);
+                CHECK_EQUAL((alloc_t*)&alloc, map.allocator());
+                CHECK_EQUAL(6, alloc.m_live);
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+
+            {
+                // the scratch arrays of build_from come from the same allocator
+                s32 keys[5000];
+                s32 values[5000];
+                for (s32 i = 0; i < 5000; ++i)
+                {
+                    keys[i]   = i;
+                    values[i] = -i;
+                }
+                flat_hashmap_n::hashmap_t<s32, s32> map(64, true, &alloc);
+                CHECK_EQUAL(8, alloc.m_live);
+                CHECK_EQUAL((u32)5000, flat_hashmap_n::build_from(map, keys, values, 5000, 2));
+                CHECK_EQUAL(8, alloc.m_live);
+                for (s32 i = 0; i < 5000; ++i)
+                {
+                    s32* value = map.find(i);
+                    CHECK_NOT_NULL(value);
+                    if (value != nullptr)
+                        CHECK_EQUAL(-i, *value);
+                }
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+
+            {
+                // with virtual memory only the array headers come from the allocator
+                flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref32_t, flat_hashmap_n::layout_packed_t, vmem_array_t> map(64, false, &alloc);
+                for (s32 i = 0; i < 10000; ++i)
+                {
+                    CHECK_EQUAL(true, map.insert(i, i));
+                }
+                CHECK_EQUAL(3, alloc.m_live);
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+        }
+
+        UNITTEST_TEST(frame_arena)
+        {
+            u64 const mark = frame_arena()->mark();
+            {
+                frame_scope_t                       scope;
+                flat_hashmap_n::hashmap_t<s32, s32> map(64, false, scope.arena());
+                for (s32 i = 0; i < 10000; ++i)
+                {
+                    CHECK_EQUAL(true, map.insert(i, i));
+                }
+                for (s32 i = 0; i < 10000; ++i)
+                {
+                    CHECK_NOT_NULL(map.find(i));
+                }
+                CHECK_TRUE(scope.arena()->used() > mark);
+            }
+            CHECK_EQUAL(mark, frame_arena()->mark());
+        }
+
+        template <typename Map> static void auto_shrink(Map& map)
+        {
+            map.set_auto_shrink(10);
+
+            const s32 n = 50000;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            u32 const capacity = map.capacity();
+
+            // Erase down to 1000 items, the table follows
+            for (s32 i = 1000; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+            }
+            CHECK_TRUE(map.capacity() < capacity / 8);
+            for (s32 i = 0; i < n; ++i)
+            {
+                s32* value = map.find(i);
+                CHECK_EQUAL(i < 1000, value != nullptr);
+                if (value != nullptr)
+                    CHECK_EQUAL(i, *value);
+            }
+
+            // Hysteresis, churn at a stable size does not change the capacity
+            u32 const stable = map.capacity();
+            for (s32 i = 0; i < 20000; ++i)
+            {
+                CHECK_EQUAL(true, map.erase(i));
+                CHECK_EQUAL(true, map.insert(i + 1000, i));
+            }
+            CHECK_EQUAL(stable, map.capacity());
+            CHECK_EQUAL((u32)1000, map.size());
+        }
+
+        UNITTEST_TEST(auto_shrink)
+        {
+            flat_hashmap_n::hashmap_t<s32, s32> map;
+            auto_shrink(map);
+
+            flat_hashmap_n::hashmap_t<s32, s32> map_backrefs(64, true);
+            auto_shrink(map_backrefs);
+
+            flat_hashmap_n::hashmap_t<s32, s32, flat_hashmap_n::DefaultHash<s32>, flat_hashmap_n::ref24_t, flat_hashmap_n::layout_split_t> map_split;
+            auto_shrink(map_split);
+        }
+
+        UNITTEST_TEST(churn_drops_deletes)
+        {
+            // Insert and erase at a constant size, the tombstones should be reclaimed instead of growing
+            flat_hashmap_n::hashmap_t<s32, s32> map(1024);
+            const s32                            n = 600;
+            for (s32 i = 0; i < n; ++i)
+            {
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            u32 const capacity = map.capacity();
+            for (s32 i = n; i < 100 * n; ++i)
+            {
+                CHECK_EQUAL(true, map.erase(i - n));
+                CHECK_EQUAL(true, map.insert(i, i));
+            }
+            CHECK_EQUAL(capacity, map.capacity());
+            CHECK_EQUAL((u32)n, map.size());
+
+            for (s32 i = 99 * n; i < 100 * n; ++i)
+            {
+                s32* value = map.find(i);
+                CHECK_NOT_NULL(value);
+                CHECK_EQUAL(i, *value);
+            }
+
+            u32 histogram[8];
+            map.probe_length_histogram(histogram, 8);
+            u32 total = 0;
+            for (s32 i = 0; i < 8; ++i)
+                total += histogram[i];
+            CHECK_EQUAL((u32)n, total);
+            CHECK_EQUAL(0, histogram[7]);
+        }
+
         UNITTEST_TEST(group_empty)
         {
             flat_hashmap_n::ctrl_t group;
@@ -9,6 +9,14 @@ UNITTEST_SUITE_LIST(cUnitTest);
 UNITTEST_SUITE_DECLARE(cUnitTest, vector);
 //UNITTEST_SUITE_DECLARE(cUnitTest, hashmap);
 UNITTEST_SUITE_DECLARE(cUnitTest, flat_hashmap);
+UNITTEST_SUITE_DECLARE(cUnitTest, concurrent_hashmap);
+UNITTEST_SUITE_DECLARE(cUnitTest, snapshot_hashmap);
+UNITTEST_SUITE_DECLARE(cUnitTest, arena_alloc);
+UNITTEST_SUITE_DECLARE(cUnitTest, sorted_index);
+UNITTEST_SUITE_DECLARE(cUnitTest, btree);
+UNITTEST_SUITE_DECLARE(cUnitTest, ttmap);
+UNITTEST_SUITE_DECLARE(cUnitTest, sort);
+UNITTEST_SUITE_DECLARE(cUnitTest, queue);
 
 namespace ncore
 {
@@ -0,0 +1,217 @@
+#include "ccore/c_allocator.h"
+
+#include "cgenerics/c_queue.h"
+
+#include "cunittest/cunittest.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace ncore;
+
+namespace
+{
+    // Single threaded, fills the queue, empties it and moves batches over the wrap-around point
+    template <typename Queue> bool fill_and_drain(Queue& queue)
+    {
+        u32 const capacity = queue.capacity();
+        for (u32 i = 0; i < capacity; ++i)
+        {
+            if (!queue.try_push(i))
+                return false;
+        }
+        if (queue.try_push(capacity) || queue.size() != capacity)
+            return false;
+
+        u32 item;
+        for (u32 i = 0; i < capacity; ++i)
+        {
+            if (!queue.try_pop(item) || item != i)
+                return false;
+        }
+        if (queue.try_pop(item) || !queue.empty())
+            return false;
+
+        // batches that do not fit, and batches that wrap around the end of the ring
+        u32 in[64];
+        u32 out[64];
+        u32 next_in  = 0;
+        u32 next_out = 0;
+        for (u32 round = 0; round < 20; ++round)
+        {
+            u32 const n = (round * 7) % 64 + 1;
+            for (u32 i = 0; i < n; ++i)
+                in[i] = next_in + i;
+            u32 const room   = capacity - queue.size();
+            u32 const pushed = queue.try_push(in, n);
+            if (pushed != (n < room ? n : room))
+                return false;
+            next_in += pushed;
+
+            u32 const popped = queue.try_pop(out, (round * 5) % 64 + 1);
+            for (u32 i = 0; i < popped; ++i)
+            {
+                if (out[i] != next_out++)
+                    return false;
+            }
+        }
+        while (u32 popped = queue.try_pop(out, 64))
+        {
+            for (u32 i = 0; i < popped; ++i)
+            {
+                if (out[i] != next_out++)
+                    return false;
+            }
+        }
+        return next_out == next_in && queue.empty();
+    }
+} // namespace
+
+UNITTEST_SUITE_BEGIN(queue)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(capacity)
+        {
+            spsc_queue_t<u32> spsc(100);
+            CHECK_EQUAL((u32)128, spsc.capacity());
+            mpmc_queue_t<u32> mpmc(64);
+            CHECK_EQUAL((u32)64, mpmc.capacity());
+            mpmc_queue_t<u32> tiny(1);
+            CHECK_EQUAL((u32)2, tiny.capacity());
+        }
+
+        UNITTEST_TEST(spsc_fill_and_drain)
+        {
+            spsc_queue_t<u32> queue(48);
+            CHECK_TRUE(fill_and_drain(queue));
+        }
+
+        UNITTEST_TEST(mpmc_fill_and_drain)
+        {
+            mpmc_queue_t<u32> queue(48);
+            CHECK_TRUE(fill_and_drain(queue));
+        }
+
+        UNITTEST_TEST(spsc_threads)
+        {
+            // the producer alternates single pushes and batches, the consumer has to see every item in order
+            u32 const         n = 200000;
+            spsc_queue_t<u32> queue(256);
+
+            std::thread producer([&]() {
+                u32 batch[32];
+                u32 i = 0;
+                while (i < n)
+                {
+                    if ((i & 1) == 0)
+                    {
+                        queue.push(i++);
+                        continue;
+                    }
+                    u32 const count = (n - i) < 32 ? (n - i) : 32;
+                    for (u32 j = 0; j < count; ++j)
+                        batch[j] = i + j;
+                    queue.push(batch, count);
+                    i += count;
+                }
+            });
+
+            bool ok   = true;
+            u32  next = 0;
+            u32  batch[50];
+            while (next < n)
+            {
+                u32 const popped = queue.pop(batch, (next % 3) == 0 ? 1 : 50);
+                for (u32 j = 0; j < popped; ++j)
+                    ok = ok && batch[j] == next++;
+            }
+            producer.join();
+            CHECK_TRUE(ok);
+            CHECK_TRUE(queue.empty());
+        }
+
+        UNITTEST_TEST(mpmc_threads)
+        {
+            // every producer pushes its own increasing sequence, a consumer sees the items of a producer
+            // in increasing order and every item is popped exactly once
+            enum
+            {
+                cProducers = 4,
+                cConsumers = 4,
+                cItems     = 50000,
+            };
+            mpmc_queue_t<u64> queue(128);
+            std::atomic<u64>  sum(0);
+            std::atomic<u32>  popped(0);
+            std::atomic<u32>  errors(0);
+
+            std::thread producers[cProducers];
+            std::thread consumers[cConsumers];
+            for (u32 p = 0; p < cProducers; ++p)
+            {
+                producers[p] = std::thread([&, p]() {
+                    u64 batch[16];
+                    u32 i = 0;
+                    while (i < cItems)
+                    {
+                        if ((p & 1) == 0)
+                        {
+                            queue.push(((u64)p << 32) | i++);
+                            continue;
+                        }
+                        u32 const count = (cItems - i) < 16 ? (cItems - i) : 16;
+                        for (u32 j = 0; j < count; ++j)
+                            batch[j] = ((u64)p << 32) | (i + j);
+                        queue.push(batch, count);
+                        i += count;
+                    }
+                });
+            }
+            for (u32 c = 0; c < cConsumers; ++c)
+            {
+                consumers[c] = std::thread([&, c]() {
+                    s64 last[cProducers];
+                    for (u32 p = 0; p < cProducers; ++p)
+                        last[p] = -1;
+                    u64 local = 0;
+                    u64 batch[16];
+                    while (popped.load() < (u32)(cProducers * cItems))
+                    {
+                        u32 const n = queue.try_pop(batch, (c & 1) == 0 ? 1 : 16);
+                        if (n == 0)
+                        {
+                            std::this_thread::yield();
+                            continue;
+                        }
+                        for (u32 j = 0; j < n; ++j)
+                        {
+                            u32 const p = (u32)(batch[j] >> 32);
+                            s64 const i = (s64)(batch[j] & 0xffffffff);
+                            if (p >= cProducers || i <= last[p])
+                                errors.fetch_add(1);
+                            else
+                                last[p] = i;
+                            local += batch[j] & 0xffffffff;
+                        }
+                        popped.fetch_add(n);
+                    }
+                    sum.fetch_add(local);
+                });
+            }
+            for (u32 p = 0; p < cProducers; ++p)
+                producers[p].join();
+            for (u32 c = 0; c < cConsumers; ++c)
+                consumers[c].join();
+
+            CHECK_EQUAL((u32)0, errors.load());
+            CHECK_EQUAL((u32)(cProducers * cItems), popped.load());
+            CHECK_EQUAL((u64)cProducers * ((u64)cItems * (cItems - 1) / 2), sum.load());
+            CHECK_TRUE(queue.empty());
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,160 @@
+#include "ccore/c_allocator.h"
+
+#include "cgenerics/c_snapshot_hash_map.h"
+
+#include "cgenerics/test_allocator.h"
+
+#include "cunittest/cunittest.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(snapshot_hashmap)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(writer)
+        {
+            flat_hashmap_n::snapshot_hashmap_t<s32, s32> map;
+            for (s32 i = 0; i < 10000; ++i)
+            {
+                CHECK_TRUE(map.insert(i, i + 1));
+            }
+            CHECK_FALSE(map.insert(5, 5));
+            for (s32 i = 0; i < 10000; i += 2)
+            {
+                CHECK_TRUE(map.erase(i));
+            }
+            CHECK_FALSE(map.erase(0));
+            CHECK_EQUAL((u32)5000, map.size());
+
+            u32 const reader = map.register_reader();
+            for (s32 i = 0; i < 10000; ++i)
+            {
+                s32 value = 0;
+                CHECK_EQUAL((i & 1) != 0, map.find(reader, i, value));
+                if (i & 1)
+                {
+                    CHECK_EQUAL(i + 1, value);
+                }
+            }
+        }
+
+        UNITTEST_TEST(insert_out_of_memory)
+        {
+            // When no new table can be allocated the insert fails and the map keeps working
+            counting_alloc_t alloc;
+            {
+                flat_hashmap_n::snapshot_hashmap_t<s32, s32> map(64, &alloc);
+                CHECK_EQUAL(4, alloc.m_live);
+
+                alloc.m_refuse = true;
+                s32 n          = 0;
+                while (map.insert(n, n))
+                    n += 1;
+                CHECK_TRUE(n >= 64);
+                CHECK_EQUAL((u32)n, map.size());
+                CHECK_FALSE(map.insert(n, n));
+                CHECK_EQUAL((u32)n, map.size());
+
+                alloc.m_refuse = false;
+
+                u32 const reader = map.register_reader();
+                bool      ok     = true;
+                for (s32 i = 0; i < n; ++i)
+                {
+                    s32 value = -1;
+                    ok        = ok && map.find(reader, i, value) && value == i;
+                }
+                CHECK_TRUE(ok);
+                CHECK_TRUE(map.insert(n, n));
+                CHECK_EQUAL((u32)(n + 1), map.size());
+                CHECK_EQUAL(n, *map.find(n));
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+        }
+
+        UNITTEST_TEST(churn_keeps_size)
+        {
+            // Tombstones are dropped when building a new table, a constant size should not keep doubling
+            flat_hashmap_n::snapshot_hashmap_t<s32, s32> map(1024);
+            for (s32 i = 0; i < 500; ++i)
+                map.insert(i, i);
+            for (s32 i = 500; i < 100000; ++i)
+            {
+                CHECK_TRUE(map.erase(i - 500));
+                CHECK_TRUE(map.insert(i, i));
+            }
+            for (s32 i = 100000 - 500; i < 100000; ++i)
+            {
+                CHECK_NOT_NULL(map.find(i));
+            }
+        }
+
+        // Readers run lookups while the writer keeps inserting (growing the table many times) and erasing,
+        // a reader may never miss a key that was published before its lookup and never see a torn value.
+        UNITTEST_TEST(stress_readers)
+        {
+            flat_hashmap_n::snapshot_hashmap_t<u64, u64> map(64);
+
+            const u64        n           = 200000;
+            const s32        num_readers = 4;
+            std::atomic<u64> published(0);
+            std::atomic<u32> errors(0);
+            std::atomic<u32> lookups(0);
+            std::thread      readers[num_readers];
+
+            for (s32 r = 0; r < num_readers; ++r)
+            {
+                readers[r] = std::thread([&map, &published, &errors, &lookups, n, r]() {
+                    u32 const reader = map.register_reader();
+                    u64       rnd    = 0x9E3779B97F4A7C15ull * (r + 1);
+                    u32       count  = 0;
+                    while (true)
+                    {
+                        u64 const p = published.load(std::memory_order_acquire);
+                        if (p >= n)
+                            break;
+                        if (p == 0)
+                            continue;
+
+                        rnd ^= rnd << 13;
+                        rnd ^= rnd >> 7;
+                        rnd ^= rnd << 17;
+                        u64 const key   = rnd % p;
+                        u64       value = 0;
+                        bool const found = map.find(reader, key, value);
+
+                        // Even keys are never erased, odd keys are erased some time after being inserted
+                        if ((key & 1) == 0 && !found)
+                            errors.fetch_add(1);
+                        if (found && value != key * 3)
+                            errors.fetch_add(1);
+                        count++;
+                    }
+                    lookups.fetch_add(count);
+                });
+            }
+
+            for (u64 i = 0; i < n; ++i)
+            {
+                map.insert(i, i * 3);
+                if (i >= 1000 && ((i - 1000) & 1) == 1)
+                    map.erase(i - 1000);
+                published.store(i + 1, std::memory_order_release);
+            }
+
+            for (s32 r = 0; r < num_readers; ++r)
+                readers[r].join();
+
+            CHECK_EQUAL((u32)0, errors.load());
+            CHECK_TRUE(lookups.load() > 0);
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,367 @@
+#include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
+
+#include "cgenerics/c_sort.h"
+#include "cgenerics/c_vector.h"
+
+#include "cgenerics/test_allocator.h"
+
+#include "cunittest/cunittest.h"
+
+#include <algorithm>
+
+using namespace ncore;
+
+namespace
+{
+    inline u64 next_random(u64& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // Random values over the whole range of T, floats get a sign, a magnitude and a fraction
+    template <typename T> T random_value(u64& state) { return (T)next_random(state); }
+    template <> f32 random_value<f32>(u64& state) { return (f32)((s64)(next_random(state) % 2000001) - 1000000) / 64.0f; }
+    template <> f64 random_value<f64>(u64& state) { return (f64)((s64)(next_random(state) % 200000001) - 100000000) / 1024.0; }
+
+    template <typename T> bool same_items(T const* a, T const* b, u32 n)
+    {
+        for (u32 i = 0; i < n; ++i)
+        {
+            if (a[i] < b[i] || b[i] < a[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Radix sorts random values from a few items to a few thousand, std::sort is the reference
+    template <typename T> bool radix_matches_std()
+    {
+        u64 state = 0x9e3779b97f4a7c15ULL;
+        for (u32 n = 0; n <= 20000; n = (n < 40) ? n + 1 : n * 3)
+        {
+            vector_t<T> items;
+            for (u32 i = 0; i < n; ++i)
+                items.push_back(random_value<T>(state));
+            vector_t<T> expected(items);
+            std::sort(expected.begin(), expected.end());
+
+            sort_n::radix_sort(items.begin(), n, context_t::runtime_alloc());
+            if (!same_items(items.begin(), expected.begin(), n))
+                return false;
+        }
+        return true;
+    }
+
+    // Patterns that quicksorts are known to handle badly
+    enum
+    {
+        cRandom,
+        cSorted,
+        cReversed,
+        cEqual,
+        cFewDistinct,
+        cOrganPipe,
+        cSawtooth,
+        cPatterns
+    };
+
+    u32 pattern_value(s32 pattern, u32 i, u32 n, u64& state)
+    {
+        switch (pattern)
+        {
+            case cSorted: return i;
+            case cReversed: return n - i;
+            case cEqual: return 7;
+            case cFewDistinct: return (u32)(next_random(state) % 4);
+            case cOrganPipe: return i < n / 2 ? i : n - i;
+            case cSawtooth: return i % 97;
+        }
+        return (u32)next_random(state);
+    }
+
+    // Not arithmetic, so pdqsort uses the partition with branches
+    struct record_t
+    {
+        u32 m_key;
+        u32 m_payload;
+    };
+
+    struct record_less_t
+    {
+        inline bool operator()(record_t const& lhs, record_t const& rhs) const { return lhs.m_key < rhs.m_key; }
+    };
+
+    template <typename T> struct key_less_t
+    {
+        inline bool operator()(T const& lhs, T const& rhs) const { return lhs.m_key < rhs.m_key; }
+    };
+
+    // Owns a heap int, counts the live objects
+    struct owned_t
+    {
+        static s32 s_live;
+
+        owned_t(s32 v = 0)
+            : m_value(new s32(v))
+        {
+            s_live += 1;
+        }
+        owned_t(owned_t const& other)
+            : m_value(new s32(*other.m_value))
+        {
+            s_live += 1;
+        }
+        owned_t(owned_t&& other)
+            : m_value(other.m_value)
+        {
+            other.m_value = nullptr;
+            s_live += 1;
+        }
+        ~owned_t()
+        {
+            delete m_value;
+            s_live -= 1;
+        }
+        owned_t& operator=(owned_t&& other)
+        {
+            s32* const v  = m_value;
+            m_value       = other.m_value;
+            other.m_value = v;
+            return *this;
+        }
+        owned_t& operator=(owned_t const& other)
+        {
+            *m_value = *other.m_value;
+            return *this;
+        }
+        bool operator<(owned_t const& other) const { return *m_value < *other.m_value; }
+
+        s32* m_value;
+    };
+    s32 owned_t::s_live = 0;
+} // namespace
+
+UNITTEST_SUITE_BEGIN(sort)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(radix_sort)
+        {
+            CHECK_TRUE(radix_matches_std<u8>());
+            CHECK_TRUE(radix_matches_std<s8>());
+            CHECK_TRUE(radix_matches_std<u16>());
+            CHECK_TRUE(radix_matches_std<s16>());
+            CHECK_TRUE(radix_matches_std<u32>());
+            CHECK_TRUE(radix_matches_std<s32>());
+            CHECK_TRUE(radix_matches_std<u64>());
+            CHECK_TRUE(radix_matches_std<s64>());
+            CHECK_TRUE(radix_matches_std<f32>());
+            CHECK_TRUE(radix_matches_std<f64>());
+        }
+
+        UNITTEST_TEST(radix_skips_constant_bytes)
+        {
+            // ids below 2^20 leave the upper bytes constant, with an odd number of passes the result
+            // ends in the scratch buffer and is copied back
+            u64           state = 1;
+            vector_t<u64> items;
+            for (u32 i = 0; i < 5000; ++i)
+                items.push_back(next_random(state) & 0xfffff);
+            vector_t<u64> expected(items);
+            std::sort(expected.begin(), expected.end());
+            sort_n::radix_sort(items.begin(), items.size(), context_t::runtime_alloc());
+            CHECK_TRUE(same_items(items.begin(), expected.begin(), items.size()));
+        }
+
+        UNITTEST_TEST(radix_sort_msd)
+        {
+            // larger than cRadixCacheBytes, the top byte splits the items into buckets first
+            u32 const n     = (u32)sort_n::cRadixCacheBytes / 4;
+            u64       state = 3;
+            for (u32 d = 0; d < 3; ++d)
+            {
+                vector_t<u64> items;
+                for (u32 i = 0; i < n; ++i)
+                {
+                    u64 const r = next_random(state);
+                    // random, ids below 2^24, and a top byte that is 0 for most items, that bucket is split again
+                    items.push_back(d == 0 ? r : (d == 1 ? (r & 0xffffff) : ((r % 7 == 0) ? r : (r & 0x00ffffffffffffffULL))));
+                }
+                vector_t<u64> expected(items);
+                std::sort(expected.begin(), expected.end());
+                sort_n::radix_sort(items.begin(), n, context_t::runtime_alloc());
+                CHECK_TRUE(items == expected);
+            }
+
+            vector_t<f64> floats;
+            for (u32 i = 0; i < n; ++i)
+                floats.push_back(random_value<f64>(state));
+            vector_t<f64> expected(floats);
+            std::sort(expected.begin(), expected.end());
+            sort_n::radix_sort(floats.begin(), floats.size(), context_t::runtime_alloc());
+            CHECK_TRUE(same_items(floats.begin(), expected.begin(), floats.size()));
+        }
+
+        UNITTEST_TEST(pdqsort_patterns)
+        {
+            for (s32 pattern = 0; pattern < cPatterns; ++pattern)
+            {
+                for (u32 n = 0; n <= 30000; n = (n < 30) ? n + 1 : n * 4 + 3)
+                {
+                    u64           state = 12345 + n;
+                    vector_t<u32> keys;
+                    for (u32 i = 0; i < n; ++i)
+                        keys.push_back(pattern_value(pattern, i, n, state));
+
+                    // arithmetic, branchless partition
+                    vector_t<u32> sorted(keys);
+                    vector_t<u32> expected(keys);
+                    sort_n::pdqsort(sorted.begin(), n, sort_n::value_less_t<u32>());
+                    std::sort(expected.begin(), expected.end());
+                    CHECK_TRUE(same_items(sorted.begin(), expected.begin(), n));
+
+                    // records, the partition with branches, the payloads have to travel with the keys
+                    vector_t<record_t> records;
+                    for (u32 i = 0; i < n; ++i)
+                    {
+                        record_t const r = {keys.at(i), keys.at(i) * 3 + 1};
+                        records.push_back(r);
+                    }
+                    sort_n::pdqsort(records.begin(), n, record_less_t());
+                    bool ok = true;
+                    for (u32 i = 0; i < n; ++i)
+                        ok = ok && records.at(i).m_key == expected.at(i) && records.at(i).m_payload == expected.at(i) * 3 + 1;
+                    CHECK_TRUE(ok);
+                }
+            }
+        }
+
+        UNITTEST_TEST(heap_sort)
+        {
+            // the fallback of pdqsort when the partitions stay unbalanced
+            u64           state = 99;
+            vector_t<s32> items;
+            for (u32 i = 0; i < 1000; ++i)
+                items.push_back((s32)(next_random(state) % 300) - 150);
+            vector_t<s32> expected(items);
+            std::sort(expected.begin(), expected.end());
+            sort_n::value_less_t<s32> less;
+            sort_n::pdq_n::heap_sort(items.begin(), items.end(), less);
+            CHECK_TRUE(same_items(items.begin(), expected.begin(), items.size()));
+        }
+
+        UNITTEST_TEST(vector_sort)
+        {
+            u64           state = 7;
+            vector_t<s64> items;
+            for (u32 i = 0; i < 10000; ++i)
+                items.push_back((s64)next_random(state));
+            vector_t<s64> expected(items);
+            std::sort(expected.begin(), expected.end());
+            sort_n::sort(items);
+            CHECK_TRUE(items == expected);
+
+            // descending with a compare
+            sort_n::sort(items, [](s64 const& lhs, s64 const& rhs) { return lhs > rhs; });
+            expected.reverse();
+            CHECK_TRUE(items == expected);
+
+            vector_t<u32> empty;
+            sort_n::sort(empty);
+            CHECK_EQUAL((u32)0, empty.size());
+        }
+
+        UNITTEST_TEST(no_scratch)
+        {
+            // Without a scratch buffer the items are sorted with pdqsort
+            u32 const     n     = (u32)sort_n::cMinParallelItems * 2 + 7;
+            u64           state = 11;
+            vector_t<u64> expected;
+            for (u32 i = 0; i < n; ++i)
+                expected.push_back(next_random(state));
+            vector_t<u64> items(expected);
+            std::sort(expected.begin(), expected.end());
+
+            counting_alloc_t alloc;
+            alloc.m_refuse = true;
+
+            sort_n::radix_sort(items.begin(), n, &alloc);
+            CHECK_TRUE(items == expected);
+
+            items.reverse();
+            sort_n::sort(items.begin(), n, sort_n::value_less_t<u64>(), &alloc);
+            CHECK_TRUE(items == expected);
+
+            items.reverse();
+            sort_n::parallel_sort(items.begin(), n, sort_n::value_less_t<u64>(), 2, &alloc);
+            CHECK_TRUE(items == expected);
+            CHECK_EQUAL(0, alloc.m_allocs);
+        }
+
+        UNITTEST_TEST(vector_sort_non_trivial)
+        {
+            {
+                vector_t<owned_t> items;
+                for (s32 i = 0; i < 500; ++i)
+                    items.push_back(owned_t((i * 7919) % 500));
+                s32 const live = owned_t::s_live;
+                sort_n::sort(items);
+                CHECK_EQUAL(live, owned_t::s_live);
+                bool ok = true;
+                for (s32 i = 0; i < 500; ++i)
+                    ok = ok && *items.at(i).m_value == i;
+                CHECK_TRUE(ok);
+
+                // parallel falls back to the calling thread
+                items.reverse();
+                sort_n::parallel_sort(items, 4);
+                ok = true;
+                for (s32 i = 0; i < 500; ++i)
+                    ok = ok && *items.at(i).m_value == i;
+                CHECK_TRUE(ok);
+            }
+            CHECK_EQUAL(0, owned_t::s_live);
+        }
+
+        UNITTEST_TEST(parallel_sort)
+        {
+            // 3 and 5 threads leave a run without a partner in the first merge round
+            u32 const threads[] = {2, 3, 4, 5};
+            for (u32 t = 0; t < 4; ++t)
+            {
+                u32 const     n     = (u32)sort_n::cMinParallelItems * threads[t] + 1234;
+                u64           state = 31 + t;
+                vector_t<u64> items;
+                for (u32 i = 0; i < n; ++i)
+                    items.push_back(next_random(state) % (n / 2)); // with duplicates
+                vector_t<u64> expected(items);
+                std::sort(expected.begin(), expected.end());
+                sort_n::parallel_sort(items, threads[t]);
+                CHECK_TRUE(items == expected);
+            }
+
+            // trivially copyable records with a compare are merged in parallel as well
+            u32 const          n     = (u32)sort_n::cMinParallelItems * 3;
+            u64                state = 5;
+            vector_t<record_t> records;
+            for (u32 i = 0; i < n; ++i)
+            {
+                record_t const r = {(u32)(next_random(state) % 1000), i};
+                records.push_back(r);
+            }
+            sort_n::parallel_sort(records, 3, key_less_t<record_t>());
+            bool ok = true;
+            for (u32 i = 1; i < n; ++i)
+                ok = ok && !(records.at(i).m_key < records.at(i - 1).m_key);
+            CHECK_TRUE(ok);
+        }
+    }
+}
+UNITTEST_SUITE_END
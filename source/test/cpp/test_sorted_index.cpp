@@ -0,0 +1,144 @@
+#include "ccore/c_allocator.h"
+
+#include "cgenerics/c_sorted_index.h"
+#include "cgenerics/c_vector.h"
+
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+namespace
+{
+    // The reference, the first position with an item >= key
+    template <typename T> u32 lower_bound_scalar(vector_t<T> const& items, T key)
+    {
+        u32 i = 0;
+        while (i < items.size() && items.at(i) < key)
+            ++i;
+        return i;
+    }
+
+    // Builds an index over 0, 3, 3, 6, 9, 9, ... (every other item doubled) for each size up to 'max_size'
+    // and checks every query on the items, between them and beyond both ends
+    template <typename T, s32 Layout> bool index_matches_scalar(u32 max_size)
+    {
+        for (u32 n = 0; n <= max_size; n = (n < 300) ? n + 1 : n * 2 + 7)
+        {
+            vector_t<T> items;
+            for (u32 i = 0; i < n; ++i)
+                items.push_back((T)((i - i / 3) * 3));
+
+            sorted_index_t<T, Layout> index;
+            index.build(items);
+            if (index.size() != n)
+                return false;
+
+            u32 const last = n > 0 ? (u32)items.back() + 3 : 3;
+            for (u32 key = 0; key <= last; ++key)
+            {
+                u32 const lb = lower_bound_scalar(items, (T)key);
+                if (index.lower_bound((T)key) != lb || index.rank((T)key) != lb)
+                    return false;
+                s32 const expected = (lb < n && items.at(lb) == (T)key) ? (s32)lb : -1;
+                if (index.find((T)key) != expected)
+                    return false;
+            }
+        }
+        return true;
+    }
+} // namespace
+
+UNITTEST_SUITE_BEGIN(sorted_index)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(empty)
+        {
+            sorted_index_t<u32> eytzinger;
+            CHECK_TRUE(eytzinger.empty());
+            CHECK_EQUAL(-1, eytzinger.find(1));
+            CHECK_EQUAL((u32)0, eytzinger.lower_bound(1));
+
+            sorted_index_t<u32, cSortedBlocked> blocked;
+            CHECK_TRUE(blocked.empty());
+            CHECK_EQUAL(-1, blocked.find(1));
+            CHECK_EQUAL((u32)0, blocked.lower_bound(1));
+        }
+
+        UNITTEST_TEST(eytzinger)
+        {
+            CHECK_TRUE((index_matches_scalar<u32, cSortedEytzinger>(5000)));
+            CHECK_TRUE((index_matches_scalar<s64, cSortedEytzinger>(1000)));
+            CHECK_TRUE((index_matches_scalar<f64, cSortedEytzinger>(1000)));
+        }
+
+        UNITTEST_TEST(blocked)
+        {
+            CHECK_TRUE((index_matches_scalar<u32, cSortedBlocked>(5000)));
+            CHECK_TRUE((index_matches_scalar<s32, cSortedBlocked>(5000)));
+            CHECK_TRUE((index_matches_scalar<f32, cSortedBlocked>(3000)));
+            CHECK_TRUE((index_matches_scalar<u64, cSortedBlocked>(3000)));
+            CHECK_TRUE((index_matches_scalar<f64, cSortedBlocked>(1000)));
+            CHECK_TRUE((index_matches_scalar<u16, cSortedBlocked>(1000)));
+        }
+
+        UNITTEST_TEST(negative_and_extreme_keys)
+        {
+            vector_t<s32> items;
+            items.push_back(-2000000000);
+            for (s32 i = -100; i < 100; ++i)
+                items.push_back(i);
+            items.push_back(0x7fffffff);
+
+            sorted_index_t<s32, cSortedBlocked> blocked;
+            sorted_index_t<s32>                 eytzinger;
+            blocked.build(items);
+            eytzinger.build(items);
+
+            CHECK_EQUAL(0, blocked.find(-2000000000));
+            CHECK_EQUAL(0, eytzinger.find(-2000000000));
+            CHECK_EQUAL(1, blocked.find(-100));
+            CHECK_EQUAL(201, blocked.find(0x7fffffff));
+            CHECK_EQUAL(201, eytzinger.find(0x7fffffff));
+            CHECK_EQUAL((u32)201, blocked.lower_bound(1000));
+            CHECK_EQUAL((u32)201, eytzinger.lower_bound(1000));
+            CHECK_EQUAL((u32)0, blocked.rank(-2000000001));
+
+            // unsigned keys above 0x7fffffff
+            vector_t<u32> big;
+            for (u32 i = 0; i < 100; ++i)
+                big.push_back(0x7ffffff0u + i * 0x1000000u);
+            sorted_index_t<u32, cSortedBlocked> ublocked;
+            ublocked.build(big);
+            for (u32 i = 0; i < 100; ++i)
+                CHECK_EQUAL((s32)i, ublocked.find(big.at(i)));
+            CHECK_EQUAL((u32)100, ublocked.lower_bound(0xffffffffu));
+        }
+
+        UNITTEST_TEST(rebuild)
+        {
+            vector_t<u32> items;
+            for (u32 i = 0; i < 1000; ++i)
+                items.push_back(i * 2);
+
+            sorted_index_t<u32> index;
+            index.build(items);
+            CHECK_EQUAL(500, index.find(1000));
+
+            items.clear();
+            for (u32 i = 0; i < 10; ++i)
+                items.push_back(i);
+            index.build(items);
+            CHECK_EQUAL((u32)10, index.size());
+            CHECK_EQUAL(-1, index.find(1000));
+            CHECK_EQUAL(5, index.find(5));
+
+            index.clear();
+            CHECK_TRUE(index.empty());
+        }
+    }
+}
+UNITTEST_SUITE_END
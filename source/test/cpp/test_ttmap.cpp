@@ -0,0 +1,135 @@
+#include "ccore/c_allocator.h"
+
+#include "cgenerics/c_ttmap.h"
+
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+namespace
+{
+    // Every key has the same hash, all the items end up in one chain
+    void same_hash(const void* key, u32 sizeof_key, u64& high, u64& low)
+    {
+        high = 1;
+        low  = 2;
+    }
+
+    // The hashes only differ in the highest bits, the items are pushed down to the deepest levels
+    void deep_hash(const void* key, u32 sizeof_key, u64& high, u64& low)
+    {
+        high = (u64)(*(u32 const*)key) << 56;
+        low  = 0;
+    }
+
+    void* value_of(u64 i) { return (void*)(ptr_t)(i * 8 + 8); }
+} // namespace
+
+UNITTEST_SUITE_BEGIN(ttmap)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(insert_find_remove)
+        {
+            ttmap_t map(nullptr, sizeof(u64), nullptr, 4);
+            CHECK_TRUE(map.empty());
+
+            u64 const n = 20000;
+            for (u64 i = 0; i < n; ++i)
+                CHECK_TRUE(map.insert(&i, value_of(i)));
+            CHECK_EQUAL((u32)n, map.size());
+            CHECK_TRUE(map.nodes() > 0);
+
+            u64 const dup = 7;
+            CHECK_FALSE(map.insert(&dup, nullptr));
+            CHECK_EQUAL(value_of(7), *map.find(&dup));
+
+            for (u64 i = 0; i < n; ++i)
+            {
+                void** v = map.find(&i);
+                CHECK_NOT_NULL(v);
+                CHECK_EQUAL(value_of(i), *v);
+                u64 const missing = i + n;
+                CHECK_NULL(map.find(&missing));
+            }
+
+            for (u64 i = 0; i < n; i += 2)
+                CHECK_TRUE(map.remove(&i));
+            CHECK_EQUAL((u32)(n / 2), map.size());
+            for (u64 i = 0; i < n; ++i)
+                CHECK_EQUAL((i & 1) == 1, map.find(&i) != nullptr);
+
+            // removing the rest collapses all the nodes again
+            for (u64 i = 1; i < n; i += 2)
+                CHECK_TRUE(map.remove(&i));
+            CHECK_TRUE(map.empty());
+            CHECK_EQUAL((u32)0, map.nodes());
+            CHECK_FALSE(map.remove(&dup));
+        }
+
+        UNITTEST_TEST(value_proxy)
+        {
+            ttmap_t   map(nullptr, sizeof(u32));
+            u32 const key = 42;
+
+            ttmap_value_t v = map[&key];
+            CHECK_TRUE(v.empty());
+            v = value_of(1);
+            CHECK_FALSE(v.empty());
+            CHECK_EQUAL(value_of(1), map[&key].value());
+            CHECK_TRUE(v == map[&key]);
+
+            map[&key] = value_of(2);
+            CHECK_EQUAL(value_of(2), *map.find(&key));
+            CHECK_EQUAL((u32)1, map.size());
+
+            map[&key].remove();
+            CHECK_TRUE(map[&key].empty());
+            CHECK_TRUE(map.empty());
+        }
+
+        UNITTEST_TEST(full_hash_collisions)
+        {
+            ttmap_t map(nullptr, sizeof(u32), same_hash);
+            for (u32 i = 0; i < 100; ++i)
+                CHECK_TRUE(map.insert(&i, value_of(i)));
+            CHECK_EQUAL((u32)0, map.nodes());
+            for (u32 i = 0; i < 100; ++i)
+                CHECK_EQUAL(value_of(i), *map.find(&i));
+
+            for (u32 i = 0; i < 100; i += 3)
+                CHECK_TRUE(map.remove(&i));
+            for (u32 i = 0; i < 100; ++i)
+                CHECK_EQUAL((i % 3) != 0, map.find(&i) != nullptr);
+        }
+
+        UNITTEST_TEST(deep_paths)
+        {
+            ttmap_t map(nullptr, sizeof(u32), deep_hash, 8);
+            for (u32 i = 0; i < 256; ++i)
+                CHECK_TRUE(map.insert(&i, value_of(i)));
+            for (u32 i = 0; i < 256; ++i)
+                CHECK_EQUAL(value_of(i), *map.find(&i));
+            for (u32 i = 0; i < 256; ++i)
+                CHECK_TRUE(map.remove(&i));
+            CHECK_EQUAL((u32)0, map.nodes());
+        }
+
+        UNITTEST_TEST(clear)
+        {
+            ttmap_t map(nullptr, sizeof(u64));
+            for (u64 i = 0; i < 1000; ++i)
+                map.insert(&i, value_of(i));
+            map.clear();
+            CHECK_TRUE(map.empty());
+            CHECK_EQUAL((u32)0, map.nodes());
+            u64 const key = 5;
+            CHECK_NULL(map.find(&key));
+            CHECK_TRUE(map.insert(&key, value_of(5)));
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -1,13 +1,141 @@
 #include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
 
+#include "cgenerics/c_arena_alloc.h"
 #include "cgenerics/c_hash_map.h"
 #include "cgenerics/c_vector.h"
 
+#include "cgenerics/test_allocator.h"
+
 #include "cunittest/cunittest.h"
 
 using namespace ncore;
 
+namespace
+{
+    // Owns a heap int, counts the live objects and the move constructions
+    struct tracked_t
+    {
+        static s32 s_live;
+        static s32 s_moves;
+
+        tracked_t()
+            : m_value(new s32(0))
+        {
+            s_live += 1;
+        }
+        tracked_t(s32 v)
+            : m_value(new s32(v))
+        {
+            s_live += 1;
+        }
+        tracked_t(tracked_t const& other)
+            : m_value(new s32(*other.m_value))
+        {
+            s_live += 1;
+        }
+        tracked_t(tracked_t&& other)
+            : m_value(other.m_value)
+        {
+            other.m_value = nullptr;
+            s_live += 1;
+            s_moves += 1;
+        }
+        ~tracked_t()
+        {
+            delete m_value;
+            s_live -= 1;
+        }
+        tracked_t& operator=(tracked_t const& other)
+        {
+            *m_value = *other.m_value;
+            return *this;
+        }
+        tracked_t& operator=(tracked_t&& other)
+        {
+            delete m_value;
+            m_value       = other.m_value;
+            other.m_value = nullptr;
+            return *this;
+        }
+
+        s32 value() const { return *m_value; }
+
+        s32* m_value;
+    };
+    s32 tracked_t::s_live  = 0;
+    s32 tracked_t::s_moves = 0;
+
+    // Same as tracked_t but opted in as trivially relocatable
+    struct handle_t : public tracked_t
+    {
+        handle_t() {}
+        handle_t(s32 v)
+            : tracked_t(v)
+        {
+        }
+    };
+    // Checks find and count_occurences against a scalar loop, for every size up to 'max_size' the
+    // value is placed at every position, so the unrolled loop, the single vector loop and the tail
+    // all see a match.
+    template <typename T> bool search_matches_scalar(u32 max_size)
+    {
+        for (u32 n = 0; n <= max_size; ++n)
+        {
+            vector_t<T> v;
+            for (u32 i = 0; i < n; ++i)
+                v.push_back((T)(i % 7 + 1));
+            if (v.find((T)0) != -1 || v.count_occurences((T)0) != 0)
+                return false;
+
+            for (u32 i = 0; i < n; ++i)
+            {
+                T const old = v.at(i);
+                v.at(i)        = (T)0;
+                if (v.find((T)0) != (s32)i || v.count_occurences((T)0) != 1)
+                    return false;
+                v.at(i) = old;
+            }
+
+            u32 expected = 0;
+            for (u32 i = 0; i < n; ++i)
+                expected += (v.at(i) == (T)3) ? 1 : 0;
+            if (v.count_occurences((T)3) != expected)
+                return false;
+        }
+        return true;
+    }
+
+    // Checks compare and == against a scalar loop for vectors that differ at every position
+    template <typename T> bool compare_matches_scalar(u32 max_size)
+    {
+        for (u32 n = 1; n <= max_size; ++n)
+        {
+            vector_t<T> a;
+            for (u32 i = 0; i < n; ++i)
+                a.push_back((T)(i * 3 + 1));
+            vector_t<T> b(a);
+            if (!(a == b) || a.compare(b) != 0 || a < b)
+                return false;
+
+            for (u32 i = 0; i < n; ++i)
+            {
+                b.at(i) = (T)(a.at(i) + 1);
+                if (a == b || a.compare(b) != -1 || b.compare(a) != 1 || !(a < b))
+                    return false;
+                b.at(i) = a.at(i);
+            }
+
+            // a prefix is less
+            b.pop_back();
+            if (a == b || a.compare(b) != 1 || b.compare(a) != -1)
+                return false;
+        }
+        return true;
+    }
+} // namespace
 
+CGENERICS_TRIVIALLY_RELOCATABLE(handle_t)
 
 UNITTEST_SUITE_BEGIN(vector)
 {
@@ -25,6 +153,429 @@ UNITTEST_SUITE_BEGIN(vector)
             v.push_back(i);
         }
 
+        UNITTEST_TEST(reserve_and_shrink)
+        {
+            vector_t<s32> v;
+            v.reserve(100);
+            CHECK_TRUE(v.capacity() >= 100);
+            u32 const capacity = v.capacity();
+
+            // reserve never shrinks
+            v.reserve(10);
+            CHECK_EQUAL(capacity, v.capacity());
+
+            for (s32 i = 0; i < 1000; ++i)
+                v.push_back(i);
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL(i, v.at(i));
+
+            v.resize(10);
+            v.shrink_to_fit();
+            CHECK_EQUAL(10, (s32)v.capacity());
+            for (s32 i = 0; i < 10; ++i)
+                CHECK_EQUAL(i, v.at(i));
+
+            v.resize(0);
+            v.shrink_to_fit();
+            CHECK_EQUAL(0, (s32)v.capacity());
+            CHECK_TRUE(v.begin() == nullptr);
+
+            v.push_back(7);
+            CHECK_EQUAL(7, v.at(0));
+        }
+
+        UNITTEST_TEST(constructors)
+        {
+            // a literal 0 is a capacity, not a nullptr allocator
+            vector_t<s32> a(0);
+            CHECK_EQUAL(0, (s32)a.size());
+            CHECK_TRUE(a.allocator() != nullptr);
+
+            vector_t<s32> b(16);
+            CHECK_EQUAL(0, (s32)b.size());
+            CHECK_TRUE(b.capacity() >= 16);
+
+            counting_alloc_t alloc;
+            {
+                vector_t<s32> c(16, &alloc);
+                CHECK_EQUAL((alloc_t*)&alloc, c.allocator());
+                CHECK_EQUAL(1, alloc.m_live);
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+        }
+
+        UNITTEST_TEST(allocator)
+        {
+            counting_alloc_t alloc;
+            {
+                vector_t<s32> v(&alloc);
+                CHECK_EQUAL((alloc_t*)&alloc, v.allocator());
+                for (s32 i = 0; i < 1000; ++i)
+                    v.push_back(i);
+                CHECK_EQUAL(1, alloc.m_live);
+
+                // the copy allocates from the same allocator
+                vector_t<s32> copy(v);
+                CHECK_EQUAL((alloc_t*)&alloc, copy.allocator());
+                CHECK_EQUAL(2, alloc.m_live);
+
+                // shrinking to nothing returns the block
+                v.resize(0);
+                v.shrink_to_fit();
+                CHECK_EQUAL(1, alloc.m_live);
+
+                v.push_back(1);
+                CHECK_EQUAL(2, alloc.m_live);
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+            CHECK_TRUE(alloc.m_allocs > 2);
+        }
+
+        UNITTEST_TEST(frame_arena)
+        {
+            u64 const mark = frame_arena()->mark();
+            {
+                frame_scope_t scope;
+                vector_t<s32> v(scope.arena());
+                for (s32 i = 0; i < 10000; ++i)
+                    v.push_back(i);
+                for (s32 i = 0; i < 10000; ++i)
+                    CHECK_EQUAL(i, v.at(i));
+                CHECK_TRUE(scope.arena()->used() >= mark + 10000 * sizeof(s32));
+            }
+            CHECK_EQUAL(mark, frame_arena()->mark());
+        }
+
+        static void push_range(vector_t<s32>& v, s32 begin, s32 end)
+        {
+            for (s32 i = begin; i < end; ++i)
+                v.push_back(i);
+        }
+
+        UNITTEST_TEST(inline_vector)
+        {
+            counting_alloc_t alloc;
+            {
+                inline_vector_t<s32, 8> v(&alloc);
+                CHECK_TRUE(v.is_inline());
+                CHECK_EQUAL(8, (s32)v.capacity());
+
+                // up to N items nothing is allocated
+                push_range(v, 0, 8);
+                CHECK_TRUE(v.is_inline());
+                CHECK_EQUAL(0, alloc.m_allocs);
+
+                // one more spills to the heap
+                v.push_back(8);
+                CHECK_FALSE(v.is_inline());
+                CHECK_EQUAL(1, alloc.m_live);
+                push_range(v, 9, 100);
+                for (s32 i = 0; i < 100; ++i)
+                    CHECK_EQUAL(i, v.at(i));
+
+                // back into the inline buffer when the items fit
+                v.resize(5);
+                v.shrink_to_fit();
+                CHECK_TRUE(v.is_inline());
+                CHECK_EQUAL(0, alloc.m_live);
+                for (s32 i = 0; i < 5; ++i)
+                    CHECK_EQUAL(i, v.at(i));
+
+                push_range(v, 5, 50);
+                CHECK_EQUAL(1, alloc.m_live);
+                v.clear();
+                CHECK_TRUE(v.is_inline());
+                CHECK_EQUAL(0, (s32)v.size());
+                CHECK_EQUAL(0, alloc.m_live);
+
+                v.push_back(7);
+                CHECK_EQUAL(7, v.at(0));
+                CHECK_EQUAL(0, alloc.m_live);
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+        }
+
+        UNITTEST_TEST(inline_vector_move)
+        {
+            counting_alloc_t alloc;
+            {
+                // inline items are copied
+                inline_vector_t<s32, 4> a(&alloc);
+                push_range(a, 0, 3);
+                inline_vector_t<s32, 4> b(static_cast<inline_vector_t<s32, 4>&&>(a));
+                CHECK_TRUE(b.is_inline());
+                CHECK_EQUAL(3, (s32)b.size());
+                CHECK_EQUAL(0, (s32)a.size());
+                CHECK_TRUE(a.is_inline());
+                for (s32 i = 0; i < 3; ++i)
+                    CHECK_EQUAL(i, b.at(i));
+
+                // a heap block is taken over
+                push_range(a, 0, 100);
+                s32 const* p = a.begin();
+                b            = static_cast<inline_vector_t<s32, 4>&&>(a);
+                CHECK_EQUAL(p, b.begin());
+                CHECK_EQUAL(100, (s32)b.size());
+                CHECK_TRUE(a.is_inline());
+                CHECK_EQUAL(0, (s32)a.size());
+                CHECK_EQUAL(1, alloc.m_live);
+
+                // into a vector_t and back
+                vector_t<s32> c(static_cast<vector_t<s32>&&>(b));
+                CHECK_EQUAL(p, c.begin());
+                CHECK_EQUAL((alloc_t*)&alloc, c.allocator());
+                inline_vector_t<s32, 4> d(static_cast<vector_t<s32>&&>(c));
+                CHECK_EQUAL(p, d.begin());
+                CHECK_EQUAL(0, (s32)c.size());
+                for (s32 i = 0; i < 100; ++i)
+                    CHECK_EQUAL(i, d.at(i));
+
+                // copies
+                inline_vector_t<s32, 4> e(d);
+                CHECK_EQUAL(100, (s32)e.size());
+                CHECK_TRUE(e.begin() != d.begin());
+                CHECK_EQUAL(2, alloc.m_live);
+                e = a;
+                CHECK_EQUAL(0, (s32)e.size());
+                a.push_back(42);
+                e = a;
+                CHECK_EQUAL(42, e.at(0));
+            }
+            CHECK_EQUAL(0, alloc.m_live);
+        }
+
+        UNITTEST_TEST(copy_and_fill)
+        {
+            vector_t<s32> v;
+            for (s32 i = 0; i < 1000; ++i)
+                v.push_back(i);
+
+            vector_t<s32> copy(v);
+            CHECK_EQUAL(1000, (s32)copy.size());
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL(i, copy.at(i));
+
+            copy.set_all(7);
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL(7, copy.at(i));
+
+            vector_t<u8> bytes;
+            bytes.resize(100);
+            bytes.set_all(0xAB);
+            for (s32 i = 0; i < 100; ++i)
+                CHECK_EQUAL(0xAB, (s32)bytes.at(i));
+
+            s32 const items[] = {-1, -2, -3};
+            v.insert(10, items, 3);
+            CHECK_EQUAL(1003, (s32)v.size());
+            CHECK_EQUAL(9, v.at(9));
+            CHECK_EQUAL(-1, v.at(10));
+            CHECK_EQUAL(-3, v.at(12));
+            CHECK_EQUAL(10, v.at(13));
+            v.erase(10, 3);
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL(i, v.at(i));
+
+            v.reverse();
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL(999 - i, v.at(i));
+        }
+
+        template <typename T> static void non_trivial()
+        {
+            {
+                vector_t<T> v;
+                for (s32 i = 0; i < 100; ++i)
+                    v.push_back(T(i));
+                CHECK_EQUAL(100, T::s_live);
+                for (s32 i = 0; i < 100; ++i)
+                    CHECK_EQUAL(i, v.at(i).value());
+
+                T const items[] = {T(-1), T(-2)};
+                v.insert(50, items, 2);
+                v.erase(0, 10);
+                CHECK_EQUAL(92 + 2, T::s_live);
+                CHECK_EQUAL(10, v.at(0).value());
+                CHECK_EQUAL(-1, v.at(40).value());
+                CHECK_EQUAL(-2, v.at(41).value());
+                CHECK_EQUAL(50, v.at(42).value());
+
+                vector_t<T> copy(v);
+                CHECK_EQUAL(92 * 2 + 2, T::s_live);
+                copy.resize(10);
+                CHECK_EQUAL(92 + 10 + 2, T::s_live);
+                copy.shrink_to_fit();
+                copy.pop_back();
+                copy.erase_unordered(0);
+                CHECK_EQUAL(8, (s32)copy.size());
+                CHECK_EQUAL(18, copy.at(0).value());
+
+                v.reverse();
+                CHECK_EQUAL(99, v.at(0).value());
+                CHECK_EQUAL(10, v.at(91).value());
+
+                copy = v;
+                CHECK_EQUAL(92 * 2 + 2, T::s_live);
+                v.clear();
+                CHECK_EQUAL(92 + 2, T::s_live);
+            }
+            CHECK_EQUAL(0, T::s_live);
+        }
+
+        UNITTEST_TEST(non_trivial)
+        {
+            tracked_t::s_moves = 0;
+            non_trivial<tracked_t>();
+            CHECK_TRUE(tracked_t::s_moves > 0);
+
+            // growing and erasing moves the items with memmove, only the explicit moves are counted
+            tracked_t::s_moves = 0;
+            {
+                vector_t<handle_t> v;
+                for (s32 i = 0; i < 1000; ++i)
+                    v.push_back(handle_t(i));
+                v.erase(0, 500);
+                CHECK_EQUAL(0, tracked_t::s_moves);
+                CHECK_EQUAL(500, v.at(0).value());
+            }
+            CHECK_EQUAL(0, tracked_t::s_live);
+
+            {
+                inline_vector_t<tracked_t, 4> v;
+                for (s32 i = 0; i < 3; ++i)
+                    v.push_back(tracked_t(i));
+                inline_vector_t<tracked_t, 4> moved(static_cast<inline_vector_t<tracked_t, 4>&&>(v));
+                CHECK_EQUAL(3, tracked_t::s_live);
+                for (s32 i = 3; i < 20; ++i)
+                    moved.push_back(tracked_t(i));
+                moved.resize(2);
+                moved.shrink_to_fit();
+                CHECK_TRUE(moved.is_inline());
+                CHECK_EQUAL(1, moved.at(1).value());
+                CHECK_EQUAL(2, tracked_t::s_live);
+            }
+            CHECK_EQUAL(0, tracked_t::s_live);
+        }
+
+        UNITTEST_TEST(find_and_count)
+        {
+            CHECK_TRUE(search_matches_scalar<u8>(200));
+            CHECK_TRUE(search_matches_scalar<s8>(200));
+            CHECK_TRUE(search_matches_scalar<u16>(100));
+            CHECK_TRUE(search_matches_scalar<s16>(100));
+            CHECK_TRUE(search_matches_scalar<u32>(70));
+            CHECK_TRUE(search_matches_scalar<s32>(70));
+            CHECK_TRUE(search_matches_scalar<u64>(40));
+            CHECK_TRUE(search_matches_scalar<s64>(40));
+            CHECK_TRUE(search_matches_scalar<f32>(70));
+            CHECK_TRUE(search_matches_scalar<f64>(40));
+
+            // the search also starts at an unaligned address
+            vector_t<u32> v;
+            for (u32 i = 0; i < 1000; ++i)
+                v.push_back(i);
+            CHECK_EQUAL(999, simd_n::search_t<u32>::find(v.begin() + 1, 999, 999) + 1);
+            CHECK_EQUAL((u32)1, simd_n::search_t<u32>::count(v.begin() + 1, 999, 500));
+
+            // floats match with ==, -0.0 is 0.0
+            vector_t<f32> f;
+            for (u32 i = 0; i < 100; ++i)
+                f.push_back((f32)i);
+            CHECK_EQUAL(0, f.find(-0.0f));
+            CHECK_EQUAL(-1, f.find(0.5f));
+        }
+
+        UNITTEST_TEST(compare)
+        {
+            CHECK_TRUE(compare_matches_scalar<u8>(80));
+            CHECK_TRUE(compare_matches_scalar<s8>(40));
+            CHECK_TRUE(compare_matches_scalar<u16>(70));
+            CHECK_TRUE(compare_matches_scalar<u32>(70));
+            CHECK_TRUE(compare_matches_scalar<s32>(70));
+            CHECK_TRUE(compare_matches_scalar<u64>(40));
+            CHECK_TRUE(compare_matches_scalar<f32>(40));
+            CHECK_TRUE(compare_matches_scalar<f64>(40));
+
+            // items compare as values, not as bytes
+            vector_t<s32> a;
+            vector_t<s32> b;
+            a.push_back(-1);
+            b.push_back(1);
+            CHECK_TRUE(a < b);
+            a.at(0) = 0x100;
+            b.at(0) = 0x001;
+            CHECK_TRUE(b < a);
+
+            vector_t<s32> empty;
+            CHECK_TRUE(empty < a);
+            CHECK_TRUE(empty == vector_t<s32>());
+        }
+
+        UNITTEST_TEST(find_sorted)
+        {
+            for (u32 n = 0; n < 300; ++n)
+            {
+                // 0, 2, 2, 4, 6, 6, ...
+                vector_t<u32> v;
+                for (u32 i = 0; i < n; ++i)
+                    v.push_back((i - i / 3) * 2);
+
+                for (u32 i = 0; i < n; ++i)
+                {
+                    s32 const f = v.find_sorted(v.at(i));
+                    CHECK_TRUE(f >= 0 && f <= (s32)i);
+                    CHECK_EQUAL(v.at(i), v.at((u32)f));
+                    CHECK_EQUAL(-1, v.find_sorted(v.at(i) + 1));
+                }
+                CHECK_EQUAL(-1, v.find_sorted(0xffffffff));
+            }
+        }
+
+        UNITTEST_TEST(virtual_shrink)
+        {
+            vector_t<s32> v;
+            CHECK_TRUE(v.reserve_virtual(1 << 20));
+            for (s32 i = 0; i < 100000; ++i)
+                v.push_back(i);
+            u32 const capacity = v.capacity();
+
+            // the pages above the items are decommitted, the items stay where they are
+            s32 const* p = v.begin();
+            v.resize(1000);
+            v.shrink_to_fit();
+            CHECK_TRUE(v.capacity() < capacity);
+            CHECK_TRUE(v.capacity() >= 1000);
+            CHECK_EQUAL(p, v.begin());
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL(i, v.at(i));
+        }
+
+        UNITTEST_TEST(vector_virtual)
+        {
+            vector_t<s32> v;
+            CHECK_TRUE(v.reserve_virtual(1 << 24));
+            CHECK_TRUE(v.is_virtual());
+
+            // Growing commits pages behind the existing items, they never move
+            v.push_back(0);
+            s32 const* p = v.begin();
+            for (s32 i = 1; i < 100000; ++i)
+                v.push_back(i);
+            CHECK_EQUAL(p, v.begin());
+            CHECK_EQUAL(100000, (s32)v.size());
+            CHECK_TRUE(v.capacity() >= v.size());
+            for (s32 i = 0; i < 100000; ++i)
+                CHECK_EQUAL(i, v.at(i));
+
+            // The capacity cannot grow beyond the reserved range
+            v.reserve(1 << 24);
+            CHECK_EQUAL((u32)(1 << 24), v.capacity());
+
+            v.clear();
+            CHECK_FALSE(v.is_virtual());
+            CHECK_EQUAL(0, (s32)v.capacity());
+        }
+
     }
 }
 UNITTEST_SUITE_END
@@ -0,0 +1,48 @@
+#ifndef __C_GENERICS_TEST_ALLOCATOR_H__
+#define __C_GENERICS_TEST_ALLOCATOR_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_context.h"
+
+namespace ncore
+{
+    // Forwards to the runtime allocator and counts the blocks that are still allocated,
+    // while 'm_refuse' is set every allocation fails
+    class counting_alloc_t : public alloc_t
+    {
+    public:
+        counting_alloc_t()
+            : m_live(0)
+            , m_allocs(0)
+            , m_refuse(false)
+        {
+        }
+
+        s32  m_live;
+        s32  m_allocs;
+        bool m_refuse;
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment)
+        {
+            if (m_refuse)
+                return nullptr;
+            m_live += 1;
+            m_allocs += 1;
+            return context_t::runtime_alloc()->allocate(size, alignment);
+        }
+        virtual u32 v_deallocate(void* ptr)
+        {
+            m_live -= 1;
+            return context_t::runtime_alloc()->deallocate(ptr);
+        }
+        virtual void v_release() {}
+    };
+
+} // namespace ncore
+
+#endif // __C_GENERICS_TEST_ALLOCATOR_H__